@@ -0,0 +1,754 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "cache/cache.h"
+
+
+/**
+ * The cache is a flat image of a setup stored next to its XML file. It's
+ * mapped into memory and the setup is rebuilt from it directly, without
+ * going through libxml. It's only used while size, mtime & checksum of
+ * the XML file match the ones recorded in its header, otherwise the XML
+ * file is loaded as usual. All values are stored in host byte order.
+ */
+
+
+/** identifies a cache file */
+#define CACHE_MAGIC             "NFTCACHE"
+/** increase whenever the layout of the cache changes */
+#define CACHE_VERSION           1
+/** written as-is to detect caches from hosts with other byte order */
+#define CACHE_BYTE_ORDER        0x01020304
+/** checksum of XML file (CACHE_CHECKSUM_LENGTH bytes) */
+#define CACHE_CHECKSUM          G_CHECKSUM_SHA1
+/** tiles nested deeper are considered corruption */
+#define CACHE_MAX_DEPTH         64
+
+
+/** start of every cache file */
+typedef struct
+{
+        char magic[8];
+        guint32 version;
+        guint32 byte_order;
+        /** XML file the cache was created from */
+        guint64 xml_size;
+        gint64 xml_mtime;
+        guint8 xml_checksum[CACHE_CHECKSUM_LENGTH];
+        /** amount of hardware records following the header */
+        guint32 hardware;
+        guint32 reserved;
+} CacheHeader;
+
+
+/** one LED of a chain */
+typedef struct
+{
+        gint32 x, y;
+        guint32 component;
+        guint32 gain;
+} CacheLed;
+
+
+/** cursor into a mapped cache */
+typedef struct
+{
+        const guint8 *pos;
+        const guint8 *end;
+        /** false once reading went past the end */
+        gboolean ok;
+} CacheReader;
+
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** fill size & mtime of XML file into header */
+static gboolean _stamp_stat(const char *filename, CacheHeader * h)
+{
+        struct stat sts;
+        if(stat(filename, &sts) == -1)
+        {
+                NFT_LOG(L_ERROR, "Failed to access \"%s\" - %s",
+                        filename, strerror(errno));
+                return false;
+        }
+
+        h->xml_size = (guint64) sts.st_size;
+        h->xml_mtime = (gint64) sts.st_mtim.tv_sec *
+                G_GINT64_CONSTANT(1000000000) + sts.st_mtim.tv_nsec;
+
+        return true;
+}
+
+
+/** calculate checksum of XML data */
+static gboolean _checksum(const gchar * buf, gsize size, guint8 * digest)
+{
+        GChecksum *c = g_checksum_new(CACHE_CHECKSUM);
+        g_checksum_update(c, (const guchar *) buf, size);
+
+        gsize length = CACHE_CHECKSUM_LENGTH;
+        g_checksum_get_digest(c, digest, &length);
+        g_checksum_free(c);
+
+        return length == CACHE_CHECKSUM_LENGTH;
+}
+
+
+/** fill checksum of XML file into header */
+static gboolean _stamp_checksum(const char *filename, CacheHeader * h)
+{
+        GMappedFile *m;
+        if(!(m = g_mapped_file_new(filename, false, NULL)))
+                return false;
+
+        gboolean result = _checksum(g_mapped_file_get_contents(m),
+                                    g_mapped_file_get_length(m),
+                                    h->xml_checksum);
+        g_mapped_file_unref(m);
+
+        return result;
+}
+
+
+/** append raw bytes */
+static void _put(GByteArray * b, const void *data, gsize size)
+{
+        g_byte_array_append(b, data, size);
+}
+
+
+static void _put_u32(GByteArray * b, guint32 v)
+{
+        _put(b, &v, sizeof(v));
+}
+
+
+static void _put_i32(GByteArray * b, gint32 v)
+{
+        _put(b, &v, sizeof(v));
+}
+
+
+static void _put_double(GByteArray * b, double v)
+{
+        _put(b, &v, sizeof(v));
+}
+
+
+/** append length & characters of a string (NULL is stored as "") */
+static void _put_string(GByteArray * b, const char *s)
+{
+        guint32 length = s ? strlen(s) : 0;
+        _put_u32(b, length);
+        _put(b, s, length);
+}
+
+
+/** copy raw bytes */
+static void _get(CacheReader * r, void *data, gsize size)
+{
+        if(!r->ok || (gsize) (r->end - r->pos) < size)
+        {
+                r->ok = false;
+                memset(data, 0, size);
+                return;
+        }
+
+        memcpy(data, r->pos, size);
+        r->pos += size;
+}
+
+
+static guint32 _get_u32(CacheReader * r)
+{
+        guint32 v;
+        _get(r, &v, sizeof(v));
+        return v;
+}
+
+
+static gint32 _get_i32(CacheReader * r)
+{
+        gint32 v;
+        _get(r, &v, sizeof(v));
+        return v;
+}
+
+
+static double _get_double(CacheReader * r)
+{
+        double v;
+        _get(r, &v, sizeof(v));
+        return v;
+}
+
+
+/** read a string (free with g_free()) */
+static gchar *_get_string(CacheReader * r)
+{
+        guint32 length = _get_u32(r);
+        if(!r->ok || (gsize) (r->end - r->pos) < length)
+        {
+                r->ok = false;
+                return NULL;
+        }
+
+        gchar *s = g_strndup((const gchar *) r->pos, length);
+        r->pos += length;
+        return s;
+}
+
+
+/** append tile, its chain & all child tiles */
+static void _put_tile(GByteArray * b, LedTile * t)
+{
+        LedFrameCord x, y;
+        led_tile_get_pos(t, &x, &y);
+        _put_i32(b, x);
+        _put_i32(b, y);
+
+        double pX, pY;
+        led_tile_get_pivot(t, &pX, &pY);
+        _put_double(b, pX);
+        _put_double(b, pY);
+        _put_double(b, led_tile_get_rotation(t));
+
+        LedChain *c = led_tile_get_chain(t);
+        _put_u32(b, c ? 1 : 0);
+        if(c)
+        {
+                LedCount count = led_chain_get_ledcount(c);
+                _put_u32(b, count);
+                _put_string(b,
+                            led_pixel_format_to_string(led_chain_get_format
+                                                       (c)));
+
+                LedCount i;
+                for(i = 0; i < count; i++)
+                {
+                        Led *l = led_chain_get_nth(c, i);
+
+                        LedFrameCord lX, lY;
+                        led_get_pos(l, &lX, &lY);
+
+                        CacheLed cl = {
+                                .x = lX,
+                                .y = lY,
+                                .component = led_get_component(l),
+                                .gain = led_get_gain(l),
+                        };
+                        _put(b, &cl, sizeof(cl));
+                }
+        }
+
+        guint32 children = 0;
+        LedTile *ct;
+        for(ct = led_tile_get_child(t); ct; ct = led_tile_list_get_next(ct))
+                children++;
+
+        _put_u32(b, children);
+        for(ct = led_tile_get_child(t); ct; ct = led_tile_list_get_next(ct))
+                _put_tile(b, ct);
+}
+
+
+/** read tile, its chain & all child tiles */
+static LedTile *_get_tile(CacheReader * r, guint depth)
+{
+        if(depth > CACHE_MAX_DEPTH)
+                return NULL;
+
+        LedTile *t;
+        if(!(t = led_tile_new()))
+                return NULL;
+
+        LedFrameCord x = _get_i32(r);
+        LedFrameCord y = _get_i32(r);
+        led_tile_set_pos(t, x, y);
+
+        double pX = _get_double(r);
+        double pY = _get_double(r);
+        led_tile_set_pivot(t, pX, pY);
+        led_tile_set_rotation(t, _get_double(r));
+
+        if(_get_u32(r))
+        {
+                guint32 count = _get_u32(r);
+                gchar *format = _get_string(r);
+
+                /* don't trust count before allocating */
+                if(!r->ok ||
+                   (gsize) (r->end - r->pos) / sizeof(CacheLed) < count)
+                {
+                        r->ok = false;
+                        g_free(format);
+                        goto _gt_error;
+                }
+
+                LedChain *c = led_chain_new(count, format);
+                g_free(format);
+                if(!c)
+                        goto _gt_error;
+
+                guint32 i;
+                for(i = 0; i < count; i++)
+                {
+                        CacheLed cl;
+                        _get(r, &cl, sizeof(cl));
+
+                        Led *l = led_chain_get_nth(c, i);
+                        led_set_pos(l, cl.x, cl.y);
+                        led_set_component(l, cl.component);
+                        led_set_gain(l, cl.gain);
+                }
+
+                led_tile_set_chain(t, c);
+        }
+
+        guint32 children = _get_u32(r);
+        guint32 i;
+        for(i = 0; r->ok && i < children; i++)
+        {
+                LedTile *ct;
+                if(!(ct = _get_tile(r, depth + 1)))
+                        goto _gt_error;
+
+                led_tile_list_append_child(t, ct);
+        }
+
+        if(!r->ok)
+                goto _gt_error;
+
+        return t;
+
+_gt_error:
+        led_tile_destroy(t);
+        return NULL;
+}
+
+
+/** append hardware, its plugin properties & tiles */
+static gboolean _put_hardware(GByteArray * b, LedHardware * h)
+{
+        /* the cache always restores initialized hardware */
+        if(!led_hardware_is_initialized(h))
+        {
+                NFT_LOG(L_DEBUG,
+                        "Hardware \"%s\" not initialized, not caching setup",
+                        led_hardware_get_name(h));
+                return false;
+        }
+
+        _put_string(b, led_hardware_get_name(h));
+        _put_string(b, led_hardware_plugin_get_family(h));
+        _put_string(b, led_hardware_get_id(h));
+
+        LedChain *c = led_hardware_get_chain(h);
+        _put_u32(b, led_chain_get_ledcount(c));
+        _put_string(b,
+                    led_pixel_format_to_string(led_chain_get_format(c)));
+        _put_u32(b, led_hardware_get_stride(h));
+
+        /* plugin properties */
+        guint32 props = 0;
+        LedPluginCustomProp *prop;
+        for(prop = led_hardware_plugin_prop_get_nth(h, 0); prop;
+            prop = led_hardware_plugin_prop_get_next(prop))
+                props++;
+
+        _put_u32(b, props);
+        for(prop = led_hardware_plugin_prop_get_nth(h, 0); prop;
+            prop = led_hardware_plugin_prop_get_next(prop))
+        {
+                const char *name = led_hardware_plugin_prop_get_name(prop);
+                _put_string(b, name);
+                _put_u32(b, led_hardware_plugin_prop_get_type(prop));
+
+                switch (led_hardware_plugin_prop_get_type(prop))
+                {
+                        case LED_HW_CUSTOM_PROP_INT:
+                        {
+                                int v = 0;
+                                led_hardware_plugin_prop_get_int(h, name, &v);
+                                _put_i32(b, v);
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_FLOAT:
+                        {
+                                float v = 0;
+                                led_hardware_plugin_prop_get_float(h, name,
+                                                                   &v);
+                                _put_double(b, v);
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_STRING:
+                        {
+                                char *v = NULL;
+                                led_hardware_plugin_prop_get_string(h, name,
+                                                                    &v);
+                                _put_string(b, v);
+                                break;
+                        }
+
+                        default:
+                        {
+                                NFT_LOG(L_DEBUG,
+                                        "Unknown type of property \"%s\", not caching setup",
+                                        name);
+                                return false;
+                        }
+                }
+        }
+
+        /* tiles */
+        guint32 tiles = 0;
+        LedTile *t;
+        for(t = led_hardware_get_tile(h); t; t = led_tile_list_get_next(t))
+                tiles++;
+
+        _put_u32(b, tiles);
+        for(t = led_hardware_get_tile(h); t; t = led_tile_list_get_next(t))
+                _put_tile(b, t);
+
+        return true;
+}
+
+
+/** read hardware, its plugin properties & tiles */
+static LedHardware *_get_hardware(CacheReader * r)
+{
+        LedHardware *h = NULL;
+
+        gchar *name = _get_string(r);
+        gchar *family = _get_string(r);
+        gchar *id = _get_string(r);
+        LedCount ledcount = _get_u32(r);
+        gchar *format = _get_string(r);
+        LedCount stride = _get_u32(r);
+
+        if(!r->ok)
+                goto _gh_exit;
+
+        if(!(h = led_hardware_new(name, family)))
+                goto _gh_exit;
+
+        /* XML will produce the same result for hardware that's not there */
+        if(!led_hardware_init(h, id, ledcount, format))
+        {
+                NFT_LOG(L_INFO,
+                        "Failed to initialize hardware \"%s\", not using cache",
+                        name);
+                goto _gh_error;
+        }
+
+        led_hardware_set_stride(h, stride);
+
+        /* plugin properties */
+        guint32 props = _get_u32(r);
+        guint32 i;
+        for(i = 0; r->ok && i < props; i++)
+        {
+                gchar *prop = _get_string(r);
+
+                switch (_get_u32(r))
+                {
+                        case LED_HW_CUSTOM_PROP_INT:
+                        {
+                                int v = _get_i32(r);
+                                if(r->ok)
+                                        led_hardware_plugin_prop_set_int(h,
+                                                                         prop,
+                                                                         v);
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_FLOAT:
+                        {
+                                float v = _get_double(r);
+                                if(r->ok)
+                                        led_hardware_plugin_prop_set_float(h,
+                                                                           prop,
+                                                                           v);
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_STRING:
+                        {
+                                gchar *v = _get_string(r);
+                                if(r->ok)
+                                        led_hardware_plugin_prop_set_string
+                                                (h, prop, v);
+                                g_free(v);
+                                break;
+                        }
+
+                        default:
+                        {
+                                r->ok = false;
+                                break;
+                        }
+                }
+
+                g_free(prop);
+        }
+
+        /* tiles */
+        guint32 tiles = _get_u32(r);
+        for(i = 0; r->ok && i < tiles; i++)
+        {
+                LedTile *t;
+                if(!(t = _get_tile(r, 0)))
+                        goto _gh_error;
+
+                LedTile *first;
+                if(!(first = led_hardware_get_tile(h)))
+                        led_hardware_set_tile(h, t);
+                else
+                        led_tile_list_append_head(first, t);
+        }
+
+        if(!r->ok)
+                goto _gh_error;
+
+_gh_exit:
+        g_free(format);
+        g_free(id);
+        g_free(family);
+        g_free(name);
+        return h;
+
+_gh_error:
+        led_hardware_destroy(h);
+        h = NULL;
+        goto _gh_exit;
+}
+
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/** name of cache file belonging to a setup file (free with g_free()) */
+gchar *cache_filename(const char *filename)
+{
+        if(!filename)
+                NFT_LOG_NULL(NULL);
+
+        return g_strdup_printf("%s.cache", filename);
+}
+
+
+/**
+ * record state of a setup file from the stat taken before reading it and
+ * the data that was read (the file might change while it's parsed)
+ */
+gboolean cache_stamp(CacheStamp * stamp, const struct stat *sts,
+                     const gchar * buf, gsize length)
+{
+        if(!stamp || !sts || !buf)
+                NFT_LOG_NULL(false);
+
+        stamp->size = (guint64) sts->st_size;
+        stamp->mtime = (gint64) sts->st_mtim.tv_sec *
+                G_GINT64_CONSTANT(1000000000) + sts->st_mtim.tv_nsec;
+
+        return _checksum(buf, length, stamp->checksum);
+}
+
+
+/**
+ * restore setup from the cache of a setup file
+ *
+ * @result newly created setup or NULL if there's no valid cache
+ */
+LedSetup *cache_load(const char *filename)
+{
+        if(!filename)
+                NFT_LOG_NULL(NULL);
+
+        LedSetup *s = NULL;
+
+        gchar *cachefile = cache_filename(filename);
+        GMappedFile *m;
+        if(!(m = g_mapped_file_new(cachefile, false, NULL)))
+        {
+                NFT_LOG(L_DEBUG, "No cache for \"%s\"", filename);
+                g_free(cachefile);
+                return NULL;
+        }
+
+        CacheReader r = {
+                .pos = (const guint8 *) g_mapped_file_get_contents(m),
+                .ok = true,
+        };
+        r.end = r.pos + g_mapped_file_get_length(m);
+
+        CacheHeader h;
+        _get(&r, &h, sizeof(h));
+        if(!r.ok ||
+           memcmp(h.magic, CACHE_MAGIC, sizeof(h.magic)) != 0 ||
+           h.version != CACHE_VERSION || h.byte_order != CACHE_BYTE_ORDER)
+        {
+                NFT_LOG(L_INFO, "Ignoring incompatible cache \"%s\"",
+                        cachefile);
+                goto _cl_exit;
+        }
+
+        /* cache still up to date? (check cheap stat first) */
+        CacheHeader now;
+        if(!_stamp_stat(filename, &now) ||
+           now.xml_size != h.xml_size || now.xml_mtime != h.xml_mtime ||
+           !_stamp_checksum(filename, &now) ||
+           memcmp(now.xml_checksum, h.xml_checksum,
+                  CACHE_CHECKSUM_LENGTH) != 0)
+        {
+                NFT_LOG(L_INFO, "Cache \"%s\" is stale", cachefile);
+                goto _cl_exit;
+        }
+
+        if(!(s = led_setup_new()))
+                goto _cl_exit;
+
+        LedHardware *last = NULL;
+        guint32 i;
+        for(i = 0; i < h.hardware; i++)
+        {
+                LedHardware *hw;
+                if(!(hw = _get_hardware(&r)))
+                        goto _cl_error;
+
+                if(!last)
+                        led_setup_set_hardware(s, hw);
+                else
+                        led_hardware_list_append_head(last, hw);
+                last = hw;
+        }
+
+        /* trailing garbage? */
+        if(r.pos != r.end)
+                goto _cl_error;
+
+        NFT_LOG(L_INFO, "Restored \"%s\" from cache", filename);
+
+_cl_exit:
+        g_mapped_file_unref(m);
+        g_free(cachefile);
+        return s;
+
+_cl_error:
+        NFT_LOG(L_WARNING, "Failed to restore setup from \"%s\"", cachefile);
+        led_setup_destroy(s);
+        s = NULL;
+        goto _cl_exit;
+}
+
+
+/**
+ * write cache of setup that was just loaded from a setup file
+ * (stamp describes the data the setup was parsed from)
+ */
+NftResult cache_save(LedSetup * s, const char *filename,
+                     const CacheStamp * stamp)
+{
+        if(!s || !filename || !stamp)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        CacheHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+        h.version = CACHE_VERSION;
+        h.byte_order = CACHE_BYTE_ORDER;
+
+        h.xml_size = stamp->size;
+        h.xml_mtime = stamp->mtime;
+        memcpy(h.xml_checksum, stamp->checksum, CACHE_CHECKSUM_LENGTH);
+
+        LedHardware *hw;
+        for(hw = led_setup_get_hardware(s); hw;
+            hw = led_hardware_list_get_next(hw))
+                h.hardware++;
+
+        GByteArray *b = g_byte_array_new();
+        _put(b, &h, sizeof(h));
+
+        for(hw = led_setup_get_hardware(s); hw;
+            hw = led_hardware_list_get_next(hw))
+        {
+                if(!_put_hardware(b, hw))
+                {
+                        g_byte_array_free(b, true);
+                        return NFT_FAILURE;
+                }
+        }
+
+        /* written to temporary file & renamed */
+        gchar *cachefile = cache_filename(filename);
+        GError *err = NULL;
+        gboolean result = g_file_set_contents(cachefile,
+                                              (const gchar *) b->data,
+                                              b->len, &err);
+        if(!result)
+        {
+                NFT_LOG(L_WARNING, "Failed to write cache \"%s\" - %s",
+                        cachefile, err->message);
+                g_error_free(err);
+        }
+
+        g_free(cachefile);
+        g_byte_array_free(b, true);
+
+        return result ? NFT_SUCCESS : NFT_FAILURE;
+}
@@ -45,11 +45,16 @@
 #include "ui/ui.h"
 #include "ui/ui-log.h"
 #include "ui/ui-setup-props.h"
+#include "ui/ui-setup-ledlist.h"
+#include "ui/ui-setup-tree.h"
 #include "live-preview/live-preview.h"
 #include "elements/element-led.h"
 #include "elements/element-chain.h"
 #include "elements/element-setup.h"
 #include "renderer/renderer-chain.h"
+#include "selection/selection.h"
+#include "validator/validator.h"
+#include "undo/undo.h"
 
 
 
@@ -147,12 +152,44 @@ LedChain *chain_niftyled(NiftyconfChain * c)
 }
 
 
+/** copy a niftyled chain including all LED properties */
+LedChain *chain_clone(LedChain * c)
+{
+        LedCount count = led_chain_get_ledcount(c);
+
+        LedChain *n;
+        if(!(n = led_chain_new(count,
+                               led_pixel_format_to_string
+                               (led_chain_get_format(c)))))
+                return NULL;
+
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                Led *src = led_chain_get_nth(c, i);
+                Led *dst = led_chain_get_nth(n, i);
+
+                LedFrameCord x, y;
+                led_get_pos(src, &x, &y);
+                led_set_pos(dst, x, y);
+                led_set_component(dst, led_get_component(src));
+                led_set_gain(dst, led_get_gain(src));
+        }
+
+        return n;
+}
+
+
 /** unregister all LEDs of a chain */
 void chain_unregister_leds_from_gui(NiftyconfChain * c)
 {
         if(!c)
                 NFT_LOG_NULL();
 
+        /* LEDs can't stay selected or listed */
+        selection_forget_chain(c);
+        ui_setup_ledlist_forget_chain(c);
+
         /* free all LEDs of chain */
         if(c->c)
         {
@@ -164,6 +201,9 @@ void chain_unregister_leds_from_gui(NiftyconfChain * c)
                         led_unregister_from_gui(led);
                 }
         }
+
+        /* chain can't have problems without LEDs */
+        validator_forget_chain(c);
 }
 
 /** register all LEDs of a chain */
@@ -178,6 +218,30 @@ void chain_register_leds_to_gui(NiftyconfChain * c)
 }
 
 
+/** change amount of LEDs of a chain (all LEDs get re-registered) */
+NftResult chain_set_ledcount(NiftyconfChain * c, LedCount ledcount)
+{
+        if(!c)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        chain_unregister_leds_from_gui(c);
+
+        /* is this the chain of a hardware element? */
+        NftResult r = NFT_SUCCESS;
+        LedHardware *h;
+        if((h = led_chain_get_parent_hardware(c->c)))
+                r = led_hardware_set_ledcount(h, ledcount);
+
+        if(r)
+                r = led_chain_set_ledcount(c->c, ledcount);
+
+        /* re-register (less or more) LEDs in chain */
+        chain_register_leds_to_gui(c);
+
+        return r;
+}
+
+
 /** allocate new element */
 NiftyconfChain *chain_register_to_gui(LedChain * c)
 {
@@ -228,6 +292,9 @@ void chain_unregister_from_gui(NiftyconfChain * c)
 
         led_chain_set_privdata(c->c, NULL);
 
+        /* recorded edits wait for re-creation of this chain */
+        undo_forget(c);
+
         free(c);
 }
 
@@ -261,13 +328,19 @@ gboolean chain_of_tile_new(NIFTYLED_TYPE parent_t,
         led_tile_set_chain(tile, n);
 
         /* register chain to gui */
-        if(!chain_register_to_gui(n))
+        NiftyconfChain *chain;
+        if(!(chain = chain_register_to_gui(n)))
         {
                 ui_log_alert_show
                         ("Failed to register new chain to GUI. This is a bug. Expect the unexpected.");
                 return false;
         }
 
+        /* add row to setup-tree */
+        ui_setup_tree_element_inserted(LED_CHAIN_T, chain);
+
+        undo_record_insert(LED_CHAIN_T, chain);
+
         return true;
 }
 
@@ -283,13 +356,21 @@ void chain_of_tile_destroy(NiftyconfTile * tile)
         if(!(c = led_tile_get_chain(t)))
                 return;
 
+        NiftyconfChain *chain = led_chain_get_privdata(c);
+        undo_record_remove(LED_CHAIN_T, chain);
+
+        /* remember row in setup-tree */
+        GtkTreePath *path = ui_setup_tree_element_removing(LED_CHAIN_T, chain);
+
         /* unregister from tile */
         led_tile_set_chain(t, NULL);
 
         /* unregister from gui */
-        NiftyconfChain *chain = led_chain_get_privdata(c);
         chain_unregister_from_gui(chain);
         led_chain_destroy(c);
+
+        /* remove row from setup-tree */
+        ui_setup_tree_element_deleted(path);
 }
 
 
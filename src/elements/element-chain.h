@@ -57,6 +57,7 @@ NiftyconfChain                 *chain_register_to_gui(LedChain * c);
 void                            chain_unregister_from_gui(NiftyconfChain * c);
 void                            chain_register_leds_to_gui(NiftyconfChain * c);
 void                            chain_unregister_leds_from_gui(NiftyconfChain * c);
+NftResult                       chain_set_ledcount(NiftyconfChain * c, LedCount ledcount);
 gboolean                        chain_of_tile_new(NIFTYLED_TYPE parent_t, gpointer parent_element, LedCount length, const char *pixelformat);
 void                            chain_of_tile_destroy(NiftyconfTile * tile);
 
@@ -69,6 +70,7 @@ NiftyconfRenderer              *chain_get_renderer(NiftyconfChain * c);
 
 /* model functions */
 LedChain                       *chain_niftyled(NiftyconfChain * c);
+LedChain                       *chain_clone(LedChain * c);
 char                           *chain_dump(NiftyconfChain * chain, gboolean encapsulation);
 
 
@@ -46,7 +46,9 @@
 #include "elements/element-chain.h"
 #include "elements/element-setup.h"
 #include "ui/ui-log.h"
+#include "ui/ui-setup-tree.h"
 #include "live-preview/live-preview.h"
+#include "undo/undo.h"
 
 
 
@@ -155,6 +157,43 @@ LedHardware *hardware_niftyled(NiftyconfHardware * h)
 }
 
 
+/**
+ * position of hardware among all hardware of the setup (0 = first)
+ */
+guint hardware_get_position(NiftyconfHardware * h)
+{
+        guint pos = 0;
+        LedHardware *p;
+        for(p = led_hardware_list_get_prev(hardware_niftyled(h)); p;
+            p = led_hardware_list_get_prev(p))
+                pos++;
+
+        return pos;
+}
+
+
+/**
+ * move hardware towards the start of the setup until it's at position
+ */
+gboolean hardware_set_position(NiftyconfHardware * h, guint pos)
+{
+        LedHardware *hw = hardware_niftyled(h);
+        guint cur = hardware_get_position(h);
+
+        for(; cur > pos; cur--)
+        {
+                if(!led_hardware_list_swap(led_hardware_list_get_prev(hw), hw))
+                {
+                        NFT_LOG(L_WARNING, "Failed to move hardware \"%s\"",
+                                led_hardware_get_name(hw));
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+
 /**
  * allocate new hardware element for GUI
  */
@@ -225,6 +264,9 @@ void hardware_unregister_from_gui(NiftyconfHardware * h)
 
         led_hardware_set_privdata(h->h, NULL);
 
+        /* recorded edits wait for re-creation of this hardware */
+        undo_forget(h);
+
         free(h);
 }
 
@@ -257,6 +299,11 @@ NiftyconfHardware *hardware_register_to_gui_and_niftyled(LedHardware * h)
                 led_hardware_list_append_head(last, h);
         }
 
+        /* add row to setup-tree */
+        ui_setup_tree_element_inserted(LED_HARDWARE_T, hardware);
+
+        undo_record_insert(LED_HARDWARE_T, hardware);
+
         return hardware;
 }
 
@@ -299,10 +346,18 @@ void hardware_destroy(NiftyconfHardware * hw)
 {
         LedHardware *h = hardware_niftyled(hw);
 
+        undo_record_remove(LED_HARDWARE_T, hw);
+
+        /* remember row in setup-tree */
+        GtkTreePath *path = ui_setup_tree_element_removing(LED_HARDWARE_T, hw);
+
         /* unregister hardware */
         hardware_unregister_from_gui(hw);
 
         led_hardware_destroy(h);
+
+        /* remove row from setup-tree */
+        ui_setup_tree_element_deleted(path);
 }
 
 
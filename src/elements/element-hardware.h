@@ -68,6 +68,8 @@ void                            hardware_set_collapsed(NiftyconfHardware * h, gb
 
 /* model functions */
 LedHardware                    *hardware_niftyled(NiftyconfHardware * h);
+guint                           hardware_get_position(NiftyconfHardware * h);
+gboolean                        hardware_set_position(NiftyconfHardware * h, guint pos);
 char                           *hardware_dump(NiftyconfHardware * h, gboolean encapsulation);
 
 
@@ -47,6 +47,7 @@
 #include "renderer/renderer.h"
 #include "renderer/renderer-led.h"
 #include "live-preview/live-preview.h"
+#include "spatial-index/spatial-index.h"
 
 
 /** one element */
@@ -62,6 +63,8 @@ struct _NiftyconfLed
         NiftyconfChain *chain;
                 /** position of this Led inside its chain */
         LedCount pos;
+                /** ValidatorProblem flags of this LED */
+        guint problems;
 };
 
 
@@ -133,6 +136,30 @@ void led_set_highlighted(NiftyconfLed * l, gboolean is_highlighted)
 }
 
 
+/** getter for problems found by validator */
+guint led_get_problems(NiftyconfLed * l)
+{
+        if(!l)
+                NFT_LOG_NULL(0);
+
+        return l->problems;
+}
+
+
+/** setter for problems found by validator */
+void led_set_problems(NiftyconfLed * l, guint problems)
+{
+        if(!l)
+                NFT_LOG_NULL();
+
+        if(l->problems == problems)
+                return;
+
+        l->problems = problems;
+        renderer_led_damage(l);
+}
+
+
 /**
  * getter for libniftyled object
  */
@@ -197,6 +224,9 @@ NiftyconfLed *led_register_to_gui(Led * l,
         /* register descriptor as niftyled privdata */
         led_set_privdata(l, n);
 
+        /* add to spatial index */
+        spatial_index_update_led(n);
+
         return n;
 }
 
@@ -209,6 +239,9 @@ void led_unregister_from_gui(NiftyconfLed * l)
         if(!l)
                 return;
 
+        /* remove from spatial index */
+        spatial_index_remove_led(l);
+
         /* destroy renderer of this tile */
         renderer_destroy(l->renderer);
 
@@ -60,6 +60,8 @@ void                            led_set_highlighted(NiftyconfLed * l, gboolean i
 NiftyconfRenderer              *led_get_renderer(NiftyconfLed * l);
 NiftyconfChain                 *led_get_chain(NiftyconfLed * l);
 LedCount                        led_get_chainpos(NiftyconfLed * l);
+guint                           led_get_problems(NiftyconfLed * l);
+void                            led_set_problems(NiftyconfLed * l, guint problems);
 
 Led                            *led_niftyled(NiftyconfLed * l);
 char                           *led_dump(NiftyconfLed * led, gboolean encapsulation);
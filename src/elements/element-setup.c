@@ -53,6 +53,7 @@
 #include "ui/ui-log.h"
 #include "renderer/renderer.h"
 #include "renderer/renderer-setup.h"
+#include "undo/undo.h"
 
 
 
@@ -153,9 +154,16 @@ NftResult setup_register_to_gui(LedSetup * s)
         if(!s)
                 NFT_LOG_NULL(NFT_FAILURE);
 
+        /* edits of previous setup can't be undone anymore */
+        undo_clear();
+
         /* previous setup? */
         if(_setup)
+        {
+                /* setup-tree must not access old setup anymore */
+                ui_setup_tree_clear();
                 _unregister();
+        }
 
         /* initialize our element descriptor and set as privdata in niftyled
          * model */
@@ -163,32 +171,12 @@ NftResult setup_register_to_gui(LedSetup * s)
         for(h = led_setup_get_hardware(s);
             h; h = led_hardware_list_get_next(h))
         {
-                /* create new hardware element */
+                /* create new hardware element (also registers chain & tiles) */
                 if(!hardware_register_to_gui(h))
                 {
                         g_warning("failed to allocate new hardware element");
                         return false;
                 }
-
-                /* create chain of this hardware */
-                if(!chain_register_to_gui(led_hardware_get_chain(h)))
-                {
-                        g_warning("failed to allocate new chain element");
-                        return false;
-                }
-
-                /* walk all tiles belonging to this hardware & initialize */
-                LedTile *t;
-                for(t = led_hardware_get_tile(h);
-                    t; t = led_tile_list_get_next(t))
-                {
-                        if(!tile_register_to_gui(t))
-                        {
-                                g_warning
-                                        ("failed to allocate new tile element");
-                                return false;
-                        }
-                }
         }
 
         /* save new setup */
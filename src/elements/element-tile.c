@@ -41,6 +41,7 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <math.h>
 #include <gtk/gtk.h>
 #include "elements/element-chain.h"
 #include "elements/element-tile.h"
@@ -48,6 +49,8 @@
 #include "renderer/renderer.h"
 #include "renderer/renderer-tile.h"
 #include "live-preview/live-preview.h"
+#include "ui/ui-setup-tree.h"
+#include "undo/undo.h"
 
 
 
@@ -116,6 +119,101 @@ gboolean tile_calc_render_offset(NiftyconfTile * t,
         return true;
 }
 
+/**
+ * transform point from tile-local coordinates to setup coordinates
+ * (applies position, rotation & pivot of the tile and all its parents)
+ */
+void tile_local_to_world(LedTile * t, double *x, double *y)
+{
+        if(!x || !y)
+                NFT_LOG_NULL();
+
+        for(; t; t = led_tile_get_parent_tile(t))
+        {
+                LedFrameCord tX, tY;
+                led_tile_get_pos(t, &tX, &tY);
+                double pX, pY;
+                led_tile_get_pivot(t, &pX, &pY);
+                double r = led_tile_get_rotation(t);
+
+                /* rotate around pivot, then translate to tile position */
+                double dX = *x - pX;
+                double dY = *y - pY;
+                *x = (double) tX + pX + dX * cos(r) - dY * sin(r);
+                *y = (double) tY + pY + dX * sin(r) + dY * cos(r);
+        }
+}
+
+
+/**
+ * transform point from setup coordinates to tile-local coordinates
+ * (inverse of tile_local_to_world())
+ */
+void tile_world_to_local(LedTile * t, double *x, double *y)
+{
+        if(!t || !x || !y)
+                NFT_LOG_NULL();
+
+        /* transform into coordinates of parent tile first */
+        LedTile *parent;
+        if((parent = led_tile_get_parent_tile(t)))
+                tile_world_to_local(parent, x, y);
+
+        LedFrameCord tX, tY;
+        led_tile_get_pos(t, &tX, &tY);
+        double pX, pY;
+        led_tile_get_pivot(t, &pX, &pY);
+        double r = led_tile_get_rotation(t);
+
+        /* undo translation, then rotate back around pivot */
+        double dX = *x - (double) tX - pX;
+        double dY = *y - (double) tY - pY;
+        *x = pX + dX * cos(r) + dY * sin(r);
+        *y = pY - dX * sin(r) + dY * cos(r);
+}
+
+
+/** copy a niftyled tile including its chain and all child tiles */
+LedTile *tile_clone(LedTile * t)
+{
+        LedTile *n;
+        if(!(n = led_tile_new()))
+                return NULL;
+
+        LedFrameCord x, y;
+        led_tile_get_pos(t, &x, &y);
+        led_tile_set_pos(n, x, y);
+        double pX, pY;
+        led_tile_get_pivot(t, &pX, &pY);
+        led_tile_set_pivot(n, pX, pY);
+        led_tile_set_rotation(n, led_tile_get_rotation(t));
+
+        LedChain *c;
+        if((c = led_tile_get_chain(t)))
+        {
+                LedChain *nc;
+                if(!(nc = chain_clone(c)))
+                        goto _tc_error;
+                led_tile_set_chain(n, nc);
+        }
+
+        LedTile *ct;
+        for(ct = led_tile_get_child(t); ct; ct = led_tile_list_get_next(ct))
+        {
+                LedTile *nct;
+                if(!(nct = tile_clone(ct)))
+                        goto _tc_error;
+                led_tile_list_append_child(n, nct);
+        }
+
+        return n;
+
+_tc_error:
+        led_tile_destroy(n);
+        return NULL;
+}
+
+
 /** dump element definition to printable string - use free() to deallacote the result */
 char *tile_dump(NiftyconfTile * tile, gboolean encapsulation)
 {
@@ -210,6 +308,42 @@ LedTile *tile_niftyled(NiftyconfTile * t)
 }
 
 
+/**
+ * position of tile among its siblings (0 = first)
+ */
+guint tile_get_position(NiftyconfTile * t)
+{
+        guint pos = 0;
+        LedTile *p;
+        for(p = led_tile_list_get_prev(tile_niftyled(t)); p;
+            p = led_tile_list_get_prev(p))
+                pos++;
+
+        return pos;
+}
+
+
+/**
+ * move tile towards the start of its sibling list until it's at position
+ */
+gboolean tile_set_position(NiftyconfTile * t, guint pos)
+{
+        LedTile *tile = tile_niftyled(t);
+        guint cur = tile_get_position(t);
+
+        for(; cur > pos; cur--)
+        {
+                if(!led_tile_list_swap(led_tile_list_get_prev(tile), tile))
+                {
+                        NFT_LOG(L_WARNING, "Failed to move tile");
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+
 /**
  * allocate new element
  */
@@ -297,6 +431,9 @@ void tile_unregister_from_gui(NiftyconfTile * t)
         /* destroy renderer of this tile */
         renderer_destroy(t->renderer);
 
+        /* recorded edits wait for re-creation of this tile */
+        undo_forget(t);
+
         free(t);
 }
 
@@ -324,7 +461,14 @@ gboolean tile_of_hardware_new(NiftyconfHardware * parent)
         }
 
         /* register new tile to gui */
-        tile_register_to_gui(n);
+        NiftyconfTile *t;
+        if(!(t = tile_register_to_gui(n)))
+                return false;
+
+        /* add row to setup-tree */
+        ui_setup_tree_element_inserted(LED_TILE_T, t);
+
+        undo_record_insert(LED_TILE_T, t);
 
         return true;
 }
@@ -342,7 +486,14 @@ gboolean tile_of_tile_new(NiftyconfTile * parent)
         led_tile_list_append_child(tile, n);
 
         /* register new tile to gui */
-        tile_register_to_gui(n);
+        NiftyconfTile *t;
+        if(!(t = tile_register_to_gui(n)))
+                return false;
+
+        /* add row to setup-tree */
+        ui_setup_tree_element_inserted(LED_TILE_T, t);
+
+        undo_record_insert(LED_TILE_T, t);
 
         return true;
 }
@@ -356,11 +507,19 @@ void tile_destroy(NiftyconfTile * tile)
 
         LedTile *t = tile_niftyled(tile);
 
+        undo_record_remove(LED_TILE_T, tile);
+
+        /* remember row in setup-tree */
+        GtkTreePath *path = ui_setup_tree_element_removing(LED_TILE_T, tile);
+
         /* unregister from gui */
         tile_unregister_from_gui(tile);
 
         /* destroy with all children */
         led_tile_destroy(t);
+
+        /* remove row from setup-tree */
+        ui_setup_tree_element_deleted(path);
 }
 
 
@@ -72,8 +72,13 @@ void                            tile_set_highlighted(NiftyconfTile * t, gboolean
 
 /* model functions */
 gboolean                        tile_calc_render_offset(NiftyconfTile * t, double screenWidth, double screenHeight, double *xOff, double *yOff);
+void                            tile_local_to_world(LedTile * t, double *x, double *y);
+void                            tile_world_to_local(LedTile * t, double *x, double *y);
 NiftyconfRenderer              *tile_get_renderer(NiftyconfTile * t);
 LedTile                        *tile_niftyled(NiftyconfTile * t);
+guint                           tile_get_position(NiftyconfTile * t);
+gboolean                        tile_set_position(NiftyconfTile * t, guint pos);
+LedTile                        *tile_clone(LedTile * t);
 char                           *tile_dump(NiftyconfTile * tile, gboolean encapsulation);
 
 
@@ -0,0 +1,646 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "elements/element-tile.h"
+#include "export/export.h"
+#include "niftyconf.h"
+
+
+/**
+ * The exporters walk the niftyled setup once and write every LED as it's
+ * visited, so memory usage doesn't depend on the size of the setup.
+ *
+ * Geometry export: positions are the centers of LEDs in setup
+ * coordinates (with all tile transformations applied). LEDs are
+ * identified by the index of their hardware in the setup, the index of
+ * their chain in the hardware (tiles in depth-first order) and their
+ * index in that chain.
+ *
+ * Mapping export: the hardware chains as resolved by
+ * led_hardware_list_refresh_mapping(), i.e. for every position of every
+ * hardware chain the frame pixel & component it shows and its gain. The
+ * file is laid out so it can be mapped into memory and used directly:
+ *
+ *      MappingHeader
+ *      MappingHardware[hardware]
+ *      strings (NUL terminated)
+ *      MappingLed[ledcount] of every hardware (8-byte aligned)
+ */
+
+
+/** size of stdio buffer for export file */
+#define EXPORT_BUFFER_SIZE      (64*1024)
+/** identifies a binary export file */
+#define EXPORT_MAGIC            "NFTGEOM"
+/** increase whenever the binary record layout changes */
+#define EXPORT_VERSION          1
+
+
+/** start of binary export file (little-endian) */
+typedef struct
+{
+        char magic[8];
+        guint32 version;
+        /** size of one ExportRecord */
+        guint32 record_size;
+        /** amount of records following the header */
+        guint64 count;
+} ExportHeader;
+
+
+/** one LED in binary export file (little-endian) */
+typedef struct
+{
+        guint32 hardware;
+        guint32 chain;
+        guint32 led;
+        /** position as IEEE 754 single precision */
+        guint32 x, y;
+        guint32 component;
+        guint32 gain;
+} ExportRecord;
+
+
+/** identifies a mapping file */
+#define MAPPING_MAGIC           "NFTMAP"
+/** increase whenever the mapping file layout changes */
+#define MAPPING_VERSION         1
+/** alignment of LED tables in mapping file */
+#define MAPPING_ALIGN           8
+/** amount of strings stored per hardware in mapping file */
+#define MAPPING_STRINGS         4
+
+
+/** start of mapping file (little-endian) */
+typedef struct
+{
+        char magic[8];
+        guint32 version;
+        /** amount of MappingHardware entries following the header */
+        guint32 hardware;
+        /** dimensions of frame the setup maps */
+        guint32 width, height;
+        guint32 reserved[2];
+} MappingHeader;
+
+
+/** one hardware in mapping file (little-endian, offsets from file start) */
+typedef struct
+{
+        /** offsets of name, plugin family, id & pixel-format strings */
+        guint32 name, family, id, pixelformat;
+        guint32 ledcount;
+        guint32 stride;
+        /** offset of ledcount MappingLed entries */
+        guint64 leds;
+} MappingHardware;
+
+
+/** one position of a hardware chain in mapping file (little-endian) */
+typedef struct
+{
+        /** frame pixel (may be outside of frame) */
+        gint32 x, y;
+        /** component of pixel */
+        guint16 component;
+        guint16 gain;
+} MappingLed;
+
+
+/** state while exporting */
+typedef struct
+{
+        FILE *f;
+        ExportFormat format;
+        /** amount of LEDs written */
+        guint64 count;
+} ExportWriter;
+
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** open temporary file next to filename (tmp is set to its name) */
+static FILE *_open_tmp(const char *filename, gchar ** tmp)
+{
+        /* keep permissions of old file, new files get default ones */
+        struct stat sts;
+        mode_t mode;
+        if(stat(filename, &sts) == 0)
+        {
+                mode = sts.st_mode & 07777;
+        }
+        else
+        {
+                mode = niftyconf_file_mode();
+        }
+
+        *tmp = g_strdup_printf("%s.XXXXXX", filename);
+
+        int fd;
+        if((fd = g_mkstemp(*tmp)) == -1)
+        {
+                NFT_LOG(L_ERROR, "Failed to create \"%s\" - %s",
+                        *tmp, strerror(errno));
+                g_free(*tmp);
+                return NULL;
+        }
+
+        FILE *f;
+        if(fchmod(fd, mode) == -1 || !(f = fdopen(fd, "w")))
+        {
+                NFT_LOG(L_ERROR, "Failed to open \"%s\" - %s",
+                        *tmp, strerror(errno));
+                close(fd);
+                unlink(*tmp);
+                g_free(*tmp);
+                return NULL;
+        }
+        setvbuf(f, NULL, _IOFBF, EXPORT_BUFFER_SIZE);
+
+        return f;
+}
+
+
+/** make rename of a file in directory of filename durable */
+static void _sync_dir(const char *filename)
+{
+        gchar *dir = g_path_get_dirname(filename);
+
+        int fd;
+        if((fd = open(dir, O_RDONLY | O_DIRECTORY)) == -1 || fsync(fd) == -1)
+                NFT_LOG(L_WARNING, "Failed to sync directory \"%s\" - %s",
+                        dir, strerror(errno));
+        if(fd != -1)
+                close(fd);
+
+        g_free(dir);
+}
+
+
+/** close temporary file & replace filename with it (frees tmp) */
+static gboolean _close_tmp(FILE * f, gchar * tmp, const char *filename)
+{
+        /* data must be on disk before it replaces the old file */
+        gboolean failed = ferror(f) || fflush(f) != 0 || fsync(fileno(f)) != 0;
+        if(fclose(f) != 0 || failed)
+        {
+                NFT_LOG(L_ERROR, "Failed to write \"%s\" - %s",
+                        tmp, strerror(errno));
+                goto _ct_error;
+        }
+
+        if(rename(tmp, filename) == -1)
+        {
+                NFT_LOG(L_ERROR, "Failed to rename \"%s\" to \"%s\" - %s",
+                        tmp, filename, strerror(errno));
+                goto _ct_error;
+        }
+
+        _sync_dir(filename);
+
+        g_free(tmp);
+        return true;
+
+_ct_error:
+        unlink(tmp);
+        g_free(tmp);
+        return false;
+}
+
+
+/** little-endian representation of a float */
+static guint32 _float_to_le(float v)
+{
+        union
+        {
+                float f;
+                guint32 u;
+        } c = {.f = v };
+
+        return GUINT32_TO_LE(c.u);
+}
+
+
+/** write one LED */
+static void _write_led(ExportWriter * w, guint32 hardware, guint32 chain,
+                       guint32 led, double x, double y,
+                       LedFrameComponent component, LedGain gain)
+{
+        switch (w->format)
+        {
+                case EXPORT_CSV:
+                case EXPORT_JSON:
+                {
+                        /* independent of current locale */
+                        gchar sx[G_ASCII_DTOSTR_BUF_SIZE];
+                        gchar sy[G_ASCII_DTOSTR_BUF_SIZE];
+                        g_ascii_formatd(sx, sizeof(sx), "%.3f", x);
+                        g_ascii_formatd(sy, sizeof(sy), "%.3f", y);
+
+                        if(w->format == EXPORT_CSV)
+                                fprintf(w->f, "%u,%u,%u,%s,%s,%u,%u\n",
+                                        hardware, chain, led, sx, sy,
+                                        (unsigned int) component,
+                                        (unsigned int) gain);
+                        else
+                                fprintf(w->f,
+                                        "{\"hardware\":%u,\"chain\":%u,\"led\":%u,"
+                                        "\"x\":%s,\"y\":%s,"
+                                        "\"component\":%u,\"gain\":%u}\n",
+                                        hardware, chain, led, sx, sy,
+                                        (unsigned int) component,
+                                        (unsigned int) gain);
+                        break;
+                }
+
+                case EXPORT_BINARY:
+                {
+                        ExportRecord r = {
+                                .hardware = GUINT32_TO_LE(hardware),
+                                .chain = GUINT32_TO_LE(chain),
+                                .led = GUINT32_TO_LE(led),
+                                .x = _float_to_le((float) x),
+                                .y = _float_to_le((float) y),
+                                .component = GUINT32_TO_LE(component),
+                                .gain = GUINT32_TO_LE(gain),
+                        };
+                        fwrite(&r, sizeof(r), 1, w->f);
+                        break;
+                }
+
+                default:
+                        break;
+        }
+
+        w->count++;
+}
+
+
+/** write all LEDs of the chain of a tile */
+static void _write_chain(ExportWriter * w, LedTile * t, LedChain * c,
+                         guint32 hardware, guint32 chain)
+{
+        /* tile transformation is affine, transform unit vectors once */
+        double oX = 0, oY = 0;
+        tile_local_to_world(t, &oX, &oY);
+        double xX = 1, xY = 0;
+        tile_local_to_world(t, &xX, &xY);
+        double yX = 0, yY = 1;
+        tile_local_to_world(t, &yX, &yY);
+        xX -= oX;
+        xY -= oY;
+        yX -= oX;
+        yY -= oY;
+
+        LedCount count = led_chain_get_ledcount(c);
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                Led *l = led_chain_get_nth(c, i);
+
+                LedFrameCord lX, lY;
+                led_get_pos(l, &lX, &lY);
+
+                /* center of LED */
+                double x = (double) lX + 0.5;
+                double y = (double) lY + 0.5;
+
+                _write_led(w, hardware, chain, (guint32) i,
+                           oX + x * xX + y * yX, oY + x * xY + y * yY,
+                           led_get_component(l), led_get_gain(l));
+        }
+}
+
+
+/** write LEDs of a list of tiles and all their children */
+static void _write_tiles(ExportWriter * w, LedTile * t, guint32 hardware,
+                         guint32 * chain)
+{
+        for(; t; t = led_tile_list_get_next(t))
+        {
+                LedChain *c;
+                if((c = led_tile_get_chain(t)))
+                        _write_chain(w, t, c, hardware, (*chain)++);
+
+                _write_tiles(w, led_tile_get_child(t), hardware, chain);
+        }
+}
+
+
+/** write start of file */
+static void _write_header(ExportWriter * w)
+{
+        switch (w->format)
+        {
+                case EXPORT_CSV:
+                {
+                        fprintf(w->f, "hardware,chain,led,x,y,component,gain\n");
+                        break;
+                }
+
+                case EXPORT_BINARY:
+                {
+                        /* count is filled in when finished */
+                        ExportHeader h;
+                        memset(&h, 0, sizeof(h));
+                        memcpy(h.magic, EXPORT_MAGIC, sizeof(EXPORT_MAGIC));
+                        h.version = GUINT32_TO_LE(EXPORT_VERSION);
+                        h.record_size = GUINT32_TO_LE(sizeof(ExportRecord));
+                        fwrite(&h, sizeof(h), 1, w->f);
+                        break;
+                }
+
+                default:
+                        break;
+        }
+}
+
+
+/** write end of file */
+static void _write_footer(ExportWriter * w)
+{
+        if(w->format != EXPORT_BINARY)
+                return;
+
+        guint64 count = GUINT64_TO_LE(w->count);
+        if(fseek(w->f, G_STRUCT_OFFSET(ExportHeader, count), SEEK_SET) == 0)
+                fwrite(&count, sizeof(count), 1, w->f);
+}
+
+
+
+/** name, plugin family, id & pixel-format of a hardware */
+static void _hardware_strings(LedHardware * h,
+                              const char *strings[MAPPING_STRINGS])
+{
+        strings[0] = led_hardware_get_name(h);
+        strings[1] = led_hardware_plugin_get_family(h);
+        strings[2] = led_hardware_get_id(h);
+        strings[3] = led_pixel_format_to_string(led_chain_get_format
+                                                (led_hardware_get_chain(h)));
+
+        gint i;
+        for(i = 0; i < MAPPING_STRINGS; i++)
+        {
+                if(!strings[i])
+                        strings[i] = "";
+        }
+}
+
+
+/** round offset up to alignment of LED tables */
+static guint64 _align(guint64 offset)
+{
+        return (offset + MAPPING_ALIGN - 1) / MAPPING_ALIGN * MAPPING_ALIGN;
+}
+
+
+/** write LED table of a hardware chain */
+static void _write_mapping_leds(FILE * f, LedChain * c)
+{
+        LedCount count = led_chain_get_ledcount(c);
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                Led *l = led_chain_get_nth(c, i);
+
+                LedFrameCord x, y;
+                led_get_pos(l, &x, &y);
+
+                MappingLed m = {
+                        .x = GINT32_TO_LE(x),
+                        .y = GINT32_TO_LE(y),
+                        .component = GUINT16_TO_LE(led_get_component(l)),
+                        .gain = GUINT16_TO_LE(led_get_gain(l)),
+                };
+                fwrite(&m, sizeof(m), 1, f);
+        }
+}
+
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/** guess export format from extension of filename (defaults to CSV) */
+ExportFormat export_format_from_filename(const char *filename)
+{
+        if(!filename)
+                NFT_LOG_NULL(EXPORT_CSV);
+
+        if(g_str_has_suffix(filename, ".json") ||
+           g_str_has_suffix(filename, ".jsonl"))
+                return EXPORT_JSON;
+
+        if(g_str_has_suffix(filename, ".bin"))
+                return EXPORT_BINARY;
+
+        return EXPORT_CSV;
+}
+
+
+/**
+ * write position of every LED of a setup to a file, the file is written
+ * next to filename and renamed when complete
+ */
+NftResult export_geometry(LedSetup * s, const char *filename, ExportFormat f)
+{
+        if(!s || !filename)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if((guint) f >= NUM_EXPORT_FORMATS)
+        {
+                NFT_LOG(L_ERROR, "Unknown export format %d", f);
+                return NFT_FAILURE;
+        }
+
+        ExportWriter w = {.format = f };
+        gchar *tmp;
+        if(!(w.f = _open_tmp(filename, &tmp)))
+                return NFT_FAILURE;
+
+        _write_header(&w);
+
+        guint32 hardware = 0;
+        LedHardware *h;
+        for(h = led_setup_get_hardware(s); h;
+            h = led_hardware_list_get_next(h), hardware++)
+        {
+                guint32 chain = 0;
+                _write_tiles(&w, led_hardware_get_tile(h), hardware, &chain);
+        }
+
+        _write_footer(&w);
+
+        if(!_close_tmp(w.f, tmp, filename))
+                return NFT_FAILURE;
+
+        NFT_LOG(L_INFO, "Exported %" G_GUINT64_FORMAT " LEDs to \"%s\"",
+                w.count, filename);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * write resolved frame -> hardware chain mapping of all hardware of a
+ * setup, the file is written next to filename and renamed when complete
+ */
+NftResult export_mapping(LedSetup * s, const char *filename)
+{
+        if(!s || !filename)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        LedHardware *first = led_setup_get_hardware(s);
+
+        /* resolve tile -> chain mapping */
+        if(first && !led_hardware_list_refresh_mapping(first))
+        {
+                NFT_LOG(L_ERROR, "Failed to refresh mapping of hardware");
+                return NFT_FAILURE;
+        }
+
+        MappingHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, MAPPING_MAGIC, sizeof(MAPPING_MAGIC));
+        hdr.version = GUINT32_TO_LE(MAPPING_VERSION);
+
+        LedFrameCord width, height;
+        led_setup_get_dim(s, &width, &height);
+        hdr.width = GUINT32_TO_LE(width);
+        hdr.height = GUINT32_TO_LE(height);
+
+        LedHardware *h;
+        const char *str[MAPPING_STRINGS];
+        guint32 hardware = 0;
+        gsize strings = 0;
+        gint i;
+        for(h = first; h; h = led_hardware_list_get_next(h), hardware++)
+        {
+                _hardware_strings(h, str);
+                for(i = 0; i < MAPPING_STRINGS; i++)
+                        strings += strlen(str[i]) + 1;
+        }
+        hdr.hardware = GUINT32_TO_LE(hardware);
+
+        gchar *tmp;
+        FILE *f;
+        if(!(f = _open_tmp(filename, &tmp)))
+                return NFT_FAILURE;
+
+        fwrite(&hdr, sizeof(hdr), 1, f);
+
+        /* directory (strings & LED tables follow) */
+        guint32 string = sizeof(MappingHeader) +
+                hardware * sizeof(MappingHardware);
+        guint64 leds = _align(string + strings);
+        for(h = first; h; h = led_hardware_list_get_next(h))
+        {
+                _hardware_strings(h, str);
+                guint32 offsets[MAPPING_STRINGS];
+                for(i = 0; i < MAPPING_STRINGS; i++)
+                {
+                        offsets[i] = GUINT32_TO_LE(string);
+                        string += strlen(str[i]) + 1;
+                }
+
+                LedCount count =
+                        led_chain_get_ledcount(led_hardware_get_chain(h));
+
+                MappingHardware m = {
+                        .name = offsets[0],
+                        .family = offsets[1],
+                        .id = offsets[2],
+                        .pixelformat = offsets[3],
+                        .ledcount = GUINT32_TO_LE(count),
+                        .stride = GUINT32_TO_LE(led_hardware_get_stride(h)),
+                        .leds = GUINT64_TO_LE(leds),
+                };
+                fwrite(&m, sizeof(m), 1, f);
+
+                leds = _align(leds + (guint64) count * sizeof(MappingLed));
+        }
+
+        /* strings */
+        for(h = first; h; h = led_hardware_list_get_next(h))
+        {
+                _hardware_strings(h, str);
+                for(i = 0; i < MAPPING_STRINGS; i++)
+                        fwrite(str[i], 1, strlen(str[i]) + 1, f);
+        }
+
+        /* LED tables, each one aligned */
+        static const char zero[MAPPING_ALIGN];
+        guint64 pos = string;
+        for(h = first; h; h = led_hardware_list_get_next(h))
+        {
+                fwrite(zero, 1, _align(pos) - pos, f);
+                pos = _align(pos);
+
+                LedChain *c = led_hardware_get_chain(h);
+                _write_mapping_leds(f, c);
+                pos += (guint64) led_chain_get_ledcount(c) *
+                        sizeof(MappingLed);
+        }
+
+        if(!_close_tmp(f, tmp, filename))
+                return NFT_FAILURE;
+
+        NFT_LOG(L_INFO, "Exported mapping of %u hardware to \"%s\"",
+                hardware, filename);
+
+        return NFT_SUCCESS;
+}
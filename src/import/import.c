@@ -0,0 +1,500 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "ui/ui-setup-tree.h"
+#include "ui/ui-setup-props.h"
+#include "elements/element-setup.h"
+#include "elements/element-tile.h"
+#include "elements/element-chain.h"
+#include "renderer/renderer-chain.h"
+#include "spatial-index/spatial-index.h"
+#include "undo/undo.h"
+#include "import/import.h"
+
+
+/**
+ * Positions are applied while the file is read line by line. A row is
+ * either "x,y" (applied to the LEDs of the target chain in order) or
+ * "hardware,chain,led,x,y" with the indices the geometry export writes.
+ * An optional header line names the columns, then they may appear in any
+ * order and unknown columns are ignored. x/y are setup coordinates of
+ * the LED center (like the export writes them) and are transformed into
+ * the grid of the tile the chain belongs to.
+ */
+
+
+/** maximum length of one line */
+#define IMPORT_LINE_SIZE        1024
+/** maximum amount of fields per line */
+#define IMPORT_MAX_FIELDS       32
+
+
+/** columns the importer understands */
+typedef enum
+{
+        COLUMN_HARDWARE,
+        COLUMN_CHAIN,
+        COLUMN_LED,
+        COLUMN_X,
+        COLUMN_Y,
+        NUM_COLUMNS,
+} ImportColumn;
+
+/** names of columns in header line */
+static const char *_column_names[NUM_COLUMNS] = {
+        "hardware", "chain", "led", "x", "y"
+};
+
+
+/** chain that received positions */
+typedef struct
+{
+        NiftyconfChain *chain;
+        /** setup -> tile transformation: local = o + x * a + y * b */
+        double oX, oY, aX, aY, bX, bY;
+} ImportChain;
+
+
+/** state while importing */
+typedef struct
+{
+        /** field of every column (-1 if not present) */
+        gint columns[NUM_COLUMNS];
+        /** chains of every hardware (GPtrArray of NiftyconfChain) */
+        GPtrArray *hardware;
+        /** chains that got positions (NiftyconfChain -> ImportChain) */
+        GHashTable *touched;
+        /** chain for rows without indices */
+        NiftyconfChain *target;
+        /** next LED of target */
+        LedCount next;
+        ImportResult *result;
+} Import;
+
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** split line into comma separated fields (modifies line) */
+static gint _split(gchar * line, gchar ** fields)
+{
+        gint n = 0;
+        gchar *f = line;
+        while(n < IMPORT_MAX_FIELDS)
+        {
+                gchar *end = strchr(f, ',');
+                if(end)
+                        *end = '\0';
+
+                fields[n++] = g_strstrip(f);
+
+                if(!end)
+                        break;
+                f = end + 1;
+        }
+
+        return n;
+}
+
+
+/** parse unsigned integer field */
+static gboolean _parse_uint(const gchar * s, guint * v)
+{
+        gchar *end;
+        guint64 r = g_ascii_strtoull(s, &end, 10);
+        if(end == s || *end != '\0' || r > G_MAXUINT)
+                return false;
+
+        *v = (guint) r;
+        return true;
+}
+
+
+/** parse floating point field (independent of current locale) */
+static gboolean _parse_double(const gchar * s, double *v)
+{
+        gchar *end;
+        *v = g_ascii_strtod(s, &end);
+        return end != s && *end == '\0';
+}
+
+
+/** use line as header if it doesn't start with a number */
+static gboolean _parse_header(Import * im, gchar ** fields, gint n)
+{
+        double d;
+        if(_parse_double(fields[0], &d))
+                return false;
+
+        gint c;
+        for(c = 0; c < NUM_COLUMNS; c++)
+                im->columns[c] = -1;
+
+        gint i;
+        for(i = 0; i < n; i++)
+        {
+                for(c = 0; c < NUM_COLUMNS; c++)
+                {
+                        if(g_ascii_strcasecmp(fields[i], _column_names[c]) == 0)
+                                im->columns[c] = i;
+                }
+        }
+
+        return true;
+}
+
+
+/** header names x & y and either all or none of the index columns */
+static gboolean _columns_valid(Import * im)
+{
+        if(im->columns[COLUMN_X] < 0 || im->columns[COLUMN_Y] < 0)
+                return false;
+
+        gint indices = (im->columns[COLUMN_HARDWARE] >= 0) +
+                (im->columns[COLUMN_CHAIN] >= 0) +
+                (im->columns[COLUMN_LED] >= 0);
+
+        return indices == 0 || indices == NUM_COLUMNS - 2;
+}
+
+
+/** columns of files without header line */
+static void _default_columns(Import * im, gint n)
+{
+        gint c;
+        for(c = 0; c < NUM_COLUMNS; c++)
+                im->columns[c] = -1;
+
+        /* x,y */
+        if(n < NUM_COLUMNS)
+        {
+                im->columns[COLUMN_X] = 0;
+                im->columns[COLUMN_Y] = 1;
+        }
+        /* hardware,chain,led,x,y */
+        else
+        {
+                for(c = 0; c < NUM_COLUMNS; c++)
+                        im->columns[c] = c;
+        }
+}
+
+
+/** collect chains of a list of tiles in the order the export uses */
+static void _index_tiles(GPtrArray * chains, LedTile * t)
+{
+        for(; t; t = led_tile_list_get_next(t))
+        {
+                LedChain *c;
+                if((c = led_tile_get_chain(t)))
+                        g_ptr_array_add(chains, led_chain_get_privdata(c));
+
+                _index_tiles(chains, led_tile_get_child(t));
+        }
+}
+
+
+/** collect chains of all hardware of the current setup */
+static GPtrArray *_index_setup()
+{
+        GPtrArray *hardware =
+                g_ptr_array_new_with_free_func((GDestroyNotify)
+                                               g_ptr_array_unref);
+
+        LedHardware *h;
+        for(h = led_setup_get_hardware(setup_get_current()); h;
+            h = led_hardware_list_get_next(h))
+        {
+                GPtrArray *chains = g_ptr_array_new();
+                _index_tiles(chains, led_hardware_get_tile(h));
+                g_ptr_array_add(hardware, chains);
+        }
+
+        return hardware;
+}
+
+
+/** prepare chain to receive positions (records undo once per chain) */
+static ImportChain *_touch(Import * im, NiftyconfChain * chain)
+{
+        ImportChain *ic;
+        if((ic = g_hash_table_lookup(im->touched, chain)))
+                return ic;
+
+        /* only LEDs of tiles have a position in the setup */
+        LedChain *c = chain_niftyled(chain);
+        LedTile *t;
+        if(!(t = led_chain_get_parent_tile(c)))
+                return NULL;
+
+        ic = g_slice_new(ImportChain);
+        ic->chain = chain;
+
+        /* tile transformation is affine, transform unit vectors once */
+        ic->oX = 0;
+        ic->oY = 0;
+        tile_world_to_local(t, &ic->oX, &ic->oY);
+        ic->aX = 1;
+        ic->aY = 0;
+        tile_world_to_local(t, &ic->aX, &ic->aY);
+        ic->bX = 0;
+        ic->bY = 1;
+        tile_world_to_local(t, &ic->bX, &ic->bY);
+        ic->aX -= ic->oX;
+        ic->aY -= ic->oY;
+        ic->bX -= ic->oX;
+        ic->bY -= ic->oY;
+
+        g_hash_table_insert(im->touched, chain, ic);
+
+        LedCount count = led_chain_get_ledcount(c);
+        if(count > 0)
+                undo_record_leds(chain, 0, count - 1, UNDO_LED_POS);
+
+        return ic;
+}
+
+
+/** remember row that didn't match */
+static void _unmatched(Import * im, guint line)
+{
+        ImportResult *r = im->result;
+        if(r->unmatched < IMPORT_MAX_REPORTED)
+                r->lines[r->unmatched] = line;
+        r->unmatched++;
+}
+
+
+/** apply one data row */
+static void _apply_row(Import * im, gchar ** fields, gint n, guint line)
+{
+        /* all needed fields present? */
+        gint c;
+        for(c = 0; c < NUM_COLUMNS; c++)
+        {
+                /* column not in file */
+                if(im->columns[c] < 0)
+                        continue;
+
+                if(im->columns[c] >= n)
+                        goto _ar_unmatched;
+        }
+
+        double x, y;
+        if(!_parse_double(fields[im->columns[COLUMN_X]], &x) ||
+           !_parse_double(fields[im->columns[COLUMN_Y]], &y))
+                goto _ar_unmatched;
+
+        /* find chain & LED */
+        NiftyconfChain *chain;
+        guint led;
+        if(im->columns[COLUMN_HARDWARE] >= 0 &&
+           im->columns[COLUMN_CHAIN] >= 0 && im->columns[COLUMN_LED] >= 0)
+        {
+                guint h, ch;
+                if(!_parse_uint(fields[im->columns[COLUMN_HARDWARE]], &h) ||
+                   !_parse_uint(fields[im->columns[COLUMN_CHAIN]], &ch) ||
+                   !_parse_uint(fields[im->columns[COLUMN_LED]], &led))
+                        goto _ar_unmatched;
+
+                if(h >= im->hardware->len)
+                        goto _ar_unmatched;
+
+                GPtrArray *chains = g_ptr_array_index(im->hardware, h);
+                if(ch >= chains->len)
+                        goto _ar_unmatched;
+
+                chain = g_ptr_array_index(chains, ch);
+        }
+        else
+        {
+                if(!(chain = im->target))
+                        goto _ar_unmatched;
+
+                led = im->next++;
+        }
+
+        LedChain *lc = chain_niftyled(chain);
+        if(led >= led_chain_get_ledcount(lc))
+                goto _ar_unmatched;
+
+        ImportChain *ic;
+        if(!(ic = _touch(im, chain)))
+                goto _ar_unmatched;
+
+        /* center of LED in tile -> LED cell */
+        double lX = ic->oX + x * ic->aX + y * ic->bX;
+        double lY = ic->oY + x * ic->aY + y * ic->bY;
+        if(!led_set_pos(led_chain_get_nth(lc, led),
+                        (LedFrameCord) floor(lX), (LedFrameCord) floor(lY)))
+                goto _ar_unmatched;
+
+        im->result->applied++;
+        return;
+
+_ar_unmatched:
+        _unmatched(im, line);
+}
+
+
+/** update everything that depends on positions of a chain once */
+static void _chain_finish(gpointer key, gpointer value, gpointer u)
+{
+        ImportChain *ic = value;
+
+        spatial_index_update_chain(ic->chain);
+        renderer_chain_damage(ic->chain);
+
+        g_slice_free(ImportChain, ic);
+}
+
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/**
+ * read LED positions from CSV file and apply them to the current setup
+ * as one undoable step (target receives rows without indices, may be NULL)
+ */
+NftResult import_positions(const char *filename, NiftyconfChain * target,
+                           ImportResult * r)
+{
+        if(!filename || !r)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        memset(r, 0, sizeof(*r));
+
+        FILE *f;
+        if(!(f = fopen(filename, "r")))
+        {
+                NFT_LOG(L_ERROR, "Failed to open \"%s\" - %s",
+                        filename, strerror(errno));
+                return NFT_FAILURE;
+        }
+
+        Import im = {
+                .hardware = _index_setup(),
+                .touched = g_hash_table_new(g_direct_hash, g_direct_equal),
+                .target = target,
+                .result = r,
+        };
+
+        undo_group_begin();
+
+        gchar line[IMPORT_LINE_SIZE];
+        gchar *fields[IMPORT_MAX_FIELDS];
+        guint number = 0;
+        gboolean first = true;
+        gboolean invalid = false;
+        while(fgets(line, sizeof(line), f))
+        {
+                number++;
+
+                gint n = _split(line, fields);
+
+                /* skip empty lines & comments */
+                if(n == 1 && (fields[0][0] == '\0' || fields[0][0] == '#'))
+                        continue;
+
+                if(first)
+                {
+                        first = false;
+                        if(_parse_header(&im, fields, n))
+                        {
+                                /* rows can't be applied without them */
+                                if(!_columns_valid(&im))
+                                {
+                                        invalid = true;
+                                        break;
+                                }
+                                continue;
+                        }
+
+                        _default_columns(&im, n);
+                }
+
+                _apply_row(&im, fields, n, number);
+        }
+
+        undo_group_end();
+
+        gboolean failed = ferror(f);
+        fclose(f);
+
+        /* one update per chain, one for the tree */
+        g_hash_table_foreach(im.touched, _chain_finish, NULL);
+        g_hash_table_destroy(im.touched);
+        g_ptr_array_unref(im.hardware);
+
+        ui_setup_tree_refresh();
+        ui_setup_props_refresh();
+
+        if(invalid)
+        {
+                NFT_LOG(L_ERROR,
+                        "\"%s\" needs x & y columns and all or none of hardware, chain & led",
+                        filename);
+                return NFT_FAILURE;
+        }
+
+        if(failed)
+        {
+                NFT_LOG(L_ERROR, "Failed to read \"%s\"", filename);
+                return NFT_FAILURE;
+        }
+
+        NFT_LOG(L_INFO, "Imported %u positions from \"%s\" (%u rows unmatched)",
+                r->applied, filename, r->unmatched);
+
+        return NFT_SUCCESS;
+}
@@ -0,0 +1,1816 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "prefs/prefs.h"
+#include "ui/ui-log.h"
+#include "ui/ui-renderer.h"
+#include "ui/ui-setup-tree.h"
+#include "elements/element-setup.h"
+#include "elements/element-hardware.h"
+#include "elements/element-tile.h"
+#include "elements/element-chain.h"
+#include "spatial-index/spatial-index.h"
+#include "undo/undo.h"
+#include "journal/journal.h"
+
+
+/**
+ * The journal is an append-only log of edits stored next to a setup file.
+ * The undo module reports every edit. Added & removed elements are encoded
+ * into a small binary record right away. Changed properties only mark the
+ * element dirty, its current values are encoded when records are handed to
+ * the writer (or before the next structural edit). Records are queued in
+ * memory. A worker appends queued records to the journal every few seconds.
+ * Elements are addressed by their position in the setup, so the records can
+ * be replayed on top of the setup file after a crash. Journals of unnamed
+ * setups live in the user's cache directory, each locked by the instance
+ * using it, so only journals left by a crashed instance are offered for
+ * recovery. While nothing is edited, a long journal is replaced by a
+ * snapshot of the whole setup. Saving the setup drops all records that the
+ * saved file already contains. All values are stored in host byte order.
+ */
+
+
+/** identifies a journal file */
+#define JOURNAL_MAGIC           "NFTJRNL"
+/** increase whenever the layout of the journal changes */
+#define JOURNAL_VERSION         2
+/** written as-is to detect journals from hosts with other byte order */
+#define JOURNAL_BYTE_ORDER      0x01020304
+/** default interval to write queued records (s) */
+#define JOURNAL_FLUSH_INTERVAL  2
+/** default time without edits before a journal is compacted (s) */
+#define JOURNAL_COMPACT_IDLE    30
+/** journals with less records than this are never compacted */
+#define JOURNAL_COMPACT_RECORDS 256
+/** tiles nested deeper are considered corruption */
+#define JOURNAL_MAX_DEPTH       64
+/** prefix of journals of unnamed setups (in user's cache directory) */
+#define JOURNAL_UNNAMED         "unnamed-"
+
+/** journal was started with a new, empty setup instead of the setup file */
+#define JOURNAL_EMPTY_BASE      (1 << 0)
+
+
+/** start of every journal file */
+typedef struct
+{
+        char magic[8];
+        guint32 version;
+        guint32 byte_order;
+        /** setup file the records apply to (size -1 if there's none) */
+        gint64 base_size;
+        gint64 base_mtime;
+        guint32 flags;
+        /** length of setup snapshot (XML) following the header */
+        guint32 snapshot;
+} JournalHeader;
+
+
+/** kinds of records */
+typedef enum
+{
+        /** element added: type, position, path of parent, XML of element */
+        JOURNAL_INSERT,
+        /** element removed from setup: path */
+        JOURNAL_REMOVE,
+        /** properties of LEDs: path, field, first, count, values */
+        JOURNAL_LEDS,
+        /** placement of a tile: path, position, pivot, rotation */
+        JOURNAL_TILE,
+        /** amount of LEDs of a chain: path, ledcount */
+        JOURNAL_LEDCOUNT,
+} JournalRecordType;
+
+
+/** precedes every record */
+typedef struct
+{
+        /** length of payload */
+        guint32 size;
+        /** hash of payload (detects incompletely written records) */
+        guint32 check;
+        /** sequence number */
+        guint32 seq;
+        /** JournalRecordType */
+        guint32 type;
+} JournalRecordHeader;
+
+
+/** record waiting to be written */
+typedef struct
+{
+        JournalRecordHeader h;
+        GByteArray *payload;
+        /** inserted element (serialized to payload by worker) */
+        LedPrefsNode *node;
+} JournalRecord;
+
+
+/** element with properties not recorded, yet */
+typedef struct
+{
+        NIFTYLED_TYPE type;
+        gpointer element;
+        /** chain: changed range of LEDs per UndoLedField */
+        struct
+        {
+                gboolean set;
+                LedCount first, last;
+        } leds[UNDO_LED_GAIN + 1];
+} JournalDirty;
+
+
+/** work for the writer */
+typedef struct
+{
+        /** journal file */
+        gchar *filename;
+        /** records to append (NULL to rewrite journal) */
+        GPtrArray *records;
+        /** rewrite: header of new journal */
+        JournalHeader header;
+        /** rewrite: snapshot of whole setup (or NULL) */
+        LedPrefsNode *snapshot;
+        /** rewrite: copy records newer than keep from old journal */
+        gboolean copy;
+        guint32 keep;
+        /** reason of failure (or NULL) */
+        gchar *error;
+} JournalJob;
+
+
+/** result of checking a journal file */
+typedef struct
+{
+        JournalHeader header;
+        /** snapshot XML (or NULL) */
+        const guint8 *snapshot;
+        /** first record & end of last complete record */
+        const guint8 *first, *end;
+        /** amount of complete records & sequence number of last one */
+        guint records;
+        guint32 seq;
+} JournalScan;
+
+
+/** cursor into a journal */
+typedef struct
+{
+        const guint8 *pos;
+        const guint8 *end;
+        /** false once reading went past the end */
+        gboolean ok;
+} JournalReader;
+
+
+/** the journal of the current setup */
+static struct
+{
+        /** journal file (NULL while there's none) */
+        gchar *filename;
+        /** journal of a setup without file & descriptor holding its lock */
+        gboolean unnamed;
+        int lock;
+        /** journal contains edits (worth recovering) */
+        gboolean edited;
+        /** header of journal file */
+        JournalHeader header;
+        /** sequence number of last record */
+        guint32 seq;
+        /** records not handed to writer, yet */
+        GPtrArray *queue;
+        /** elements with changed properties (element -> JournalDirty) */
+        GHashTable *dirty;
+        /** records in journal since it was started or compacted */
+        guint records;
+        /** time of last record */
+        gint64 last;
+        /** records are replayed (nothing is recorded) */
+        gboolean replaying;
+        /** writes jobs one after another */
+        GThreadPool *pool;
+        /** source ID of flush timer */
+        guint timer;
+        /** interval to write records & idle time before compacting (s) */
+        gint flush_interval, compact_idle;
+} _journal;
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** FNV-1a hash of a buffer */
+static guint32 _hash(const guint8 * data, gsize size)
+{
+        guint32 h = 2166136261u;
+        gsize i;
+        for(i = 0; i < size; i++)
+        {
+                h ^= data[i];
+                h *= 16777619u;
+        }
+
+        return h;
+}
+
+
+/** append raw bytes */
+static void _put(GByteArray * b, const void *data, gsize size)
+{
+        g_byte_array_append(b, data, size);
+}
+
+
+static void _put_u32(GByteArray * b, guint32 v)
+{
+        _put(b, &v, sizeof(v));
+}
+
+
+/** copy raw bytes */
+static void _get(JournalReader * r, void *data, gsize size)
+{
+        if(!r->ok || (gsize) (r->end - r->pos) < size)
+        {
+                r->ok = false;
+                memset(data, 0, size);
+                return;
+        }
+
+        memcpy(data, r->pos, size);
+        r->pos += size;
+}
+
+
+static guint32 _get_u32(JournalReader * r)
+{
+        guint32 v;
+        _get(r, &v, sizeof(v));
+        return v;
+}
+
+
+/** name of journal file of a setup file */
+static gchar *_filename(const char *setupfile)
+{
+        return g_strdup_printf("%s.journal", setupfile);
+}
+
+
+/** fill header for a journal of setup file (NULL for unnamed setup) */
+static void _stamp(const char *setupfile, JournalHeader * h)
+{
+        memset(h, 0, sizeof(*h));
+        memcpy(h->magic, JOURNAL_MAGIC, sizeof(h->magic));
+        h->version = JOURNAL_VERSION;
+        h->byte_order = JOURNAL_BYTE_ORDER;
+        h->base_size = -1;
+
+        if(!setupfile)
+        {
+                h->flags = JOURNAL_EMPTY_BASE;
+                return;
+        }
+
+        struct stat sts;
+        if(stat(setupfile, &sts) == -1)
+                return;
+
+        h->base_size = (gint64) sts.st_size;
+        h->base_mtime = (gint64) sts.st_mtim.tv_sec *
+                G_GINT64_CONSTANT(1000000000) + sts.st_mtim.tv_nsec;
+}
+
+
+/** check journal & find its complete records */
+static gboolean _scan(const guint8 * buf, gsize length, JournalScan * s)
+{
+        memset(s, 0, sizeof(*s));
+
+        JournalReader r = {.pos = buf,.end = buf + length,.ok = true };
+        _get(&r, &s->header, sizeof(s->header));
+        if(!r.ok ||
+           memcmp(s->header.magic, JOURNAL_MAGIC, sizeof(s->header.magic)) != 0
+           || s->header.version != JOURNAL_VERSION ||
+           s->header.byte_order != JOURNAL_BYTE_ORDER ||
+           (gsize) (r.end - r.pos) < s->header.snapshot)
+                return false;
+
+        if(s->header.snapshot)
+                s->snapshot = r.pos;
+        r.pos += s->header.snapshot;
+        s->first = s->end = r.pos;
+
+        /* stop at first record that wasn't written completely */
+        for(;;)
+        {
+                JournalRecordHeader h;
+                _get(&r, &h, sizeof(h));
+                if(!r.ok || (gsize) (r.end - r.pos) < h.size ||
+                   _hash(r.pos, h.size) != h.check)
+                        break;
+
+                r.pos += h.size;
+                s->end = r.pos;
+                s->seq = h.seq;
+                s->records++;
+        }
+
+        return true;
+}
+
+
+/** append path of element: type, depth, index of hardware & tiles */
+static gboolean _put_path(GByteArray * b, NIFTYLED_TYPE t, gpointer element)
+{
+        LedHardware *h = NULL;
+        LedTile *tile = NULL;
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        h = hardware_niftyled(element);
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        tile = tile_niftyled(element);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedChain *c = chain_niftyled(element);
+                        if(led_chain_parent_is_hardware(c))
+                                h = led_chain_get_parent_hardware(c);
+                        else
+                                tile = led_chain_get_parent_tile(c);
+                        break;
+                }
+
+                default:
+                {
+                        return false;
+                }
+        }
+
+        /* walk up to hardware (indices are collected in reverse order) */
+        guint32 index[JOURNAL_MAX_DEPTH];
+        guint depth = 0;
+        while(tile)
+        {
+                if(depth >= JOURNAL_MAX_DEPTH - 1)
+                        return false;
+
+                LedTile *parent = led_tile_get_parent_tile(tile);
+                LedTile *sibling;
+                if(parent)
+                        sibling = led_tile_get_child(parent);
+                else
+                        sibling = led_hardware_get_tile(h =
+                                                        led_tile_get_parent_hardware
+                                                        (tile));
+
+                guint32 i;
+                for(i = 0; sibling && sibling != tile;
+                    sibling = led_tile_list_get_next(sibling))
+                        i++;
+                if(!sibling)
+                        return false;
+
+                index[depth++] = i;
+                tile = parent;
+        }
+
+        LedHardware *sibling;
+        guint32 i = 0;
+        for(sibling = led_setup_get_hardware(setup_get_current());
+            sibling && sibling != h;
+            sibling = led_hardware_list_get_next(sibling))
+                i++;
+        if(!sibling)
+                return false;
+        index[depth++] = i;
+
+        _put_u32(b, t);
+        _put_u32(b, depth);
+        while(depth > 0)
+                _put_u32(b, index[--depth]);
+
+        return true;
+}
+
+
+/** find element by its path (NULL if it doesn't exist) */
+static gpointer _get_path(JournalReader * r, NIFTYLED_TYPE * t)
+{
+        *t = _get_u32(r);
+        guint32 depth = _get_u32(r);
+        if(!r->ok || depth == 0 || depth > JOURNAL_MAX_DEPTH)
+                return NULL;
+
+        guint32 n = _get_u32(r);
+        LedHardware *h;
+        for(h = led_setup_get_hardware(setup_get_current()); h && n > 0;
+            h = led_hardware_list_get_next(h))
+                n--;
+
+        LedTile *tile = NULL;
+        guint32 i;
+        for(i = 1; i < depth; i++)
+        {
+                n = _get_u32(r);
+                if(!h)
+                        continue;
+
+                for(tile = tile ? led_tile_get_child(tile) :
+                    led_hardware_get_tile(h); tile && n > 0;
+                    tile = led_tile_list_get_next(tile))
+                        n--;
+                if(!tile)
+                        h = NULL;
+        }
+
+        if(!r->ok || !h)
+                return NULL;
+
+        switch (*t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        return depth == 1 ? led_hardware_get_privdata(h) :
+                                NULL;
+                }
+
+                case LED_TILE_T:
+                {
+                        return tile ? led_tile_get_privdata(tile) : NULL;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedChain *c = tile ? led_tile_get_chain(tile) :
+                                led_hardware_get_chain(h);
+                        return c ? led_chain_get_privdata(c) : NULL;
+                }
+
+                default:
+                {
+                        return NULL;
+                }
+        }
+}
+
+
+/** allocate new record */
+static JournalRecord *_record_new(JournalRecordType type)
+{
+        JournalRecord *rec = g_slice_new0(JournalRecord);
+        rec->h.type = type;
+        rec->payload = g_byte_array_new();
+
+        return rec;
+}
+
+
+/** free a record */
+static void _record_free(gpointer p)
+{
+        JournalRecord *rec = p;
+
+        if(rec->node)
+                led_prefs_node_free(rec->node);
+        g_byte_array_free(rec->payload, true);
+        g_slice_free(JournalRecord, rec);
+}
+
+
+/** queue record for next flush */
+static void _queue(JournalRecord * rec)
+{
+        rec->h.seq = ++_journal.seq;
+        g_ptr_array_add(_journal.queue, rec);
+
+        _journal.records++;
+        _journal.last = g_get_monotonic_time();
+        _journal.edited = true;
+}
+
+
+/** record current properties of a range of LEDs */
+static void _record_leds(NiftyconfChain * c, LedCount first, LedCount last,
+                         UndoLedField field)
+{
+        /* ledcount might have changed since */
+        LedChain *chain = chain_niftyled(c);
+        LedCount ledcount = led_chain_get_ledcount(chain);
+        if(ledcount == 0 || first >= ledcount)
+                return;
+        if(last >= ledcount)
+                last = ledcount - 1;
+
+        JournalRecord *rec = _record_new(JOURNAL_LEDS);
+        if(!_put_path(rec->payload, LED_CHAIN_T, c))
+        {
+                _record_free(rec);
+                return;
+        }
+
+        _put_u32(rec->payload, field);
+        _put_u32(rec->payload, first);
+        _put_u32(rec->payload, last - first + 1);
+
+        LedCount i;
+        for(i = first; i <= last; i++)
+        {
+                Led *l = led_chain_get_nth(chain, i);
+                switch (field)
+                {
+                        case UNDO_LED_POS:
+                        {
+                                LedFrameCord x, y;
+                                led_get_pos(l, &x, &y);
+                                _put(rec->payload, &x, sizeof(x));
+                                _put(rec->payload, &y, sizeof(y));
+                                break;
+                        }
+
+                        case UNDO_LED_COMPONENT:
+                        {
+                                LedFrameComponent v = led_get_component(l);
+                                _put(rec->payload, &v, sizeof(v));
+                                break;
+                        }
+
+                        case UNDO_LED_GAIN:
+                        {
+                                LedGain v = led_get_gain(l);
+                                _put(rec->payload, &v, sizeof(v));
+                                break;
+                        }
+                }
+        }
+
+        _queue(rec);
+}
+
+
+/** record current placement of a tile */
+static void _record_tile(NiftyconfTile * t)
+{
+        JournalRecord *rec = _record_new(JOURNAL_TILE);
+        if(!_put_path(rec->payload, LED_TILE_T, t))
+        {
+                _record_free(rec);
+                return;
+        }
+
+        LedTile *tile = tile_niftyled(t);
+        LedFrameCord x, y;
+        double pivot_x, pivot_y, rotation;
+        led_tile_get_pos(tile, &x, &y);
+        led_tile_get_pivot(tile, &pivot_x, &pivot_y);
+        rotation = led_tile_get_rotation(tile);
+        _put(rec->payload, &x, sizeof(x));
+        _put(rec->payload, &y, sizeof(y));
+        _put(rec->payload, &pivot_x, sizeof(pivot_x));
+        _put(rec->payload, &pivot_y, sizeof(pivot_y));
+        _put(rec->payload, &rotation, sizeof(rotation));
+
+        _queue(rec);
+}
+
+
+/** mark properties of element as changed */
+static JournalDirty *_dirty(NIFTYLED_TYPE t, gpointer element)
+{
+        JournalDirty *d;
+        if(!(d = g_hash_table_lookup(_journal.dirty, element)))
+        {
+                d = g_slice_new0(JournalDirty);
+                d->type = t;
+                d->element = element;
+                g_hash_table_insert(_journal.dirty, element, d);
+        }
+
+        return d;
+}
+
+
+/** free entry of dirty table */
+static void _dirty_free(gpointer p)
+{
+        g_slice_free(JournalDirty, p);
+}
+
+
+/** record current properties of all dirty elements */
+static void _commit()
+{
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, _journal.dirty);
+        while(g_hash_table_iter_next(&iter, NULL, &value))
+        {
+                JournalDirty *d = value;
+                if(d->type == LED_TILE_T)
+                {
+                        _record_tile(d->element);
+                        continue;
+                }
+
+                guint f;
+                for(f = 0; f <= UNDO_LED_GAIN; f++)
+                        if(d->leds[f].set)
+                                _record_leds(d->element, d->leds[f].first,
+                                             d->leds[f].last, f);
+        }
+
+        g_hash_table_remove_all(_journal.dirty);
+}
+
+
+/** free a job */
+static void _job_free(JournalJob * j)
+{
+        if(j->records)
+                g_ptr_array_free(j->records, true);
+        if(j->snapshot)
+                led_prefs_node_free(j->snapshot);
+        g_free(j->error);
+        g_free(j->filename);
+        g_slice_free(JournalJob, j);
+}
+
+
+/** log failure of writer (main thread) */
+static gboolean _write_failed(gpointer u)
+{
+        NFT_LOG(L_WARNING, "%s", (gchar *) u);
+        g_free(u);
+
+        return false;
+}
+
+
+/** remember failure of job (call right after the failing call, uses errno) */
+static void _job_error(JournalJob * j, const char *what)
+{
+        if(j->error)
+                return;
+
+        j->error = g_strdup_printf("Failed to %s journal \"%s\" - %s",
+                                   what, j->filename, strerror(errno));
+}
+
+
+/** write whole buffer */
+static gboolean _write_all(int fd, const guint8 * buf, gsize length)
+{
+        gsize pos = 0;
+        while(pos < length)
+        {
+                ssize_t w = write(fd, buf + pos, length - pos);
+                if(w == -1)
+                {
+                        if(errno == EINTR)
+                                continue;
+                        return false;
+                }
+                pos += w;
+        }
+
+        return true;
+}
+
+
+/** serialize node with prefs context of writer */
+static char *_serialize(LedPrefs ** p, LedPrefsNode * n)
+{
+        if(!*p && !(*p = led_prefs_init()))
+                return NULL;
+
+        return led_prefs_node_to_buffer(*p, n);
+}
+
+
+/** append records to journal (worker thread) */
+static void _append(JournalJob * j, LedPrefs ** p)
+{
+        GByteArray *b = g_byte_array_new();
+
+        guint i;
+        for(i = 0; i < j->records->len; i++)
+        {
+                JournalRecord *rec = g_ptr_array_index(j->records, i);
+
+                /* XML of inserted element (a failure makes replay fail) */
+                char *xml;
+                if(rec->node && (xml = _serialize(p, rec->node)))
+                {
+                        _put(rec->payload, xml, strlen(xml));
+                        free(xml);
+                }
+
+                rec->h.size = rec->payload->len;
+                rec->h.check = _hash(rec->payload->data, rec->payload->len);
+                _put(b, &rec->h, sizeof(rec->h));
+                _put(b, rec->payload->data, rec->payload->len);
+        }
+
+        int fd;
+        if((fd = open(j->filename, O_WRONLY | O_APPEND)) == -1)
+        {
+                _job_error(j, "open");
+                goto _a_exit;
+        }
+
+        if(!_write_all(fd, b->data, b->len) || fdatasync(fd) == -1)
+                _job_error(j, "write");
+        if(close(fd) == -1)
+                _job_error(j, "close");
+
+_a_exit:
+        g_byte_array_free(b, true);
+}
+
+
+/** replace journal by header, snapshot & newer records (worker thread) */
+static void _rewrite(JournalJob * j, LedPrefs ** p)
+{
+        GByteArray *b = g_byte_array_new();
+
+        char *xml = NULL;
+        if(j->snapshot && !(xml = _serialize(p, j->snapshot)))
+        {
+                j->error = g_strdup_printf("Failed to create snapshot for "
+                                           "journal \"%s\"", j->filename);
+                goto _rw_exit;
+        }
+
+        JournalHeader h = j->header;
+        h.snapshot = xml ? strlen(xml) : 0;
+        _put(b, &h, sizeof(h));
+        if(xml)
+        {
+                _put(b, xml, h.snapshot);
+                free(xml);
+        }
+
+        /* records that happened after the new base */
+        gchar *buf;
+        gsize length;
+        if(j->copy && g_file_get_contents(j->filename, &buf, &length, NULL))
+        {
+                JournalScan s;
+                if(_scan((const guint8 *) buf, length, &s))
+                {
+                        JournalReader r = {.pos = s.first,.end = s.end,.ok =
+                                        true };
+                        while(r.pos < r.end)
+                        {
+                                const guint8 *start = r.pos;
+                                JournalRecordHeader rh;
+                                _get(&r, &rh, sizeof(rh));
+                                r.pos += rh.size;
+                                if(rh.seq > j->keep)
+                                        _put(b, start, r.pos - start);
+                        }
+                }
+                g_free(buf);
+        }
+
+        gchar *tmp = g_strdup_printf("%s.XXXXXX", j->filename);
+        int fd;
+        if((fd = g_mkstemp(tmp)) == -1)
+        {
+                _job_error(j, "create");
+                g_free(tmp);
+                goto _rw_exit;
+        }
+
+        if(!_write_all(fd, b->data, b->len) || fsync(fd) == -1)
+                _job_error(j, "write");
+        if(close(fd) == -1)
+                _job_error(j, "close");
+        if(!j->error && rename(tmp, j->filename) == -1)
+                _job_error(j, "replace");
+
+        if(j->error)
+                unlink(tmp);
+        g_free(tmp);
+
+_rw_exit:
+        g_byte_array_free(b, true);
+}
+
+
+/** process one job (worker thread) */
+static void _write_thread(gpointer data, gpointer u)
+{
+        JournalJob *j = data;
+
+        /* own prefs context, the main thread keeps using its own */
+        LedPrefs *p = NULL;
+
+        if(j->records)
+                _append(j, &p);
+        else
+                _rewrite(j, &p);
+
+        /* logged by main thread */
+        if(j->error)
+        {
+                g_idle_add(_write_failed, j->error);
+                j->error = NULL;
+        }
+
+        if(p)
+                led_prefs_deinit(p);
+        _job_free(j);
+}
+
+
+/** hand job to writer */
+static void _push(JournalJob * j)
+{
+        if(!_journal.pool)
+        {
+                GError *err = NULL;
+                if(!(_journal.pool = g_thread_pool_new(_write_thread, NULL, 1,
+                                                       false, &err)))
+                {
+                        NFT_LOG(L_ERROR, "Failed to start journal writer - %s",
+                                err->message);
+                        g_error_free(err);
+                        _job_free(j);
+                        return;
+                }
+        }
+
+        g_thread_pool_push(_journal.pool, j, NULL);
+}
+
+
+/** wait until everything is written */
+static void _wait()
+{
+        if(!_journal.pool)
+                return;
+
+        g_thread_pool_free(_journal.pool, false, true);
+        _journal.pool = NULL;
+}
+
+
+/** hand queued records to writer */
+static void _flush()
+{
+        _commit();
+
+        if(_journal.queue->len == 0)
+                return;
+
+        JournalJob *j = g_slice_new0(JournalJob);
+        j->filename = g_strdup(_journal.filename);
+        j->records = _journal.queue;
+        _journal.queue = g_ptr_array_new_with_free_func(_record_free);
+
+        _push(j);
+}
+
+
+/** replace journal by header & optional snapshot */
+static void _restart(JournalHeader * h, LedPrefsNode * snapshot,
+                     gboolean copy, guint32 keep)
+{
+        JournalJob *j = g_slice_new0(JournalJob);
+        j->filename = g_strdup(_journal.filename);
+        j->header = *h;
+        j->snapshot = snapshot;
+        j->copy = copy;
+        j->keep = keep;
+
+        _push(j);
+}
+
+
+/** replace long journal by snapshot of current setup */
+static void _compact()
+{
+        LedPrefsNode *n;
+        if(!(n = led_prefs_setup_to_node(setup_get_prefs(),
+                                         setup_get_current())))
+                return;
+
+        /* queued records are older than snapshot */
+        _flush();
+        _restart(&_journal.header, n, false, 0);
+        _journal.records = 0;
+
+        NFT_LOG(L_DEBUG, "Compacting journal \"%s\"", _journal.filename);
+}
+
+
+/** re-create element from XML */
+static gboolean _replay_insert(JournalReader * r)
+{
+        NIFTYLED_TYPE t = _get_u32(r);
+        guint position = _get_u32(r);
+
+        /* parent (all but hardware) */
+        NIFTYLED_TYPE pt = LED_INVALID_T;
+        gpointer parent = NULL;
+        if(t != LED_HARDWARE_T && !(parent = _get_path(r, &pt)))
+                return false;
+
+        if(!r->ok)
+                return false;
+
+        LedPrefs *p = setup_get_prefs();
+        LedPrefsNode *n;
+        if(!(n = led_prefs_node_from_buffer(p, (const char *) r->pos,
+                                            r->end - r->pos)))
+                return false;
+
+        gboolean result = false;
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        LedHardware *h;
+                        if(!(h = led_prefs_hardware_from_node(p, n)))
+                                break;
+
+                        NiftyconfHardware *e;
+                        if(!(e = hardware_register_to_gui_and_niftyled(h)) ||
+                           !hardware_set_position(e, position))
+                                break;
+
+                        LedTile *tile;
+                        for(tile = led_hardware_get_tile(h); tile;
+                            tile = led_tile_list_get_next(tile))
+                                spatial_index_update_tile
+                                        (led_tile_get_privdata(tile));
+
+                        result = true;
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        LedTile *tile;
+                        if(!(tile = led_prefs_tile_from_node(p, n)))
+                                break;
+
+                        if(pt == LED_TILE_T)
+                        {
+                                led_tile_list_append_child(tile_niftyled
+                                                           (parent), tile);
+                        }
+                        else
+                        {
+                                LedHardware *h = hardware_niftyled(parent);
+                                LedTile *first;
+                                if(!(first = led_hardware_get_tile(h)))
+                                        led_hardware_set_tile(h, tile);
+                                else
+                                        led_tile_list_append_head(first,
+                                                                  tile);
+                        }
+
+                        NiftyconfTile *e;
+                        if(!(e = tile_register_to_gui(tile)) ||
+                           !tile_set_position(e, position))
+                                break;
+
+                        spatial_index_update_tile(e);
+                        result = true;
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedTile *tile = tile_niftyled(parent);
+                        if(pt != LED_TILE_T || led_tile_get_chain(tile))
+                                break;
+
+                        LedChain *c;
+                        if(!(c = led_prefs_chain_from_node(p, n)))
+                                break;
+
+                        led_tile_set_chain(tile, c);
+
+                        NiftyconfChain *e;
+                        if(!(e = chain_register_to_gui(c)))
+                                break;
+
+                        spatial_index_update_chain(e);
+                        result = true;
+                        break;
+                }
+
+                default:
+                {
+                        break;
+                }
+        }
+
+        led_prefs_node_free(n);
+        return result;
+}
+
+
+/** remove element */
+static gboolean _replay_remove(JournalReader * r)
+{
+        NIFTYLED_TYPE t;
+        gpointer e;
+        if(!(e = _get_path(r, &t)))
+                return false;
+
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        hardware_destroy(e);
+                        return true;
+                }
+
+                case LED_TILE_T:
+                {
+                        tile_destroy(e);
+                        return true;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedTile *tile;
+                        if(!(tile = led_chain_get_parent_tile
+                             (chain_niftyled(e))))
+                                return false;
+
+                        chain_of_tile_destroy(led_tile_get_privdata(tile));
+                        return true;
+                }
+
+                default:
+                {
+                        return false;
+                }
+        }
+}
+
+
+/** set properties of LEDs */
+static gboolean _replay_leds(JournalReader * r)
+{
+        NIFTYLED_TYPE t;
+        NiftyconfChain *chain;
+        if(!(chain = _get_path(r, &t)) || t != LED_CHAIN_T)
+                return false;
+
+        UndoLedField field = _get_u32(r);
+        LedCount first = _get_u32(r);
+        LedCount count = _get_u32(r);
+
+        LedChain *c = chain_niftyled(chain);
+        if(!r->ok || first + count > led_chain_get_ledcount(c))
+                return false;
+
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                Led *l = led_chain_get_nth(c, first + i);
+                switch (field)
+                {
+                        case UNDO_LED_POS:
+                        {
+                                LedFrameCord x, y;
+                                _get(r, &x, sizeof(x));
+                                _get(r, &y, sizeof(y));
+                                led_set_pos(l, x, y);
+                                break;
+                        }
+
+                        case UNDO_LED_COMPONENT:
+                        {
+                                LedFrameComponent v;
+                                _get(r, &v, sizeof(v));
+                                led_set_component(l, v);
+                                break;
+                        }
+
+                        case UNDO_LED_GAIN:
+                        {
+                                LedGain v;
+                                _get(r, &v, sizeof(v));
+                                led_set_gain(l, v);
+                                break;
+                        }
+                }
+        }
+
+        if(field == UNDO_LED_POS)
+                spatial_index_update_chain(chain);
+
+        return r->ok;
+}
+
+
+/** set placement of tile */
+static gboolean _replay_tile(JournalReader * r)
+{
+        NIFTYLED_TYPE t;
+        NiftyconfTile *tile;
+        if(!(tile = _get_path(r, &t)) || t != LED_TILE_T)
+                return false;
+
+        LedFrameCord x, y;
+        double pivot_x, pivot_y, rotation;
+        _get(r, &x, sizeof(x));
+        _get(r, &y, sizeof(y));
+        _get(r, &pivot_x, sizeof(pivot_x));
+        _get(r, &pivot_y, sizeof(pivot_y));
+        _get(r, &rotation, sizeof(rotation));
+        if(!r->ok)
+                return false;
+
+        LedTile *lt = tile_niftyled(tile);
+        led_tile_set_pos(lt, x, y);
+        led_tile_set_pivot(lt, pivot_x, pivot_y);
+        led_tile_set_rotation(lt, rotation);
+        spatial_index_update_tile(tile);
+
+        return true;
+}
+
+
+/** set amount of LEDs of chain */
+static gboolean _replay_ledcount(JournalReader * r)
+{
+        NIFTYLED_TYPE t;
+        NiftyconfChain *chain;
+        if(!(chain = _get_path(r, &t)) || t != LED_CHAIN_T)
+                return false;
+
+        LedCount ledcount = _get_u32(r);
+        if(!r->ok)
+                return false;
+
+        return chain_set_ledcount(chain, ledcount);
+}
+
+
+/** apply snapshot & all complete records of journal to current setup */
+static void _replay(JournalScan * s)
+{
+        _journal.replaying = true;
+
+        /* compacted journal replaces setup file */
+        if(s->snapshot)
+        {
+                LedPrefsNode *n;
+                LedSetup *setup = NULL;
+                if((n = led_prefs_node_from_buffer(setup_get_prefs(),
+                                                   (const char *) s->snapshot,
+                                                   s->header.snapshot)))
+                {
+                        setup = led_prefs_setup_from_node(setup_get_prefs(),
+                                                          n);
+                        led_prefs_node_free(n);
+                }
+
+                /* keep filename, registering a setup forgets it */
+                gchar *filename = g_strdup(setup_get_current_filename());
+                if(!setup || !setup_register_to_gui(setup))
+                        ui_log_alert_show
+                                ("Failed to restore snapshot from journal");
+                setup_set_current_filename(filename);
+                g_free(filename);
+        }
+
+        guint failed = 0;
+        JournalReader r = {.pos = s->first,.end = s->end,.ok = true };
+        while(r.pos < r.end)
+        {
+                JournalRecordHeader h;
+                _get(&r, &h, sizeof(h));
+
+                JournalReader payload = {.pos = r.pos,.end =
+                                r.pos + h.size,.ok = true };
+                r.pos += h.size;
+
+                gboolean result = false;
+                switch (h.type)
+                {
+                        case JOURNAL_INSERT:
+                                result = _replay_insert(&payload);
+                                break;
+                        case JOURNAL_REMOVE:
+                                result = _replay_remove(&payload);
+                                break;
+                        case JOURNAL_LEDS:
+                                result = _replay_leds(&payload);
+                                break;
+                        case JOURNAL_TILE:
+                                result = _replay_tile(&payload);
+                                break;
+                        case JOURNAL_LEDCOUNT:
+                                result = _replay_ledcount(&payload);
+                                break;
+                }
+
+                if(!result)
+                        failed++;
+        }
+
+        _journal.replaying = false;
+
+        if(failed)
+                ui_log_alert_show("Failed to recover %u of %u change(s)",
+                                  failed, s->records);
+
+        /* recovered edits can't be undone */
+        undo_clear();
+
+        ui_setup_tree_refresh();
+        ui_renderer_all_queue_draw();
+}
+
+
+/** write queued records & compact journal while nothing is edited */
+static gboolean _tick(gpointer u)
+{
+        if(!_journal.filename)
+                return true;
+
+        _flush();
+
+        if(_journal.records >= JOURNAL_COMPACT_RECORDS &&
+           g_get_monotonic_time() - _journal.last >
+           (gint64) _journal.compact_idle * G_USEC_PER_SEC)
+                _compact();
+
+        return true;
+}
+
+
+/** (re-)start flush timer */
+static void _timer_start()
+{
+        if(_journal.timer)
+                g_source_remove(_journal.timer);
+
+        _journal.timer = g_timeout_add_seconds(MAX(_journal.flush_interval, 1),
+                                               _tick, NULL);
+}
+
+
+/** configure from preferences */
+static NftResult _this_from_prefs(NftPrefs * prefs,
+                                  void **newObj,
+                                  NftPrefsNode * node, void *userptr)
+{
+        /* dummy object */
+        *newObj = (void *) 1;
+
+        nft_prefs_node_prop_int_get(node, "flush-interval",
+                                    &_journal.flush_interval);
+        nft_prefs_node_prop_int_get(node, "compact-idle",
+                                    &_journal.compact_idle);
+        _timer_start();
+
+        return NFT_SUCCESS;
+}
+
+
+/** save configuration to preferences */
+static NftResult _this_to_prefs(NftPrefs * prefs,
+                                NftPrefsNode * newNode,
+                                void *obj, void *userptr)
+{
+        if(!nft_prefs_node_prop_int_set(newNode, "flush-interval",
+                                        _journal.flush_interval))
+                return NFT_FAILURE;
+        if(!nft_prefs_node_prop_int_set(newNode, "compact-idle",
+                                        _journal.compact_idle))
+                return NFT_FAILURE;
+
+        return NFT_SUCCESS;
+}
+
+
+/** lock journal against other instances (-1 if it's in use) */
+static int _lock(const char *path)
+{
+        gchar *name = g_strdup_printf("%s.lock", path);
+        int fd = open(name, O_RDWR | O_CREAT, 0600);
+        g_free(name);
+
+        if(fd != -1 && flock(fd, LOCK_EX | LOCK_NB) == -1)
+        {
+                close(fd);
+                fd = -1;
+        }
+
+        return fd;
+}
+
+
+/** remove journal & its lock */
+static void _unlink(const char *path)
+{
+        gchar *name = g_strdup_printf("%s.lock", path);
+        unlink(path);
+        unlink(name);
+        g_free(name);
+}
+
+
+/**
+ * finish journal of previous setup (keep: journal of an unnamed setup with
+ * edits is kept for recovery, it's discarded when switching setups)
+ */
+static void _close(gboolean keep)
+{
+        if(_journal.filename)
+                _flush();
+        _wait();
+        g_hash_table_remove_all(_journal.dirty);
+
+        /* nothing else can find journal of unnamed setup again */
+        if(_journal.filename && _journal.unnamed &&
+           !(keep && _journal.edited))
+                _unlink(_journal.filename);
+        if(_journal.lock != -1)
+                close(_journal.lock);
+        _journal.lock = -1;
+
+        g_free(_journal.filename);
+        _journal.filename = NULL;
+        _journal.unnamed = false;
+        _journal.edited = false;
+        _journal.records = 0;
+}
+
+
+/**
+ * offer to recover a journal left from a crash that matches the current
+ * setup (now), replays it on success
+ */
+static gboolean _recover(const char *path, JournalHeader * now,
+                         const char *question)
+{
+        gchar *buf;
+        gsize length;
+        if(!g_file_get_contents(path, &buf, &length, NULL))
+                return false;
+
+        gboolean recovered = false;
+        JournalScan s;
+        if(_scan((const guint8 *) buf, length, &s) &&
+           s.header.flags == now->flags &&
+           s.header.base_size == now->base_size &&
+           s.header.base_mtime == now->base_mtime &&
+           (s.snapshot || s.records > 0) &&
+           ui_log_dialog_yesno("Recover", "%s", question))
+        {
+                _replay(&s);
+
+                /* continue journal after its last complete record */
+                if(truncate(path, s.end - (const guint8 *) buf) == 0)
+                {
+                        recovered = true;
+                        _journal.header = s.header;
+                        _journal.seq = s.seq;
+                        _journal.records = s.records;
+                        _journal.edited = true;
+                }
+        }
+
+        g_free(buf);
+        return recovered;
+}
+
+
+/**
+ * find journal of an unnamed setup left by a crashed instance or create
+ * a new one in the user's cache directory (takes its lock)
+ */
+static gchar *_unnamed(JournalHeader * now, gboolean * recovered)
+{
+        gchar *dir = g_build_filename(g_get_user_cache_dir(), "niftyconf",
+                                      NULL);
+        if(g_mkdir_with_parents(dir, 0700) == -1)
+        {
+                NFT_LOG(L_WARNING, "Failed to create \"%s\" - %s",
+                        dir, strerror(errno));
+                g_free(dir);
+                return NULL;
+        }
+
+        gchar *path = NULL;
+        GDir *d;
+        if((d = g_dir_open(dir, 0, NULL)))
+        {
+                const gchar *name;
+                while(!path && (name = g_dir_read_name(d)))
+                {
+                        if(!g_str_has_prefix(name, JOURNAL_UNNAMED) ||
+                           !g_str_has_suffix(name, ".journal"))
+                                continue;
+
+                        /* still used by another instance? */
+                        gchar *candidate = g_build_filename(dir, name, NULL);
+                        int lock;
+                        if((lock = _lock(candidate)) == -1)
+                        {
+                                g_free(candidate);
+                                continue;
+                        }
+
+                        if((*recovered = _recover(candidate, now,
+                                                  "An unnamed setup has unsaved changes from a previous session.\nRecover them?")))
+                        {
+                                path = candidate;
+                                _journal.lock = lock;
+                                break;
+                        }
+
+                        /* declined or nothing to recover */
+                        _unlink(candidate);
+                        close(lock);
+                        g_free(candidate);
+                }
+                g_dir_close(d);
+        }
+
+        /* new journal (locked before it exists) */
+        if(!path)
+        {
+                gchar *lock = g_build_filename(dir, JOURNAL_UNNAMED
+                                               "XXXXXX.journal.lock", NULL);
+                int fd;
+                if((fd = g_mkstemp(lock)) == -1 ||
+                   flock(fd, LOCK_EX | LOCK_NB) == -1)
+                {
+                        NFT_LOG(L_WARNING, "Failed to create \"%s\" - %s",
+                                lock, strerror(errno));
+                        if(fd != -1)
+                        {
+                                close(fd);
+                                unlink(lock);
+                        }
+                }
+                else
+                {
+                        path = g_strndup(lock, strlen(lock) - strlen(".lock"));
+                        _journal.lock = fd;
+                }
+                g_free(lock);
+        }
+
+        g_free(dir);
+        return path;
+}
+
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/**
+ * start journal for current setup that was loaded from filename (NULL for
+ * a new, unnamed setup), offer to recover edits from an existing journal
+ */
+void journal_open(const char *filename)
+{
+        _close(false);
+
+        JournalHeader now;
+        _stamp(filename, &now);
+
+        /* journal of this setup left from a crash? */
+        gboolean recovered = false;
+        gchar *path;
+        if(filename)
+        {
+                path = _filename(filename);
+
+                gchar *question = g_strdup_printf("\"%s\" has unsaved changes from a previous session.\nRecover them?",
+                                                  filename);
+                recovered = _recover(path, &now, question);
+                g_free(question);
+        }
+        else if(!(path = _unnamed(&now, &recovered)))
+        {
+                return;
+        }
+
+        _journal.filename = path;
+        _journal.unnamed = !filename;
+
+        /* start new journal */
+        if(!recovered)
+        {
+                _journal.header = now;
+                _restart(&now, NULL, false, 0);
+        }
+}
+
+
+/** sequence number of last edit (pass to journal_saved()) */
+guint journal_checkpoint()
+{
+        /* saved file contains all pending changes */
+        if(_journal.filename)
+                _commit();
+
+        return _journal.seq;
+}
+
+
+/** setup file was saved, it contains all edits up to checkpoint */
+void journal_saved(const char *filename, gpointer checkpoint)
+{
+        /* setup saved under another name or not current anymore */
+        const char *current = setup_get_current_filename();
+        if(!current || strcmp(current, filename) != 0)
+                return;
+
+        /* unnamed setup got a file, journal moves next to it */
+        if(_journal.unnamed)
+        {
+                if(_journal.seq != GPOINTER_TO_UINT(checkpoint))
+                        return;
+
+        }
+
+        if(!_journal.filename || _journal.unnamed)
+        {
+                journal_open(filename);
+                return;
+        }
+
+        /* keep only edits made after setup was saved */
+        JournalHeader h;
+        _stamp(filename, &h);
+        _flush();
+        _restart(&h, NULL, true, GPOINTER_TO_UINT(checkpoint));
+
+        _journal.header = h;
+        _journal.records = _journal.seq - GPOINTER_TO_UINT(checkpoint);
+}
+
+
+/** record that an element was added to the setup (after adding it) */
+void journal_record_insert(NIFTYLED_TYPE t, gpointer element)
+{
+        if(!_journal.filename || _journal.replaying)
+                return;
+
+        /* keep order of edits, paths change */
+        _commit();
+
+        LedPrefs *p = setup_get_prefs();
+        JournalRecord *rec = _record_new(JOURNAL_INSERT);
+        _put_u32(rec->payload, t);
+        _put_u32(rec->payload,
+                 t == LED_HARDWARE_T ? hardware_get_position(element) :
+                 t == LED_TILE_T ? tile_get_position(element) : 0);
+
+        gboolean result = false;
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        rec->node = led_prefs_hardware_to_node(p,
+                                                               hardware_niftyled
+                                                               (element));
+                        result = true;
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        LedTile *tile = tile_niftyled(element);
+                        LedTile *pt;
+                        if((pt = led_tile_get_parent_tile(tile)))
+                                result = _put_path(rec->payload, LED_TILE_T,
+                                                   led_tile_get_privdata(pt));
+                        else
+                                result = _put_path(rec->payload,
+                                                   LED_HARDWARE_T,
+                                                   led_hardware_get_privdata
+                                                   (led_tile_get_parent_hardware
+                                                    (tile)));
+                        rec->node = led_prefs_tile_to_node(p, tile);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedChain *c = chain_niftyled(element);
+                        result = _put_path(rec->payload, LED_TILE_T,
+                                           led_tile_get_privdata
+                                           (led_chain_get_parent_tile(c)));
+                        rec->node = led_prefs_chain_to_node(p, c);
+                        break;
+                }
+
+                default:
+                {
+                        break;
+                }
+        }
+
+        if(!result || !rec->node)
+        {
+                NFT_LOG(L_WARNING, "Failed to record inserted element");
+                _record_free(rec);
+                return;
+        }
+
+        _queue(rec);
+}
+
+
+/** record that an element is removed from the setup (before removing it) */
+void journal_record_remove(NIFTYLED_TYPE t, gpointer element)
+{
+        if(!_journal.filename || _journal.replaying)
+                return;
+
+        _commit();
+
+        JournalRecord *rec = _record_new(JOURNAL_REMOVE);
+        if(!_put_path(rec->payload, t, element))
+        {
+                NFT_LOG(L_WARNING, "Failed to record removed element");
+                _record_free(rec);
+                return;
+        }
+
+        _queue(rec);
+}
+
+
+/** note that properties of a range of LEDs change */
+void journal_record_leds(NiftyconfChain * c, LedCount first, LedCount last,
+                         UndoLedField field)
+{
+        if(!_journal.filename || _journal.replaying || last < first)
+                return;
+
+        JournalDirty *d = _dirty(LED_CHAIN_T, c);
+        if(!d->leds[field].set)
+        {
+                d->leds[field].set = true;
+                d->leds[field].first = first;
+                d->leds[field].last = last;
+        }
+        else
+        {
+                d->leds[field].first = MIN(d->leds[field].first, first);
+                d->leds[field].last = MAX(d->leds[field].last, last);
+        }
+
+        _journal.last = g_get_monotonic_time();
+}
+
+
+/** note that placement of a tile changes */
+void journal_record_tile(NiftyconfTile * t)
+{
+        if(!_journal.filename || _journal.replaying)
+                return;
+
+        _dirty(LED_TILE_T, t);
+        _journal.last = g_get_monotonic_time();
+}
+
+
+/** note that amount of LEDs of a chain changes to ledcount */
+void journal_record_ledcount(NiftyconfChain * c, LedCount ledcount)
+{
+        if(!_journal.filename || _journal.replaying)
+                return;
+
+        /* LED records refer to the old amount of LEDs */
+        _commit();
+
+        JournalRecord *rec = _record_new(JOURNAL_LEDCOUNT);
+        if(!_put_path(rec->payload, LED_CHAIN_T, c))
+        {
+                NFT_LOG(L_WARNING, "Failed to record amount of LEDs");
+                _record_free(rec);
+                return;
+        }
+
+        _put_u32(rec->payload, ledcount);
+
+        _queue(rec);
+}
+
+
+/** element is freed (its pending changes are obsolete) */
+void journal_forget(gpointer element)
+{
+        if(!_journal.dirty)
+                return;
+
+        g_hash_table_remove(_journal.dirty, element);
+}
+
+
+/** initialize this module */
+gboolean journal_init()
+{
+        /* register prefs class for this module */
+        if(!nft_prefs_class_register
+           (prefs(), "journal", _this_from_prefs, _this_to_prefs))
+                g_error("Failed to register prefs class for \"journal\"");
+
+        _journal.lock = -1;
+        _journal.queue = g_ptr_array_new_with_free_func(_record_free);
+        _journal.dirty = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                               NULL, _dirty_free);
+        _journal.flush_interval = JOURNAL_FLUSH_INTERVAL;
+        _journal.compact_idle = JOURNAL_COMPACT_IDLE;
+        _timer_start();
+
+        return true;
+}
+
+
+/** deinitialize this module (writes everything that's still queued) */
+void journal_deinit()
+{
+        if(_journal.timer)
+                g_source_remove(_journal.timer);
+        _journal.timer = 0;
+
+        _close(true);
+
+        g_ptr_array_free(_journal.queue, true);
+        _journal.queue = NULL;
+        g_hash_table_destroy(_journal.dirty);
+        _journal.dirty = NULL;
+
+        /* unregister prefs class */
+        nft_prefs_class_unregister(prefs(), "journal");
+}
@@ -0,0 +1,413 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "ui/ui-log.h"
+#include "ui/ui-setup-tree.h"
+#include "elements/element-chain.h"
+#include "elements/element-tile.h"
+#include "elements/element-hardware.h"
+#include "renderer/renderer-chain.h"
+#include "renderer/renderer-tile.h"
+#include "renderer/renderer-setup.h"
+#include "spatial-index/spatial-index.h"
+#include "undo/undo.h"
+#include "layout/layout.h"
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** place LED n of a chain at grid cell x/y */
+static void _place(LedChain * c, LedCount n,
+                   LedFrameCord x, LedFrameCord y, const LayoutParams * p)
+{
+        led_set_pos(led_chain_get_nth(c, n), x * p->stride_x,
+                    y * p->stride_y);
+}
+
+
+/** place LEDs along a clockwise spiral through a w*h grid */
+static void _fill_spiral(LedChain * c, LedCount count,
+                         LedFrameCord w, LedFrameCord h,
+                         const LayoutParams * p)
+{
+        LedFrameCord left = 0, top = 0, right = w - 1, bottom = h - 1;
+        LedFrameCord x, y;
+        LedCount n = 0;
+
+        while(n < count && left <= right && top <= bottom)
+        {
+                /* top row */
+                for(x = left; x <= right && n < count; x++)
+                        _place(c, n++, x, top, p);
+                top++;
+
+                /* right column */
+                for(y = top; y <= bottom && n < count; y++)
+                        _place(c, n++, right, y, p);
+                right--;
+
+                /* bottom row */
+                if(top <= bottom)
+                {
+                        for(x = right; x >= left && n < count; x--)
+                                _place(c, n++, x, bottom, p);
+                        bottom--;
+                }
+
+                /* left column */
+                if(left <= right)
+                {
+                        for(y = bottom; y >= top && n < count; y--)
+                                _place(c, n++, left, y, p);
+                        left++;
+                }
+        }
+}
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/**
+ * set position of all LEDs of a niftyled chain according to pattern
+ * (doesn't update anything in the GUI)
+ */
+NftResult layout_fill_chain(LedChain * c, const LayoutParams * p)
+{
+        if(!c || !p)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(p->width <= 0)
+        {
+                NFT_LOG(L_ERROR, "Layout needs at least one LED per row");
+                return NFT_FAILURE;
+        }
+
+        /* rows/columns needed for all LEDs */
+        LedCount count = led_chain_get_ledcount(c);
+        LedFrameCord lines = (LedFrameCord) ((count + p->width - 1) /
+                                             p->width);
+
+        LedCount n;
+        switch (p->pattern)
+        {
+                case LAYOUT_ROWS:
+                {
+                        for(n = 0; n < count; n++)
+                                _place(c, n, n % p->width, n / p->width, p);
+                        break;
+                }
+
+                case LAYOUT_SERPENTINE:
+                {
+                        for(n = 0; n < count; n++)
+                        {
+                                LedFrameCord x = n % p->width;
+                                LedFrameCord y = n / p->width;
+                                _place(c, n,
+                                       (y % 2) ? p->width - 1 - x : x, y, p);
+                        }
+                        break;
+                }
+
+                case LAYOUT_COLUMNS:
+                {
+                        for(n = 0; n < count; n++)
+                                _place(c, n, n / p->width, n % p->width, p);
+                        break;
+                }
+
+                case LAYOUT_SPIRAL:
+                {
+                        _fill_spiral(c, count, p->width, lines, p);
+                        break;
+                }
+
+                default:
+                {
+                        NFT_LOG(L_ERROR, "Unknown layout pattern %d",
+                                p->pattern);
+                        return NFT_FAILURE;
+                }
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** lay out all LEDs of a chain in the current setup */
+NftResult layout_chain(NiftyconfChain * chain, const LayoutParams * p)
+{
+        if(!chain)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        /* all LEDs move */
+        LedCount count = led_chain_get_ledcount(chain_niftyled(chain));
+        if(count > 0)
+                undo_record_leds(chain, 0, count - 1, UNDO_LED_POS);
+
+        if(!layout_fill_chain(chain_niftyled(chain), p))
+                return NFT_FAILURE;
+
+        /* update everything that depends on LED positions once */
+        spatial_index_update_chain(chain);
+        ui_setup_tree_update_element(LED_CHAIN_T, chain);
+        renderer_chain_damage(chain);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * create columns*rows tiles with one chain each under a hardware,
+ * LEDs of every chain are placed according to p
+ */
+NftResult layout_grid(NiftyconfHardware * hw,
+                      LedFrameCord columns, LedFrameCord rows,
+                      LedCount ledcount, const char *pixelformat,
+                      const LayoutParams * p)
+{
+        if(!hw || !p)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        LedHardware *h = hardware_niftyled(hw);
+
+        if(p->width <= 0 || ledcount == 0 || columns <= 0 || rows <= 0)
+        {
+                ui_log_alert_show("Invalid grid of %dx%d tiles with %d LEDs",
+                                  columns, rows, ledcount);
+                return NFT_FAILURE;
+        }
+
+        /* size of one tile */
+        LedFrameCord w = p->pattern == LAYOUT_COLUMNS ?
+                (LedFrameCord) ((ledcount + p->width - 1) / p->width) :
+                p->width;
+        LedFrameCord hgt = p->pattern == LAYOUT_COLUMNS ?
+                p->width :
+                (LedFrameCord) ((ledcount + p->width - 1) / p->width);
+
+        /* all LEDs of a chain must fit into one tile */
+        if((LedCount) w * (LedCount) hgt < ledcount)
+        {
+                ui_log_alert_show("%d LEDs don't fit into a %dx%d tile",
+                                  ledcount, w, hgt);
+                return NFT_FAILURE;
+        }
+
+        /* build all tiles before anything is registered */
+        GPtrArray *tiles = g_ptr_array_sized_new(columns * rows);
+        LedFrameCord x, y;
+        guint i;
+        for(y = 0; y < rows; y++)
+        {
+                for(x = 0; x < columns; x++)
+                {
+                        LedTile *t;
+                        if(!(t = led_tile_new()))
+                                goto _lg_error;
+
+                        LedChain *c;
+                        if(!(c = led_chain_new(ledcount, pixelformat)))
+                        {
+                                led_tile_destroy(t);
+                                goto _lg_error;
+                        }
+
+                        /* tile owns chain from here on */
+                        led_tile_set_chain(t, c);
+                        if(!layout_fill_chain(c, p))
+                        {
+                                led_tile_destroy(t);
+                                goto _lg_error;
+                        }
+
+                        led_tile_set_pos(t, x * w * p->stride_x,
+                                         y * hgt * p->stride_y);
+
+                        g_ptr_array_add(tiles, t);
+                }
+        }
+
+        /* attach tiles to hardware & register them in one pass */
+        undo_group_begin();
+        for(i = 0; i < tiles->len; i++)
+        {
+                LedTile *t = g_ptr_array_index(tiles, i);
+
+                LedTile *first;
+                if(!(first = led_hardware_get_tile(h)))
+                        led_hardware_set_tile(h, t);
+                else
+                        led_tile_list_append_head(first, t);
+
+                NiftyconfTile *tile;
+                if(!(tile = tile_register_to_gui(t)))
+                {
+                        /* remove tiles added so far */
+                        led_tile_destroy(t);
+                        g_ptr_array_remove_range(tiles, 0, i + 1);
+                        undo_group_cancel();
+                        ui_setup_tree_refresh();
+                        renderer_setup_damage();
+                        goto _lg_error;
+                }
+
+                spatial_index_update_tile(tile);
+                undo_record_insert(LED_TILE_T, tile);
+        }
+        undo_group_end();
+
+        g_ptr_array_free(tiles, true);
+
+        /* show new tiles */
+        ui_setup_tree_refresh();
+        renderer_setup_damage();
+
+        return NFT_SUCCESS;
+
+_lg_error:
+        ui_log_alert_show("Failed to create %dx%d tiles", columns, rows);
+
+        for(i = 0; i < tiles->len; i++)
+                led_tile_destroy(g_ptr_array_index(tiles, i));
+        g_ptr_array_free(tiles, true);
+
+        return NFT_FAILURE;
+}
+
+
+/**
+ * place columns*rows copies of a tile next to it (the tile itself
+ * counts as the first copy), each copy is step_x/step_y away from
+ * the previous one
+ */
+NftResult layout_tile_array(NiftyconfTile * tile,
+                            LedFrameCord columns, LedFrameCord rows,
+                            LedFrameCord step_x, LedFrameCord step_y)
+{
+        if(!tile)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        LedTile *t = tile_niftyled(tile);
+        LedTile *parent = led_tile_get_parent_tile(t);
+
+        /* hardware of top-level tile this one belongs to */
+        LedTile *root;
+        for(root = t; led_tile_get_parent_tile(root);
+            root = led_tile_get_parent_tile(root));
+        LedHardware *h = led_tile_get_parent_hardware(root);
+        if(!h)
+        {
+                ui_log_alert_show("Tile has no parent to add copies to");
+                return NFT_FAILURE;
+        }
+
+        LedFrameCord tX, tY;
+        led_tile_get_pos(t, &tX, &tY);
+
+        /* copy niftyled objects before anything is registered */
+        GPtrArray *copies = g_ptr_array_sized_new(columns * rows);
+        LedFrameCord x, y;
+        guint i;
+        for(y = 0; y < rows; y++)
+        {
+                for(x = 0; x < columns; x++)
+                {
+                        /* first copy is the template itself */
+                        if(x == 0 && y == 0)
+                                continue;
+
+                        LedTile *n;
+                        if(!(n = tile_clone(t)))
+                                goto _lta_error;
+
+                        led_tile_set_pos(n, tX + x * step_x, tY + y * step_y);
+                        g_ptr_array_add(copies, n);
+                }
+        }
+
+        /* attach copies next to template & register them in one pass */
+        undo_group_begin();
+        for(i = 0; i < copies->len; i++)
+        {
+                LedTile *n = g_ptr_array_index(copies, i);
+
+                if(parent)
+                        led_tile_list_append_child(parent, n);
+                else
+                        led_tile_list_append_head(t, n);
+
+                NiftyconfTile *nt;
+                if((nt = tile_register_to_gui(n)))
+                {
+                        spatial_index_update_tile(nt);
+                        undo_record_insert(LED_TILE_T, nt);
+                }
+        }
+        undo_group_end();
+
+        g_ptr_array_free(copies, true);
+
+        /* copied LED gains */
+        led_hardware_refresh_gain(h);
+
+        /* show new tiles */
+        ui_setup_tree_refresh();
+        renderer_tile_damage_placement(tile);
+
+        return NFT_SUCCESS;
+
+_lta_error:
+        ui_log_alert_show("Failed to copy tile %dx%d times", columns, rows);
+
+        for(i = 0; i < copies->len; i++)
+                led_tile_destroy(g_ptr_array_index(copies, i));
+        g_ptr_array_free(copies, true);
+
+        return NFT_FAILURE;
+}
@@ -0,0 +1,84 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _LAYOUT_H
+#define _LAYOUT_H
+
+#include "elements/element-hardware.h"
+#include "elements/element-chain.h"
+#include "elements/element-tile.h"
+
+
+/** order in which the LEDs of a chain are placed */
+typedef enum
+{
+        /* left to right, row by row */
+        LAYOUT_ROWS = 0,
+        /* like LAYOUT_ROWS but every other row right to left (zigzag) */
+        LAYOUT_SERPENTINE,
+        /* top to bottom, column by column */
+        LAYOUT_COLUMNS,
+        /* clockwise from the top left corner towards the center */
+        LAYOUT_SPIRAL,
+        NUM_LAYOUT_PATTERNS,
+} LayoutPattern;
+
+
+/** how to lay out the LEDs of a chain */
+typedef struct
+{
+        LayoutPattern pattern;
+        /** LEDs per row (per column for LAYOUT_COLUMNS) */
+        LedFrameCord width;
+        /** distance between neighbouring LEDs */
+        LedFrameCord stride_x, stride_y;
+} LayoutParams;
+
+
+
+NftResult                       layout_fill_chain(LedChain * c, const LayoutParams * p);
+NftResult                       layout_chain(NiftyconfChain * chain, const LayoutParams * p);
+NftResult                       layout_grid(NiftyconfHardware * hw, LedFrameCord columns, LedFrameCord rows, LedCount ledcount, const char *pixelformat, const LayoutParams * p);
+NftResult                       layout_tile_array(NiftyconfTile * tile, LedFrameCord columns, LedFrameCord rows, LedFrameCord step_x, LedFrameCord step_y);
+
+#endif /* _LAYOUT_H */
@@ -99,6 +99,17 @@ static void _fill_chain(LedChain * c, long long int val)
 }
 
 
+static void _fill_range(LedChain * c, LedCount first, LedCount last,
+                        long long int val)
+{
+        LedCount i;
+        for(i = first; i <= last && i < led_chain_get_ledcount(c); i++)
+        {
+                led_chain_set_greyscale(c, i, val);
+        }
+}
+
+
 static void _fill_tile(LedTile * t, long long int val)
 {
         /* does tile have a chain? */
@@ -226,6 +237,93 @@ void live_preview_highlight_tile(NiftyconfTile * tile)
 }
 
 
+void live_preview_unhighlight_chain(NiftyconfChain * chain)
+{
+        if(!_enabled)
+                return;
+
+        if(!chain)
+                NFT_LOG_NULL();
+
+        LedChain *c;
+        if(!(c = chain_niftyled(chain)))
+                NFT_LOG_NULL();
+
+        _fill_chain(c, 0);
+
+        /* if chain belongs to tile, refresh mapping */
+        if(led_chain_get_parent_tile(c))
+                _refresh_mapping = true;
+}
+
+
+void live_preview_unhighlight_hardware(NiftyconfHardware * hardware)
+{
+        if(!_enabled)
+                return;
+
+        if(!hardware)
+                NFT_LOG_NULL();
+
+        LedHardware *h = hardware_niftyled(hardware);
+        _fill_chain(led_hardware_get_chain(h), 0);
+}
+
+
+void live_preview_unhighlight_tile(NiftyconfTile * tile)
+{
+        if(!_enabled)
+                return;
+
+        if(!tile)
+                NFT_LOG_NULL();
+
+        LedTile *t;
+        if(!(t = tile_niftyled(tile)))
+                return;
+
+        _fill_tile(t, 0);
+
+        _refresh_mapping = true;
+}
+
+
+void live_preview_highlight_range(NiftyconfChain * chain,
+                                  LedCount first, LedCount last)
+{
+        if(!_enabled)
+                return;
+
+        if(!chain)
+                NFT_LOG_NULL();
+
+        LedChain *c = chain_niftyled(chain);
+        _fill_range(c, first, last, -1);
+
+        /* if chain belongs to tile, refresh mapping */
+        if(led_chain_get_parent_tile(c))
+                _refresh_mapping = true;
+}
+
+
+void live_preview_unhighlight_range(NiftyconfChain * chain,
+                                    LedCount first, LedCount last)
+{
+        if(!_enabled)
+                return;
+
+        if(!chain)
+                NFT_LOG_NULL();
+
+        LedChain *c = chain_niftyled(chain);
+        _fill_range(c, first, last, 0);
+
+        /* if chain belongs to tile, refresh mapping */
+        if(led_chain_get_parent_tile(c))
+                _refresh_mapping = true;
+}
+
+
 void live_preview_highlight_led(NiftyconfLed * led)
 {
         if(!_enabled)
@@ -245,8 +343,6 @@ void live_preview_highlight_led(NiftyconfLed * led)
         /* if chain belongs to tile, refresh mapping */
         if(led_chain_get_parent_tile(c))
                 _refresh_mapping = true;
-
-        led_chain_print(c, L_INFO);
 }
 
 
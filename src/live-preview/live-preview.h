@@ -59,6 +59,11 @@ void                            live_preview_highlight_chain(NiftyconfChain * ch
 void                            live_preview_highlight_hardware(NiftyconfHardware * h);
 void                            live_preview_highlight_tile(NiftyconfTile * t);
 void                            live_preview_highlight_led(NiftyconfLed * l);
+void                            live_preview_highlight_range(NiftyconfChain * chain, LedCount first, LedCount last);
+void                            live_preview_unhighlight_range(NiftyconfChain * chain, LedCount first, LedCount last);
+void                            live_preview_unhighlight_chain(NiftyconfChain * chain);
+void                            live_preview_unhighlight_hardware(NiftyconfHardware * h);
+void                            live_preview_unhighlight_tile(NiftyconfTile * t);
 void                            live_preview_show();
 void                            live_preview_set_enabled(bool enable);
 bool                            live_preview_get_enabled();
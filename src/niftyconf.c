@@ -41,6 +41,8 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
@@ -57,10 +59,22 @@
 #include "prefs/prefs.h"
 #include "renderer/renderer.h"
 #include "live-preview/live-preview.h"
+#include "spatial-index/spatial-index.h"
+#include "validator/validator.h"
+#include "undo/undo.h"
+#include "journal/journal.h"
+#include "cache/cache.h"
+#include "export/export.h"
+#include "niftyconf.h"
 #include "config.h"
 
 
 
+/** permissions of newly created files (umask applied) */
+static mode_t _file_mode;
+
+
+
 
 
 
@@ -118,6 +132,11 @@ static NftResult _this_to_prefs(NftPrefs * prefs,
                                 void *obj, void *userptr)
 {
 
+        /* submodules */
+        nft_prefs_node_add_child(newNode,
+                                 nft_prefs_obj_to_node(prefs, "journal", NULL,
+                                                       NULL));
+
         /* mark that we were launched before */
         nft_prefs_node_prop_boolean_set(newNode, "launched_before", true);
 
@@ -135,20 +154,89 @@ static NftResult _this_to_prefs(NftPrefs * prefs,
 }
 
 
+/** export LED geometry and/or mapping of a setup file without GUI */
+static gboolean _export_setup(const gchar * setupfile,
+                              const gchar * geometryfile,
+                              const gchar * mappingfile)
+{
+        if(!setupfile)
+        {
+                g_warning("Exporting needs a config file (--config)");
+                return false;
+        }
+
+        LedPrefs *p;
+        if(!(p = led_prefs_init()))
+                return false;
+
+        /* unchanged setup? restore it from cache */
+        LedSetup *s;
+        if(!(s = cache_load(setupfile)))
+        {
+                LedPrefsNode *n;
+                if((n = led_prefs_node_from_file(p, setupfile)))
+                {
+                        s = led_prefs_setup_from_node(p, n);
+                        led_prefs_node_free(n);
+                }
+        }
+
+        gboolean result = false;
+        if(!s)
+        {
+                g_warning("Failed to initialize setup from \"%s\"", setupfile);
+                goto _es_exit;
+        }
+
+        result = true;
+        if(geometryfile &&
+           !export_geometry(s, geometryfile,
+                            export_format_from_filename(geometryfile)))
+        {
+                g_warning("Failed to export LED geometry to \"%s\"",
+                          geometryfile);
+                result = false;
+        }
+
+        if(mappingfile && !export_mapping(s, mappingfile))
+        {
+                g_warning("Failed to export mapping table to \"%s\"",
+                          mappingfile);
+                result = false;
+        }
+
+        led_setup_destroy(s);
+
+_es_exit:
+        led_prefs_deinit(p);
+        return result;
+}
+
+
 /** parse commandline arguments */
 static gboolean _parse_cmdline_args(int argc,
-                                    char *argv[], gchar ** setupfile)
+                                    char *argv[], gchar ** setupfile,
+                                    gchar ** geometryfile,
+                                    gchar ** mappingfile)
 {
         static gchar loglevelmsg[1024];
         g_snprintf(loglevelmsg, sizeof(loglevelmsg), "define loglevel (%s)",
                    ui_log_loglevels());
         static gchar *loglevel;
         static gchar *sf;
+        static gchar *gf;
+        static gchar *mf;
         static GOptionEntry entries[] = {
                 {"config", 'c', 0, G_OPTION_ARG_FILENAME, &sf,
                  "Initialize setup from XML config file", NULL},
                 {"loglevel", 'l', 0, G_OPTION_ARG_STRING, &loglevel,
                  loglevelmsg, NULL},
+                {"export-geometry", 'g', 0, G_OPTION_ARG_FILENAME, &gf,
+                 "Export LED positions of config file (.csv, .jsonl, .bin) and exit",
+                 NULL},
+                {"export-mapping", 'm', 0, G_OPTION_ARG_FILENAME, &mf,
+                 "Export resolved LED mapping table of config file and exit",
+                 NULL},
                 {NULL, 0, 0, 0, NULL, NULL, NULL}
         };
 
@@ -172,6 +260,16 @@ static gboolean _parse_cmdline_args(int argc,
                 *setupfile = sf;
         }
 
+        /* export instead of starting GUI? */
+        if(gf)
+        {
+                *geometryfile = gf;
+        }
+        if(mf)
+        {
+                *mappingfile = mf;
+        }
+
         /* set loglevel */
         if(loglevel)
         {
@@ -200,8 +298,19 @@ static gboolean _parse_cmdline_args(int argc,
 /******************************************************************************
  ******************************************************************************/
 
+/** permissions for files we create (umask can't be read without changing it) */
+mode_t niftyconf_file_mode()
+{
+        return _file_mode;
+}
+
+
 int main(int argc, char *argv[])
 {
+        /* umask is process-wide, read it before any thread is started */
+        mode_t mask = umask(0);
+        umask(mask);
+        _file_mode = 0666 & ~mask;
 
         bindtextdomain(PACKAGE_NAME, NULL);
         bind_textdomain_codeset(PACKAGE_NAME, "UTF-8");
@@ -224,13 +333,29 @@ int main(int argc, char *argv[])
 
         /* parse commandline arguments */
         static gchar *setupfile;
-        if(!_parse_cmdline_args(argc, argv, &setupfile))
+        static gchar *geometryfile;
+        static gchar *mappingfile;
+        if(!_parse_cmdline_args(argc, argv, &setupfile, &geometryfile,
+                                &mappingfile))
                 return EXIT_FAILURE;
 
+        /* only export? */
+        if(geometryfile || mappingfile)
+                return _export_setup(setupfile, geometryfile, mappingfile) ?
+                        EXIT_SUCCESS : EXIT_FAILURE;
+
 
         /* initialize modules */
         if(!prefs_init())
                 g_error("Failed to initialize \"prefs\" module");
+        if(!spatial_index_init())
+                g_error("Failed to initialize \"spatial-index\" module");
+        if(!validator_init())
+                g_error("Failed to initialize \"validator\" module");
+        if(!undo_init())
+                g_error("Failed to initialize \"undo\" module");
+        if(!journal_init())
+                g_error("Failed to initialize \"journal\" module");
         if(!led_init())
                 g_error("Failed to initialize \"led\" module");
         if(!chain_init())
@@ -276,12 +401,18 @@ int main(int argc, char *argv[])
         /* unregister prefs class */
         nft_prefs_class_unregister(prefs(), "main");
 
+        /* finishes pending saves, they update the journal */
         ui_deinit();
+        /* write pending edits while setup still exists */
+        journal_deinit();
         live_preview_deinit();
         setup_deinit();
         hardware_deinit();
         tile_deinit();
         led_deinit();
+        undo_deinit();
+        validator_deinit();
+        spatial_index_deinit();
         prefs_deinit();
 
         return EXIT_SUCCESS;
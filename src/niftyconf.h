@@ -44,12 +44,15 @@
 #ifndef _NIFTYCONF_H
 #define _NIFTYCONF_H
 
+#include <sys/types.h>
+
 
 /* GUI model functions */
 
 /* GUI functions */
 
 /* model functions */
+mode_t                          niftyconf_file_mode();
 
 
 #endif /* _NIFTYCONF_H */
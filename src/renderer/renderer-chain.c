@@ -130,6 +130,48 @@ static NftResult _render_chain(cairo_surface_t ** s, gpointer element)
         return NFT_SUCCESS;
 }
 
+
+/** content hash of a rendered chain */
+static guint64 _hash_chain(gpointer element)
+{
+        NiftyconfChain *chain = (NiftyconfChain *) element;
+        LedChain *c = chain_niftyled(chain);
+
+        NIFTYLED_TYPE type = LED_CHAIN_T;
+        LedCount count = led_chain_get_ledcount(c);
+        int width, height;
+        led_chain_get_max_pos(c, &width, &height);
+        gdouble scale = ui_renderer_scale_factor();
+        cairo_filter_t filter = ui_renderer_filter();
+        cairo_antialias_t antialias = ui_renderer_antialias();
+
+        guint64 h = RENDERER_HASH_INIT;
+        h = renderer_hash(h, &type, sizeof(type));
+        h = renderer_hash(h, &count, sizeof(count));
+        h = renderer_hash(h, &width, sizeof(width));
+        h = renderer_hash(h, &height, sizeof(height));
+        h = renderer_hash(h, &scale, sizeof(scale));
+        h = renderer_hash(h, &filter, sizeof(filter));
+        h = renderer_hash(h, &antialias, sizeof(antialias));
+
+        /* position & look of every LED */
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                Led *l = led_chain_get_nth(c, i);
+                LedFrameCord x, y;
+                led_get_pos(l, &x, &y);
+                guint64 lh = renderer_get_hash(led_get_renderer
+                                               (led_get_privdata(l)));
+
+                h = renderer_hash(h, &x, sizeof(x));
+                h = renderer_hash(h, &y, sizeof(y));
+                h = renderer_hash(h, &lh, sizeof(lh));
+        }
+
+        return h;
+}
+
 /******************************************************************************
  ******************************************************************************/
 
@@ -164,8 +206,15 @@ NiftyconfRenderer *renderer_chain_new(NiftyconfChain * chain)
         width = (width + 1) * ui_renderer_scale_factor();
         height = (height + 1) * ui_renderer_scale_factor();
 
-        return renderer_new(LED_CHAIN_T, chain, &_render_chain, width,
-                            height);
+        NiftyconfRenderer *r;
+        if(!(r = renderer_new(LED_CHAIN_T, chain, &_render_chain, width,
+                              height)))
+                return NULL;
+
+        /* identical chains share one surface */
+        renderer_set_hash_func(r, &_hash_chain);
+
+        return r;
 }
 
 
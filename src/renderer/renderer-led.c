@@ -134,12 +134,47 @@ static NftResult _render_led(cairo_surface_t ** s, gpointer element)
                 cairo_fill(cr);
         }
 
+        /* does led have an invalid position? */
+        if(led_get_problems(led))
+        {
+                cairo_set_source_rgb(cr, 1, 0, 1);
+                cairo_set_line_width(cr, 2);
+                cairo_move_to(cr, 0, 0);
+                cairo_line_to(cr, w * 3, h);
+                cairo_move_to(cr, w * 3, 0);
+                cairo_line_to(cr, 0, h);
+                cairo_stroke(cr);
+        }
+
         cairo_destroy(cr);
 
         return NFT_SUCCESS;
 }
 
 
+/** content hash of a rendered LED */
+static guint64 _hash_led(gpointer element)
+{
+        NiftyconfLed *led = (NiftyconfLed *) element;
+        Led *l = led_niftyled(led);
+
+        NIFTYLED_TYPE type = LED_T;
+        LedFrameComponent component = led_get_component(l);
+        gboolean highlighted = led_get_highlighted(led);
+        guint problems = led_get_problems(led);
+        gdouble scale = ui_renderer_scale_factor();
+
+        guint64 h = RENDERER_HASH_INIT;
+        h = renderer_hash(h, &type, sizeof(type));
+        h = renderer_hash(h, &component, sizeof(component));
+        h = renderer_hash(h, &highlighted, sizeof(highlighted));
+        h = renderer_hash(h, &problems, sizeof(problems));
+        h = renderer_hash(h, &scale, sizeof(scale));
+
+        return h;
+}
+
+
 /******************************************************************************
  ******************************************************************************/
 
@@ -160,9 +195,16 @@ NiftyconfRenderer *renderer_led_new(NiftyconfLed * led)
         if(!led)
                 NFT_LOG_NULL(NULL);
 
-        return renderer_new(LED_T, led, &_render_led,
-                            ui_renderer_scale_factor(),
-                            ui_renderer_scale_factor());
+        NiftyconfRenderer *r;
+        if(!(r = renderer_new(LED_T, led, &_render_led,
+                              ui_renderer_scale_factor(),
+                              ui_renderer_scale_factor())))
+                return NULL;
+
+        /* all LEDs with same look share one surface */
+        renderer_set_hash_func(r, &_hash_led);
+
+        return r;
 }
 
 
@@ -284,6 +284,65 @@ static NftResult _render_tile(cairo_surface_t ** s, gpointer element)
 }
 
 
+/** content hash of a rendered tile */
+static guint64 _hash_tile(gpointer element)
+{
+        NiftyconfTile *tile = (NiftyconfTile *) element;
+        LedTile *t = tile_niftyled(tile);
+
+        NIFTYLED_TYPE type = LED_TILE_T;
+        LedFrameCord w, h;
+        led_tile_get_dim(t, &w, &h);
+        double pX, pY;
+        led_tile_get_pivot(t, &pX, &pY);
+        gboolean highlighted = tile_get_highlighted(tile);
+        gdouble scale = ui_renderer_scale_factor();
+        cairo_filter_t filter = ui_renderer_filter();
+        cairo_antialias_t antialias = ui_renderer_antialias();
+
+        guint64 hash = RENDERER_HASH_INIT;
+        hash = renderer_hash(hash, &type, sizeof(type));
+        hash = renderer_hash(hash, &w, sizeof(w));
+        hash = renderer_hash(hash, &h, sizeof(h));
+        hash = renderer_hash(hash, &pX, sizeof(pX));
+        hash = renderer_hash(hash, &pY, sizeof(pY));
+        hash = renderer_hash(hash, &highlighted, sizeof(highlighted));
+        hash = renderer_hash(hash, &scale, sizeof(scale));
+        hash = renderer_hash(hash, &filter, sizeof(filter));
+        hash = renderer_hash(hash, &antialias, sizeof(antialias));
+
+        /* placement & content of children */
+        LedTile *ct;
+        for(ct = led_tile_get_child(t); ct; ct = led_tile_list_get_next(ct))
+        {
+                LedFrameCord x, y;
+                led_tile_get_pos(ct, &x, &y);
+                led_tile_get_pivot(ct, &pX, &pY);
+                double rotation = led_tile_get_rotation(ct);
+                guint64 ch = renderer_get_hash(tile_get_renderer
+                                               (led_tile_get_privdata(ct)));
+
+                hash = renderer_hash(hash, &x, sizeof(x));
+                hash = renderer_hash(hash, &y, sizeof(y));
+                hash = renderer_hash(hash, &pX, sizeof(pX));
+                hash = renderer_hash(hash, &pY, sizeof(pY));
+                hash = renderer_hash(hash, &rotation, sizeof(rotation));
+                hash = renderer_hash(hash, &ch, sizeof(ch));
+        }
+
+        /* content of chain */
+        LedChain *c;
+        if((c = led_tile_get_chain(t)))
+        {
+                guint64 ch = renderer_get_hash(chain_get_renderer
+                                               (led_chain_get_privdata(c)));
+                hash = renderer_hash(hash, &ch, sizeof(ch));
+        }
+
+        return hash;
+}
+
+
 /******************************************************************************
  ******************************************************************************/
 
@@ -308,6 +367,20 @@ void renderer_tile_damage(NiftyconfTile * tile)
 }
 
 
+/**
+ * damage renderers that composite this tile (after its placement changed,
+ * the tile's own surface stays valid)
+ */
+void renderer_tile_damage_placement(NiftyconfTile * tile)
+{
+        LedTile *pt;
+        if((pt = led_tile_get_parent_tile(tile_niftyled(tile))))
+                renderer_tile_damage(led_tile_get_privdata(pt));
+        else
+                renderer_damage(setup_get_renderer());
+}
+
+
 /** allocate new renderer for a Tile */
 NiftyconfRenderer *renderer_tile_new(NiftyconfTile * tile)
 {
@@ -323,7 +396,15 @@ NiftyconfRenderer *renderer_tile_new(NiftyconfTile * tile)
         width *= ui_renderer_scale_factor();
         height *= ui_renderer_scale_factor();
 
-        return renderer_new(LED_TILE_T, tile, &_render_tile, width, height);
+        NiftyconfRenderer *r;
+        if(!(r = renderer_new(LED_TILE_T, tile, &_render_tile, width,
+                              height)))
+                return NULL;
+
+        /* identical tiles share one surface */
+        renderer_set_hash_func(r, &_hash_tile);
+
+        return r;
 }
 
 
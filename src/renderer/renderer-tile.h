@@ -48,6 +48,7 @@
 
 NiftyconfRenderer              *renderer_tile_new(NiftyconfTile * tile);
 void                            renderer_tile_damage(NiftyconfTile * tile);
+void                            renderer_tile_damage_placement(NiftyconfTile * tile);
 
 
 
@@ -66,19 +66,187 @@ struct _NiftyconfRenderer
         NiftyconfRenderFunc *render;
                 /** rendering offset */
         gdouble xOffset, yOffset;
+                /** content hash function (NULL if surface can't be shared) */
+        NiftyconfHashFunc *hash;
+                /** content hash of current surface */
+        guint64 content;
 };
 
 
+/** one surface in the cache of shared surfaces */
+typedef struct
+{
+                /** content hash (key in _cache) */
+        guint64 hash;
+                /** shared surface (not referenced by the cache) */
+        cairo_surface_t *surface;
+                /** rendering offset of this surface */
+        gdouble xOffset, yOffset;
+} CacheEntry;
+
+
+/** surfaces of all renderers with hash function: guint64 -> CacheEntry */
+static GHashTable *_cache;
+/** key to attach CacheEntry to surfaces */
+static cairo_user_data_key_t _cache_key;
+
+
 
 
 /******************************************************************************
  ****************************** STATIC FUNCTIONS ******************************
  ******************************************************************************/
 
+/** remove entry from cache (called when its surface is destroyed) */
+static void _cache_entry_free(void *data)
+{
+        CacheEntry *e = data;
+
+        g_hash_table_remove(_cache, &e->hash);
+        g_slice_free(CacheEntry, e);
+}
+
+
+/** put freshly rendered surface of renderer into cache */
+static void _cache_add(NiftyconfRenderer * r)
+{
+        if(!_cache)
+                _cache = g_hash_table_new(g_int64_hash, g_int64_equal);
+
+        CacheEntry *e = g_slice_new(CacheEntry);
+        e->hash = r->content;
+        e->surface = r->surface;
+        e->xOffset = r->xOffset;
+        e->yOffset = r->yOffset;
+
+        g_hash_table_insert(_cache, &e->hash, e);
+
+        /* entry lives as long as the surface */
+        cairo_surface_set_user_data(r->surface, &_cache_key, e,
+                                    _cache_entry_free);
+}
+
+
+/** use cached surface for renderer (return false if there's none) */
+static gboolean _cache_lookup(NiftyconfRenderer * r, guint64 hash)
+{
+        CacheEntry *e;
+        if(!_cache || !(e = g_hash_table_lookup(_cache, &hash)))
+                return false;
+
+        cairo_surface_t *s = cairo_surface_reference(e->surface);
+        cairo_surface_destroy(r->surface);
+        r->surface = s;
+        r->xOffset = e->xOffset;
+        r->yOffset = e->yOffset;
+        r->content = hash;
+
+        return true;
+}
+
+
+/** make sure surface of renderer can be drawn to without affecting others */
+static gboolean _cache_unshare(NiftyconfRenderer * r)
+{
+        /* surface used by other renderers? */
+        if(cairo_surface_get_reference_count(r->surface) > 1)
+        {
+                cairo_surface_t *s;
+                if(!(s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                                    cairo_image_surface_get_width
+                                                    (r->surface),
+                                                    cairo_image_surface_get_height
+                                                    (r->surface))))
+                        return false;
+
+                cairo_surface_destroy(r->surface);
+                r->surface = s;
+        }
+        /* content will change, so remove surface from cache */
+        else
+        {
+                cairo_surface_set_user_data(r->surface, &_cache_key, NULL,
+                                            NULL);
+        }
+
+        return true;
+}
+
+
+/** render surface of renderer that has a hash function */
+static void _render_shared(NiftyconfRenderer * r)
+{
+        guint64 hash = r->hash(r->element);
+
+        /* content didn't change or was rendered by another renderer? */
+        if(hash == r->content || _cache_lookup(r, hash))
+                return;
+
+        if(!_cache_unshare(r))
+        {
+                NFT_LOG(L_ERROR, "failed to allocate surface for %s",
+                        led_prefs_type_to_string(r->type));
+                return;
+        }
+
+        if(!r->render(&r->surface, r->element))
+        {
+                NFT_LOG(L_ERROR, "%s renderer (%p) failed",
+                        led_prefs_type_to_string(r->type), r->element);
+                r->content = 0;
+                return;
+        }
+
+        r->content = hash;
+        _cache_add(r);
+}
+
 
 /******************************************************************************
  ******************************************************************************/
 
+/** add data to FNV-1a hash */
+guint64 renderer_hash(guint64 hash, const void *data, size_t len)
+{
+        const guchar *d = data;
+
+        size_t i;
+        for(i = 0; i < len; i++)
+        {
+                hash ^= d[i];
+                hash *= G_GUINT64_CONSTANT(0x100000001b3);
+        }
+
+        return hash;
+}
+
+
+/** set function that calculates a content hash of the rendered element */
+void renderer_set_hash_func(NiftyconfRenderer * r, NiftyconfHashFunc * hash)
+{
+        if(!r)
+                NFT_LOG_NULL();
+
+        r->hash = hash;
+        r->content = 0;
+}
+
+
+/** get content hash of renderer (without rendering it) */
+guint64 renderer_get_hash(NiftyconfRenderer * r)
+{
+        if(!r)
+                NFT_LOG_NULL(0);
+
+        if(!r->hash)
+                return 0;
+
+        if(r->damaged)
+                return r->hash(r->element);
+
+        return r->content;
+}
+
 
 
 /** getter for cairo surface */
@@ -90,8 +258,13 @@ cairo_surface_t *renderer_get_surface(NiftyconfRenderer * r)
         /* if renderer is marked as damaged, re-render it's surface */
         if(r->damaged)
         {
+                /* can surface be shared with other renderers? */
+                if(r->render && r->hash)
+                {
+                        _render_shared(r);
+                }
                 /* do we have a renderer? */
-                if(r->render)
+                else if(r->render)
                 {
                         if(!r->render(&r->surface, r->element))
                         {
@@ -50,6 +50,11 @@
 
 typedef struct _NiftyconfRenderer NiftyconfRenderer;
 typedef                         NftResult(NiftyconfRenderFunc) (cairo_surface_t ** s, gpointer element);
+typedef                         guint64(NiftyconfHashFunc) (gpointer element);
+
+
+/** initial value for renderer_hash() */
+#define RENDERER_HASH_INIT      G_GUINT64_CONSTANT(0xcbf29ce484222325)
 
 
 NiftyconfRenderer              *renderer_new(NIFTYLED_TYPE type, gpointer element, NiftyconfRenderFunc * render, gint width, gint height);
@@ -60,5 +65,8 @@ gboolean                        renderer_resize(NiftyconfRenderer * r, gint widt
 cairo_surface_t                *renderer_get_surface(NiftyconfRenderer * r);
 gboolean                        renderer_set_offset(NiftyconfRenderer * r, double xOff, double yOff);
 gboolean                        renderer_get_offset(NiftyconfRenderer * r, double *xOff, double *yOff);
+void                            renderer_set_hash_func(NiftyconfRenderer * r, NiftyconfHashFunc * hash);
+guint64                         renderer_get_hash(NiftyconfRenderer * r);
+guint64                         renderer_hash(guint64 hash, const void *data, size_t len);
 
 #endif /* _NIFTYCONF_RENDERER_H */
@@ -0,0 +1,371 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "elements/element-led.h"
+#include "elements/element-chain.h"
+#include "selection/selection.h"
+
+
+/** one continuous range of LEDs in a chain */
+typedef struct
+{
+        LedCount first;
+        LedCount last;
+} SelectionRange;
+
+
+/** a set of LEDs, stored as sorted ranges per chain */
+struct _NiftyconfSelection
+{
+        /** NiftyconfChain -> GArray of SelectionRange */
+        GHashTable *chains;
+};
+
+
+/** all currently allocated selections */
+static GList *_selections;
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** index of first range that ends at or behind pos-1 */
+static guint _ranges_find(GArray * a, LedCount pos)
+{
+        guint lo = 0, hi = a->len;
+        while(lo < hi)
+        {
+                guint mid = (lo + hi) / 2;
+                if(g_array_index(a, SelectionRange, mid).last + 1 < pos)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+
+/** add range to sorted array of ranges, merging adjacent ranges */
+static void _ranges_add(GArray * a, LedCount first, LedCount last)
+{
+        guint i = _ranges_find(a, first);
+
+        /* no range to merge with? */
+        if(i == a->len || g_array_index(a, SelectionRange, i).first > last + 1)
+        {
+                SelectionRange r = {first, last};
+                g_array_insert_val(a, i, r);
+                return;
+        }
+
+        /* extend range */
+        SelectionRange *r = &g_array_index(a, SelectionRange, i);
+        r->first = MIN(r->first, first);
+        r->last = MAX(r->last, last);
+
+        /* swallow all following ranges that are touched now */
+        guint j;
+        for(j = i + 1;
+            j < a->len && g_array_index(a, SelectionRange, j).first <=
+            r->last + 1; j++)
+        {
+                r->last = MAX(r->last, g_array_index(a, SelectionRange, j).last);
+        }
+
+        if(j > i + 1)
+                g_array_remove_range(a, i + 1, j - i - 1);
+}
+
+
+/** get ranges of a chain (create if create == true) */
+static GArray *_ranges_get(NiftyconfSelection * s, NiftyconfChain * c,
+                           gboolean create)
+{
+        GArray *a;
+        if(!(a = g_hash_table_lookup(s->chains, c)) && create)
+        {
+                a = g_array_new(false, false, sizeof(SelectionRange));
+                g_hash_table_insert(s->chains, c, a);
+        }
+
+        return a;
+}
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/** add one LED to selection */
+void selection_add_led(NiftyconfSelection * s, NiftyconfLed * l)
+{
+        if(!s || !l)
+                NFT_LOG_NULL();
+
+        LedCount pos = led_get_chainpos(l);
+        _ranges_add(_ranges_get(s, led_get_chain(l), true), pos, pos);
+}
+
+
+/** add range of LEDs (first to last, inclusive) of a chain to selection */
+void selection_add_range(NiftyconfSelection * s,
+                         NiftyconfChain * c, LedCount first, LedCount last)
+{
+        if(!s || !c)
+                NFT_LOG_NULL();
+
+        if(first > last)
+                return;
+
+        _ranges_add(_ranges_get(s, c, true), first, last);
+}
+
+
+/** check if LED is part of selection */
+gboolean selection_contains(NiftyconfSelection * s, NiftyconfLed * l)
+{
+        if(!s || !l)
+                NFT_LOG_NULL(false);
+
+        GArray *a;
+        if(!(a = _ranges_get(s, led_get_chain(l), false)))
+                return false;
+
+        LedCount pos = led_get_chainpos(l);
+        guint i = _ranges_find(a, pos + 1);
+        if(i == a->len)
+                return false;
+
+        SelectionRange *r = &g_array_index(a, SelectionRange, i);
+        return (pos >= r->first && pos <= r->last);
+}
+
+
+/** true if nothing is selected */
+gboolean selection_is_empty(NiftyconfSelection * s)
+{
+        if(!s)
+                NFT_LOG_NULL(true);
+
+        return (g_hash_table_size(s->chains) == 0);
+}
+
+
+/** amount of selected LEDs */
+LedCount selection_count(NiftyconfSelection * s)
+{
+        if(!s)
+                NFT_LOG_NULL(0);
+
+        LedCount result = 0;
+
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, s->chains);
+        while(g_hash_table_iter_next(&iter, &key, &value))
+        {
+                GArray *a = value;
+                guint i;
+                for(i = 0; i < a->len; i++)
+                {
+                        SelectionRange *r =
+                                &g_array_index(a, SelectionRange, i);
+                        result += r->last - r->first + 1;
+                }
+        }
+
+        return result;
+}
+
+
+/** get any LED of the selection (NULL if selection is empty) */
+NiftyconfLed *selection_get_any(NiftyconfSelection * s)
+{
+        if(!s)
+                NFT_LOG_NULL(NULL);
+
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, s->chains);
+        while(g_hash_table_iter_next(&iter, &key, &value))
+        {
+                LedChain *c = chain_niftyled(key);
+                GArray *a = value;
+                LedCount pos = g_array_index(a, SelectionRange, 0).first;
+
+                if(pos < led_chain_get_ledcount(c))
+                        return led_get_privdata(led_chain_get_nth(c, pos));
+        }
+
+        return NULL;
+}
+
+
+/** run function on every range of selected LEDs */
+void selection_foreach_range(NiftyconfSelection * s,
+                             void (*func) (NiftyconfChain * c,
+                                           LedCount first,
+                                           LedCount last,
+                                           void *u), void *u)
+{
+        if(!s || !func)
+                NFT_LOG_NULL();
+
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, s->chains);
+        while(g_hash_table_iter_next(&iter, &key, &value))
+        {
+                NiftyconfChain *c = key;
+                GArray *a = value;
+
+                /* chain might have shrunk since LEDs were selected */
+                LedCount count = led_chain_get_ledcount(chain_niftyled(c));
+
+                guint i;
+                for(i = 0; i < a->len; i++)
+                {
+                        SelectionRange *r =
+                                &g_array_index(a, SelectionRange, i);
+                        if(r->first >= count)
+                                break;
+
+                        func(c, r->first, MIN(r->last, count - 1), u);
+                }
+        }
+}
+
+
+/** run function on every selected LED */
+void selection_foreach(NiftyconfSelection * s,
+                       void (*func) (NiftyconfLed * l, void *u), void *u)
+{
+        if(!s || !func)
+                NFT_LOG_NULL();
+
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, s->chains);
+        while(g_hash_table_iter_next(&iter, &key, &value))
+        {
+                LedChain *c = chain_niftyled(key);
+                GArray *a = value;
+                LedCount count = led_chain_get_ledcount(c);
+
+                guint i;
+                for(i = 0; i < a->len; i++)
+                {
+                        SelectionRange *r =
+                                &g_array_index(a, SelectionRange, i);
+
+                        LedCount pos;
+                        for(pos = r->first; pos <= r->last && pos < count;
+                            pos++)
+                        {
+                                NiftyconfLed *l;
+                                if((l = led_get_privdata
+                                    (led_chain_get_nth(c, pos))))
+                                        func(l, u);
+                        }
+                }
+        }
+}
+
+
+/** remove all LEDs from selection */
+void selection_clear(NiftyconfSelection * s)
+{
+        if(!s)
+                NFT_LOG_NULL();
+
+        g_hash_table_remove_all(s->chains);
+}
+
+
+/** remove chain from all selections (call before chain is freed) */
+void selection_forget_chain(NiftyconfChain * c)
+{
+        GList *l;
+        for(l = _selections; l; l = l->next)
+        {
+                NiftyconfSelection *s = l->data;
+                g_hash_table_remove(s->chains, c);
+        }
+}
+
+
+/** allocate new (empty) selection */
+NiftyconfSelection *selection_new()
+{
+        NiftyconfSelection *s;
+        if(!(s = calloc(1, sizeof(NiftyconfSelection))))
+        {
+                g_error("calloc: %s", strerror(errno));
+                return NULL;
+        }
+
+        s->chains = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                          NULL,
+                                          (GDestroyNotify) g_array_unref);
+
+        _selections = g_list_prepend(_selections, s);
+
+        return s;
+}
+
+
+/** free selection */
+void selection_destroy(NiftyconfSelection * s)
+{
+        if(!s)
+                return;
+
+        _selections = g_list_remove(_selections, s);
+
+        g_hash_table_destroy(s->chains);
+        free(s);
+}
@@ -0,0 +1,491 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "elements/element-led.h"
+#include "elements/element-chain.h"
+#include "elements/element-tile.h"
+#include "elements/element-setup.h"
+#include "spatial-index/spatial-index.h"
+#include "validator/validator.h"
+
+
+/** edge length of one grid cell (in setup coordinates) */
+#define CELL_SIZE               2.0
+/** maximum distance of a point to a LED center to count as a hit */
+#define LED_RADIUS              (M_SQRT2/2)
+
+
+/** position of one indexed LED */
+typedef struct
+{
+        /** center of LED in setup coordinates */
+        double x, y;
+        /** grid cell this LED is currently stored in */
+        gint64 cell;
+} IndexEntry;
+
+
+/** grid cells: gint64 cell key -> GPtrArray of NiftyconfLed */
+static GHashTable *_cells;
+/** indexed LEDs: NiftyconfLed -> IndexEntry */
+static GHashTable *_entries;
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** calculate grid coordinate of a setup coordinate */
+static gint32 _grid(double v)
+{
+        return (gint32) floor(v / CELL_SIZE);
+}
+
+
+/** build key of one grid cell */
+static gint64 _cell_key(gint32 cx, gint32 cy)
+{
+        return (gint64) (((guint64) (guint32) cx << 32) | (guint32) cy);
+}
+
+
+/** get array of LEDs stored in a cell (NULL if cell is empty) */
+static GPtrArray *_cell_get(gint64 cell)
+{
+        return g_hash_table_lookup(_cells, &cell);
+}
+
+
+/** add LED to grid cell */
+static void _cell_add(gint64 cell, NiftyconfLed * l)
+{
+        GPtrArray *a;
+        if(!(a = _cell_get(cell)))
+        {
+                gint64 *key = g_new(gint64, 1);
+                *key = cell;
+                a = g_ptr_array_new();
+                g_hash_table_insert(_cells, key, a);
+        }
+
+        g_ptr_array_add(a, l);
+}
+
+
+/** remove LED from grid cell */
+static void _cell_remove(gint64 cell, NiftyconfLed * l)
+{
+        GPtrArray *a;
+        if(!(a = _cell_get(cell)))
+                return;
+
+        g_ptr_array_remove_fast(a, l);
+
+        /* drop empty cells */
+        if(a->len == 0)
+                g_hash_table_remove(_cells, &cell);
+}
+
+
+/** calculate center of LED in setup coordinates */
+static gboolean _led_world_pos(NiftyconfLed * l, double *x, double *y)
+{
+        /* only LEDs of tiles have a position in the setup */
+        LedTile *t;
+        if(!(t = led_chain_get_parent_tile(chain_niftyled(led_get_chain(l)))))
+                return false;
+
+        LedFrameCord lX, lY;
+        led_get_pos(led_niftyled(l), &lX, &lY);
+
+        *x = (double) lX + 0.5;
+        *y = (double) lY + 0.5;
+        tile_local_to_world(t, x, y);
+
+        return true;
+}
+
+
+/** free an IndexEntry */
+static void _entry_free(gpointer e)
+{
+        g_slice_free(IndexEntry, e);
+}
+
+
+/** walk all LEDs of a cell and call func for all LEDs inside rectangle */
+static void _cell_foreach_in_rect(GPtrArray * a,
+                                  double x1, double y1,
+                                  double x2, double y2,
+                                  void (*func) (NiftyconfLed * l, void *u),
+                                  void *u)
+{
+        guint i;
+        for(i = 0; i < a->len; i++)
+        {
+                NiftyconfLed *l = g_ptr_array_index(a, i);
+                IndexEntry *e = g_hash_table_lookup(_entries, l);
+
+                if(e->x >= x1 && e->x <= x2 && e->y >= y1 && e->y <= y2)
+                        func(l, u);
+        }
+}
+
+
+/** find last (topmost) tile in list (or its children) containing a point */
+static NiftyconfTile *_tile_list_at(LedTile * first, double x, double y)
+{
+        NiftyconfTile *result = NULL;
+
+        LedTile *t;
+        for(t = first; t; t = led_tile_list_get_next(t))
+        {
+                NiftyconfTile *tile;
+                if(!(tile = led_tile_get_privdata(t)))
+                        continue;
+
+                /* children are drawn on top of their parent */
+                NiftyconfTile *child;
+                if((child = _tile_list_at(led_tile_get_child(t), x, y)))
+                {
+                        result = child;
+                        continue;
+                }
+
+                /* transform point into tile coordinates */
+                double lX = x, lY = y;
+                tile_world_to_local(t, &lX, &lY);
+
+                LedFrameCord w, h;
+                led_tile_get_dim(t, &w, &h);
+                if(lX >= 0 && lY >= 0 && lX < (double) w && lY < (double) h)
+                        result = tile;
+        }
+
+        return result;
+}
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/** (re-)calculate position of one LED and update index */
+void spatial_index_update_led(NiftyconfLed * l)
+{
+        if(!l)
+                NFT_LOG_NULL();
+
+        double x, y;
+        if(!_led_world_pos(l, &x, &y))
+        {
+                /* LED has no position in setup (e.g. hardware chain) */
+                spatial_index_remove_led(l);
+                return;
+        }
+
+        gint64 cell = _cell_key(_grid(x), _grid(y));
+
+        IndexEntry *e;
+        if((e = g_hash_table_lookup(_entries, l)))
+        {
+                /* nothing moved? */
+                if(e->x == x && e->y == y)
+                        return;
+
+                /* LEDs at old position need to be validated again */
+                validator_invalidate_near(e->x, e->y);
+        }
+
+        /* LED needs to be validated at its new position */
+        validator_invalidate_led(l);
+
+        if(!e)
+        {
+                /* LED not indexed, yet */
+                e = g_slice_new(IndexEntry);
+                g_hash_table_insert(_entries, l, e);
+                _cell_add(cell, l);
+        }
+        else if(e->cell != cell)
+        {
+                /* LED moved to another cell */
+                _cell_remove(e->cell, l);
+                _cell_add(cell, l);
+        }
+
+        e->x = x;
+        e->y = y;
+        e->cell = cell;
+}
+
+
+/** remove LED from index */
+void spatial_index_remove_led(NiftyconfLed * l)
+{
+        if(!l)
+                NFT_LOG_NULL();
+
+        IndexEntry *e;
+        if(!(e = g_hash_table_lookup(_entries, l)))
+                return;
+
+        /* LEDs at old position need to be validated again */
+        validator_invalidate_near(e->x, e->y);
+
+        _cell_remove(e->cell, l);
+        g_hash_table_remove(_entries, l);
+}
+
+
+/** update position of all LEDs in a chain */
+void spatial_index_update_chain(NiftyconfChain * c)
+{
+        if(!c)
+                NFT_LOG_NULL();
+
+        LedChain *chain = chain_niftyled(c);
+        LedCount i;
+        for(i = 0; i < led_chain_get_ledcount(chain); i++)
+        {
+                NiftyconfLed *l;
+                if((l = led_get_privdata(led_chain_get_nth(chain, i))))
+                        spatial_index_update_led(l);
+        }
+}
+
+
+/**
+ * update position of all LEDs of a tile and its children
+ * (call after position, rotation or pivot of a tile changed)
+ */
+void spatial_index_update_tile(NiftyconfTile * t)
+{
+        if(!t)
+                NFT_LOG_NULL();
+
+        LedTile *tile = tile_niftyled(t);
+
+        /* chain of this tile */
+        LedChain *c;
+        NiftyconfChain *chain;
+        if((c = led_tile_get_chain(tile)) && (chain = led_chain_get_privdata(c)))
+                spatial_index_update_chain(chain);
+
+        /* all children */
+        LedTile *child;
+        for(child = led_tile_get_child(tile);
+            child; child = led_tile_list_get_next(child))
+        {
+                NiftyconfTile *ct;
+                if((ct = led_tile_get_privdata(child)))
+                        spatial_index_update_tile(ct);
+        }
+}
+
+
+/** getter for indexed position of a LED (center in setup coordinates) */
+gboolean spatial_index_get_led_pos(NiftyconfLed * l, double *x, double *y)
+{
+        if(!l || !x || !y)
+                NFT_LOG_NULL(false);
+
+        IndexEntry *e;
+        if(!(e = g_hash_table_lookup(_entries, l)))
+                return false;
+
+        *x = e->x;
+        *y = e->y;
+
+        return true;
+}
+
+
+/** get LED closest to a point in setup coordinates (NULL if there is none) */
+NiftyconfLed *spatial_index_led_at(double x, double y)
+{
+        NiftyconfLed *result = NULL;
+        double best = LED_RADIUS * LED_RADIUS;
+
+        /* check all cells within reach of the point */
+        gint32 cx, cy;
+        for(cx = _grid(x - LED_RADIUS); cx <= _grid(x + LED_RADIUS); cx++)
+        {
+                for(cy = _grid(y - LED_RADIUS); cy <= _grid(y + LED_RADIUS);
+                    cy++)
+                {
+                        GPtrArray *a;
+                        if(!(a = _cell_get(_cell_key(cx, cy))))
+                                continue;
+
+                        guint i;
+                        for(i = 0; i < a->len; i++)
+                        {
+                                NiftyconfLed *l = g_ptr_array_index(a, i);
+                                IndexEntry *e =
+                                        g_hash_table_lookup(_entries, l);
+
+                                double d = (e->x - x) * (e->x - x) +
+                                        (e->y - y) * (e->y - y);
+                                if(d <= best)
+                                {
+                                        best = d;
+                                        result = l;
+                                }
+                        }
+                }
+        }
+
+        return result;
+}
+
+
+/**
+ * get topmost tile containing a point in setup coordinates
+ * (NULL if there is none) - tiles are few compared to LEDs, so they are
+ * simply walked
+ */
+NiftyconfTile *spatial_index_tile_at(double x, double y)
+{
+        NiftyconfTile *result = NULL;
+
+        LedHardware *h;
+        for(h = led_setup_get_hardware(setup_get_current());
+            h; h = led_hardware_list_get_next(h))
+        {
+                NiftyconfTile *t;
+                if((t = _tile_list_at(led_hardware_get_tile(h), x, y)))
+                        result = t;
+        }
+
+        return result;
+}
+
+
+/**
+ * call func for every LED whose center lies inside a rectangle
+ * (setup coordinates)
+ */
+void spatial_index_foreach_in_rect(double x1, double y1,
+                                   double x2, double y2,
+                                   void (*func) (NiftyconfLed * l, void *u),
+                                   void *u)
+{
+        if(!func)
+                NFT_LOG_NULL();
+
+        /* sort corners */
+        double t;
+        if(x1 > x2)
+        {
+                t = x1;
+                x1 = x2;
+                x2 = t;
+        }
+        if(y1 > y2)
+        {
+                t = y1;
+                y1 = y2;
+                y2 = t;
+        }
+
+        gint32 cx1 = _grid(x1), cy1 = _grid(y1);
+        gint32 cx2 = _grid(x2), cy2 = _grid(y2);
+
+        /* rectangle covers more cells than populated? Walk populated cells */
+        double cells = ((double) cx2 - cx1 + 1) * ((double) cy2 - cy1 + 1);
+        if(cells > (double) g_hash_table_size(_cells))
+        {
+                GHashTableIter iter;
+                gpointer key, value;
+                g_hash_table_iter_init(&iter, _cells);
+                while(g_hash_table_iter_next(&iter, &key, &value))
+                {
+                        _cell_foreach_in_rect(value, x1, y1, x2, y2, func, u);
+                }
+                return;
+        }
+
+        gint32 cx, cy;
+        for(cx = cx1; cx <= cx2; cx++)
+        {
+                for(cy = cy1; cy <= cy2; cy++)
+                {
+                        GPtrArray *a;
+                        if((a = _cell_get(_cell_key(cx, cy))))
+                                _cell_foreach_in_rect(a, x1, y1, x2, y2,
+                                                      func, u);
+                }
+        }
+}
+
+
+/** amount of LEDs currently indexed */
+guint spatial_index_count()
+{
+        return g_hash_table_size(_entries);
+}
+
+
+/** initialize this module */
+gboolean spatial_index_init()
+{
+        _cells = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                       g_free,
+                                       (GDestroyNotify) g_ptr_array_unref);
+        _entries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, _entry_free);
+
+        return true;
+}
+
+
+/** deinitialize this module */
+void spatial_index_deinit()
+{
+        g_hash_table_destroy(_entries);
+        g_hash_table_destroy(_cells);
+}
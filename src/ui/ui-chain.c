@@ -47,6 +47,9 @@
 #include "ui/ui-setup.h"
 #include "ui/ui-setup-tree.h"
 #include "ui/ui-setup-props.h"
+#include "ui/ui-log.h"
+#include "layout/layout.h"
+#include "undo/undo.h"
 
 
 #define UI(name) (gtk_builder_get_object(_get_builder(), name))
@@ -99,11 +102,10 @@ static void _foreach_remove_chain(NIFTYLED_TYPE type, gpointer e)
 /** chain remove */
 G_MODULE_EXPORT void on_action_chain_remove_activate(GtkWidget * a, gpointer u)
 {
-        /* remove all currently selected elements */
+        /* remove all currently selected elements (undone at once) */
+        undo_group_begin();
         ui_setup_tree_do_foreach_selected_element(_foreach_remove_chain);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
+        undo_group_end();
 
         /* hide properties */
         ui_setup_props_hide();
@@ -131,10 +133,6 @@ G_MODULE_EXPORT void on_add_chain_add_clicked(GtkButton * b, gpointer u)
 
         /* hide dialog */
         gtk_widget_set_visible(GTK_WIDGET(UI("chain_add_window")), false);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
-
 }
 
 
@@ -182,3 +180,64 @@ G_MODULE_EXPORT void on_chain_add_pixelformat_comboboxtext_changed(GtkComboBox
         }
 }
 
+
+/** chain layout */
+G_MODULE_EXPORT void on_action_chain_layout_activate(GtkAction * a,
+                                                     gpointer u)
+{
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("chain_layout_window")),
+                               true);
+}
+
+
+/** chain layout "apply" clicked */
+G_MODULE_EXPORT void on_chain_layout_apply_clicked(GtkButton * b, gpointer u)
+{
+        NIFTYLED_TYPE t;
+        gpointer element;
+        ui_setup_tree_get_last_selected_element(&t, &element);
+
+        /* layout works on chains only */
+        if(t != LED_CHAIN_T)
+        {
+                ui_log_alert_show("Please select a chain to arrange");
+                return;
+        }
+
+        LayoutParams p = {
+                .pattern =
+                        gtk_combo_box_get_active(GTK_COMBO_BOX
+                                                 (ui_setup
+                                                  ("chain_layout_pattern_comboboxtext"))),
+                .width =
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("chain_layout_width_spinbutton"))),
+                .stride_x =
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("chain_layout_stride_x_spinbutton"))),
+                .stride_y =
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("chain_layout_stride_y_spinbutton"))),
+        };
+
+        if(!layout_chain((NiftyconfChain *) element, &p))
+                return;
+
+        /* show new positions */
+        ui_setup_props_chain_show((NiftyconfChain *) element);
+
+        /* hide dialog */
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("chain_layout_window")),
+                               false);
+}
+
+
+/** chain layout "cancel" clicked */
+G_MODULE_EXPORT void on_chain_layout_cancel_clicked(GtkButton * b, gpointer u)
+{
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("chain_layout_window")),
+                               false);
+}
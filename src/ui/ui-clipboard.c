@@ -49,32 +49,74 @@
 #include "ui/ui-renderer.h"
 #include "ui/ui-setup-props.h"
 #include "ui/ui-setup-tree.h"
+#include "ui/ui-setup-save.h"
 #include "ui/ui-log.h"
 #include "elements/element-setup.h"
 #include "elements/element-hardware.h"
 #include "elements/element-tile.h"
 #include "elements/element-chain.h"
 #include "elements/element-led.h"
+#include "undo/undo.h"
 
 
 
 
 /**
  * This is simple & generic.
- * For every setup-element we copy the XML representation to
- * the clipboard. If we cut, the element is removed from the setup and destroyed.
+ * For every setup-element we keep a snapshot of its preferences and hand out
+ * the XML representation when the clipboard contents are requested.
+ * Tiles & chains are kept as niftyled copies instead. As long as we own the
+ * clipboard, pasting uses those copies (or the snapshot) directly and XML is
+ * only parsed when the contents come from another application.
+ * All selected elements go into one clipboard document. If there's more than
+ * one, their nodes become children of a CLIPBOARD_NODE.
+ * If we cut, the element is removed from the setup and destroyed.
  * Upon paste, the XML data is parsed again and, if valid, a new element is created
  * to be inserted as child of the currently selected element (LedHardware
                                                               * elements will always be added to the toplevel of the setup)
-															  *
- * @todo make this ready for proper multi-select copy of tree elements
- */
+															  */
+
+
+/** name of node that holds multiple elements */
+#define CLIPBOARD_NODE  "niftyconf-clipboard"
 
 
 /** our clipboard */
 static GtkClipboard *_clipboard;
 
 
+/** one cut/copied element */
+typedef struct
+{
+        /** type of element */
+        NIFTYLED_TYPE type;
+        /** element in setup (only valid while cutting/copying) */
+        gpointer element;
+        /** copy of tile or chain (not part of any setup) */
+        gpointer clone;
+        /** snapshot of other elements or of clone (belongs to document) */
+        LedPrefsNode *node;
+} ClipboardElement;
+
+
+/** contents we own, serialized when someone asks for them */
+typedef struct
+{
+        /** list of ClipboardElement in tree order */
+        GList *elements;
+        /** document: node of single element or CLIPBOARD_NODE (NULL until requested) */
+        LedPrefsNode *node;
+        /** XML representation of node (NULL until requested) */
+        char *xml;
+} ClipboardContents;
+
+
+/** contents as long as we own the clipboard (NULL otherwise) */
+static ClipboardContents *_owned;
+/** elements collected from current selection */
+static GList *_collected;
+
+
 
 
 
@@ -84,22 +126,143 @@ static GtkClipboard *_clipboard;
  ******************************************************************************/
 
 
-/** cut/copy node */
-static LedPrefsNode *_cut_or_copy_node(NIFTYLED_TYPE t,
-                                       gpointer * e, gboolean cut)
+/** free cut/copied element */
+static void _element_free(ClipboardElement * el, gboolean free_node)
+{
+        if(el->clone && el->type == LED_TILE_T)
+                led_tile_destroy(el->clone);
+        else if(el->clone && el->type == LED_CHAIN_T)
+                led_chain_destroy(el->clone);
+        if(free_node && el->node)
+                led_prefs_node_free(el->node);
+        g_slice_free(ClipboardElement, el);
+}
+
+
+/** create document of all elements when it's needed for the first time */
+static LedPrefsNode *_document(ClipboardContents * cc)
+{
+        /* create snapshots of tile & chain copies */
+        GList *l;
+        for(l = cc->elements; l; l = g_list_next(l))
+        {
+                ClipboardElement *el = l->data;
+                if(el->node)
+                        continue;
+
+                el->node = el->type == LED_TILE_T ?
+                        led_prefs_tile_to_node(setup_get_prefs(), el->clone) :
+                        led_prefs_chain_to_node(setup_get_prefs(), el->clone);
+                if(!el->node)
+                        return NULL;
+        }
+
+        /* single element is its own document */
+        if(!g_list_next(cc->elements))
+                return cc->node = ((ClipboardElement *) cc->elements->data)->node;
+
+        /* multiple elements are collected in one node */
+        LedPrefsNode *n;
+        if(!(n = nft_prefs_node_alloc(CLIPBOARD_NODE)))
+                return NULL;
+
+        for(l = cc->elements; l; l = g_list_next(l))
+                nft_prefs_node_add_child(n,
+                                         ((ClipboardElement *) l->data)->node);
+
+        return cc->node = n;
+}
+
+
+/** provide clipboard contents in a requested text target */
+static void _clipboard_get(GtkClipboard * c, GtkSelectionData * d,
+                           guint info, gpointer u)
 {
-        NFT_LOG(L_DEBUG,
-                cut ? "Cutting element (type: %d / ptr: %p)..." :
-                "Copying element (type: %d / ptr: %p)...", t, e);
+        ClipboardContents *cc = u;
+
+        /* another application asks for our contents */
+        if(!cc->node && !_document(cc))
+        {
+                NFT_LOG(L_ERROR,
+                        "Failed to create preferences from clipboard contents");
+                return;
+        }
+
+        /* serialize only once, no matter how often it's pasted */
+        if(!cc->xml &&
+           !(cc->xml = led_prefs_node_to_buffer(setup_get_prefs(), cc->node)))
+        {
+                NFT_LOG(L_ERROR, "Failed to serialize clipboard contents");
+                return;
+        }
+
+        gtk_selection_data_set_text(d, cc->xml, -1);
+
+        NFT_LOG(L_VERY_NOISY, "%s", cc->xml);
+}
+
+
+/** clipboard contents were replaced */
+static void _clipboard_clear(GtkClipboard * c, gpointer u)
+{
+        ClipboardContents *cc = u;
+
+        if(_owned == cc)
+                _owned = NULL;
+
+        /* nodes of elements belong to document, once it exists */
+        GList *l;
+        for(l = cc->elements; l; l = g_list_next(l))
+                _element_free(l->data, !cc->node);
+        g_list_free(cc->elements);
+
+        if(cc->node)
+                led_prefs_node_free(cc->node);
+        free(cc->xml);
+        g_slice_free(ClipboardContents, cc);
+}
+
+
+/** take ownership of clipboard, contents are serialized when requested */
+static NftResult _clipboard_set(ClipboardContents * cc)
+{
+        GtkTargetList *list = gtk_target_list_new(NULL, 0);
+        gtk_target_list_add_text_targets(list, 0);
+        gint count;
+        GtkTargetEntry *targets = gtk_target_table_new_from_list(list, &count);
+        gtk_target_list_unref(list);
+
+        gboolean result = gtk_clipboard_set_with_data(_clipboard,
+                                                      targets, count,
+                                                      _clipboard_get,
+                                                      _clipboard_clear, cc);
+        gtk_target_table_free(targets, count);
+
+        if(!result)
+        {
+                NFT_LOG(L_ERROR, "Failed to take ownership of clipboard");
+                _clipboard_clear(_clipboard, cc);
+                return NFT_FAILURE;
+        }
+
+        /* pasting in this process doesn't need XML */
+        _owned = cc;
+
+        /* allow clipboard manager to keep contents after we quit */
+        gtk_clipboard_set_can_store(_clipboard, NULL, 0);
 
+        return NFT_SUCCESS;
+}
 
 
+/** create preferences node of element */
+static LedPrefsNode *_copy_node(NIFTYLED_TYPE t, gpointer e)
+{
         LedPrefsNode *n = NULL;
         switch (t)
         {
                 case LED_SETUP_T:
                 {
-
                         if(!(n = led_prefs_setup_to_node(setup_get_prefs(),
                                                          setup_get_current
                                                          ())))
@@ -108,15 +271,6 @@ static LedPrefsNode *_cut_or_copy_node(NIFTYLED_TYPE t,
                                         ("Failed to create preferences from current setup.");
                                 return NULL;
                         }
-
-                        /* also remove element? */
-                        if(cut)
-                        {
-                                led_setup_destroy(setup_get_current());
-                                setup_register_to_gui(led_setup_new());
-                                ui_setup_tree_refresh();
-                                ui_setup_props_hide();
-                        }
                         break;
                 }
 
@@ -131,16 +285,6 @@ static LedPrefsNode *_cut_or_copy_node(NIFTYLED_TYPE t,
                                         ("Failed to create preferences from current setup.");
                                 return NULL;
                         }
-
-                        /* also remove element? */
-                        if(cut)
-                        {
-                                hardware_destroy((NiftyconfHardware *) e);
-                                ui_setup_tree_refresh();
-
-                                /* hide properties */
-                                ui_setup_props_hide();
-                        }
                         break;
                 }
 
@@ -150,16 +294,6 @@ static LedPrefsNode *_cut_or_copy_node(NIFTYLED_TYPE t,
                         if(!(n = led_prefs_tile_to_node(setup_get_prefs(),
                                                         t)))
                                 return NULL;
-
-                        /* remove element? */
-                        if(cut)
-                        {
-                                tile_destroy((NiftyconfTile *) e);
-                                ui_setup_tree_refresh();
-
-                                /* hide properties */
-                                ui_setup_props_hide();
-                        }
                         break;
                 }
 
@@ -173,52 +307,401 @@ static LedPrefsNode *_cut_or_copy_node(NIFTYLED_TYPE t,
                                         "Failed to dump Chain element");
                                 return NULL;
                         }
+                        break;
+                }
+
+                case LED_T:
+                {
+                        Led *l = led_niftyled((NiftyconfLed *) e);
+                        if(!(n = led_prefs_led_to_node(setup_get_prefs(), l)))
+                                return NULL;
+                        break;
+                }
 
+                default:
+                {
+                        NFT_LOG(L_ERROR,
+                                "Attempt to cut/copy unknown element. This shouldn't happen?!");
+                }
+        }
+
+        return n;
+}
+
+
+/** remove element that was cut from setup */
+static void _cut_element(NIFTYLED_TYPE t, gpointer e)
+{
+        switch (t)
+        {
+                case LED_SETUP_T:
+                {
+                        led_setup_destroy(setup_get_current());
+                        setup_register_to_gui(led_setup_new());
+                        break;
+                }
+
+                case LED_HARDWARE_T:
+                {
+                        hardware_destroy((NiftyconfHardware *) e);
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        tile_destroy((NiftyconfTile *) e);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
                         /* don't cut from hardware elements */
+                        LedChain *c = chain_niftyled((NiftyconfChain *) e);
                         if(led_chain_parent_is_hardware(c))
                                 break;
 
-                        /* remove element? */
-                        if(cut)
+                        /* get parent tile of this chain */
+                        LedTile *t = led_chain_get_parent_tile(c);
+                        NiftyconfTile *tile = led_tile_get_privdata(t);
+                        chain_of_tile_destroy(tile);
+                        break;
+                }
+
+                case LED_T:
+                {
+                        NFT_TODO();
+                        // led_unregister((NiftyconfLed *) e);
+                        // setup_tree_refresh();
+                        break;
+                }
+
+                default:
+                        break;
+        }
+}
+
+
+/**
+ * copy element, tiles & chains are kept as niftyled copies so they can be
+ * pasted without preferences
+ */
+static ClipboardElement *_element_new(NIFTYLED_TYPE t, gpointer e)
+{
+        NFT_LOG(L_DEBUG, "Copying element (type: %d / ptr: %p)...", t, e);
+
+        ClipboardElement *el = g_slice_new0(ClipboardElement);
+        el->type = t;
+        el->element = e;
+
+        switch (t)
+        {
+                case LED_TILE_T:
+                {
+                        el->clone = tile_clone(tile_niftyled(e));
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        el->clone = chain_clone(chain_niftyled(e));
+                        break;
+                }
+
+                default:
+                {
+                        el->node = _copy_node(t, e);
+                        break;
+                }
+        }
+
+        if(!el->clone && !el->node)
+        {
+                g_slice_free(ClipboardElement, el);
+                return NULL;
+        }
+
+        return el;
+}
+
+
+/** niftyled object of a setup element */
+static gpointer _niftyled(NIFTYLED_TYPE t, gpointer e)
+{
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                        return hardware_niftyled((NiftyconfHardware *) e);
+                case LED_TILE_T:
+                        return tile_niftyled((NiftyconfTile *) e);
+                case LED_CHAIN_T:
+                        return chain_niftyled((NiftyconfChain *) e);
+                case LED_T:
+                        return led_niftyled((NiftyconfLed *) e);
+                default:
+                        return e;
+        }
+}
+
+
+/** parent of a niftyled object (NULL for toplevel objects) */
+static gpointer _niftyled_parent(NIFTYLED_TYPE * t, gpointer o)
+{
+        switch (*t)
+        {
+                case LED_TILE_T:
+                {
+                        LedTile *pt;
+                        if((pt = led_tile_get_parent_tile(o)))
+                                return pt;
+                        *t = LED_HARDWARE_T;
+                        return led_tile_get_parent_hardware(o);
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedTile *pt;
+                        if((pt = led_chain_get_parent_tile(o)))
                         {
-                                /* get parent tile of this chain */
-                                LedTile *t = led_chain_get_parent_tile(c);
-                                NiftyconfTile *tile =
-                                        led_tile_get_privdata(t);
-                                chain_of_tile_destroy(tile);
-                                ui_setup_tree_refresh();
-
-                                /* hide properties */
-                                ui_setup_props_hide();
+                                *t = LED_TILE_T;
+                                return pt;
                         }
-                        break;
+                        *t = LED_HARDWARE_T;
+                        return led_chain_get_parent_hardware(o);
                 }
 
                 case LED_T:
                 {
-                        Led *l = led_niftyled((NiftyconfLed *) e);
-                        if(!(n = led_prefs_led_to_node(setup_get_prefs(), l)))
-                                return NULL;
+                        *t = LED_CHAIN_T;
+                        return led_get_chain(o);
+                }
 
-                        /* remove element? */
-                        if(cut)
+                default:
+                        return NULL;
+        }
+}
+
+
+/** foreach: collect selected element */
+static void _foreach_collect_element(NIFTYLED_TYPE t, gpointer e)
+{
+        /* elements are walked from last to first */
+        ClipboardElement *el = g_slice_new0(ClipboardElement);
+        el->type = t;
+        el->element = e;
+        _collected = g_list_prepend(_collected, el);
+}
+
+
+/**
+ * copy all selected elements into new clipboard contents. Elements are
+ * skipped if one of their parents is selected, too.
+ */
+static ClipboardContents *_copy_selection()
+{
+        ui_setup_tree_do_foreach_selected_element(_foreach_collect_element);
+        GList *selected = _collected;
+        _collected = NULL;
+
+        /* niftyled objects of all selected elements */
+        GHashTable *objects = g_hash_table_new(g_direct_hash, g_direct_equal);
+        GList *l;
+        for(l = selected; l; l = g_list_next(l))
+        {
+                ClipboardElement *s = l->data;
+                g_hash_table_insert(objects, _niftyled(s->type, s->element),
+                                    NULL);
+        }
+
+        ClipboardContents *cc = g_slice_new0(ClipboardContents);
+        for(l = selected; l; l = g_list_next(l))
+        {
+                ClipboardElement *s = l->data;
+
+                /* parent will be copied including this element */
+                NIFTYLED_TYPE t = s->type;
+                gpointer o = _niftyled(t, s->element);
+                while((o = _niftyled_parent(&t, o)) &&
+                      !g_hash_table_lookup_extended(objects, o, NULL, NULL));
+                if(o)
+                        continue;
+
+                ClipboardElement *el;
+                if(!(el = _element_new(s->type, s->element)))
+                {
+                        _clipboard_clear(_clipboard, cc);
+                        cc = NULL;
+                        break;
+                }
+
+                cc->elements = g_list_append(cc->elements, el);
+        }
+
+        g_hash_table_destroy(objects);
+        for(l = selected; l; l = g_list_next(l))
+                g_slice_free(ClipboardElement, l->data);
+        g_list_free(selected);
+
+        return cc;
+}
+
+
+/** paste tile to parent element, takes ownership of tile */
+static void _paste_tile(LedTile * t, NIFTYLED_TYPE parent_t,
+                        gpointer parent_element)
+{
+        switch (parent_t)
+        {
+                        /* paste tile to hardware */
+                case LED_HARDWARE_T:
+                {
+                        /* parent hardware element */
+                        LedHardware *h;
+                        if(!(h = hardware_niftyled((NiftyconfHardware *)
+                                                   parent_element)))
+                        {
+                                ui_log_alert_show
+                                        ("Failed to get Hardware node to paste to");
+                                led_tile_destroy(t);
+                                return;
+                        }
+
+                        /* does parent hardware already have a tile? */
+                        LedTile *pt;
+                        if((pt = led_hardware_get_tile(h)))
+                        {
+                                if(!led_tile_list_append_head(pt, t))
+                                {
+                                        ui_log_alert_show
+                                                ("Failed to append Tile to parent Hardware list of tiles");
+                                        led_tile_destroy(t);
+                                        return;
+                                }
+                        }
+                        /* parent hardware doesn't have a tile, yet */
+                        else
+                        {
+                                if(!led_hardware_set_tile(h, t))
+                                {
+                                        ui_log_alert_show
+                                                ("Failed to set Tile to parent Hardware");
+                                        led_tile_destroy(t);
+                                        return;
+                                }
+                        }
+
+                        /* register tile to GUI */
+                        NiftyconfTile *tile;
+                        if((tile = tile_register_to_gui(t)))
+                                undo_record_insert(LED_TILE_T, tile);
+                        break;
+                }
+
+                        /* paste tile to tile */
+                case LED_TILE_T:
+                {
+                        /* parent tile element */
+                        LedTile *pt;
+                        if(!(pt = tile_niftyled((NiftyconfTile *)
+                                                parent_element)))
                         {
-                                NFT_TODO();
-                                // led_unregister((NiftyconfLed *) e);
-                                // setup_tree_refresh();
+                                ui_log_alert_show
+                                        ("Failed to get Tile node to paste to");
+                                led_tile_destroy(t);
+                                return;
                         }
+
+                        /* append new tile to parent */
+                        if(!led_tile_list_append_child(pt, t))
+                        {
+                                ui_log_alert_show
+                                        ("Failed to append Tile to parent Tile");
+                                led_tile_destroy(t);
+                                return;
+                        }
+
+                        /* register tile to GUI */
+                        NiftyconfTile *tile;
+                        if((tile = tile_register_to_gui(t)))
+                                undo_record_insert(LED_TILE_T, tile);
                         break;
                 }
 
                 default:
                 {
-                        NFT_LOG(L_ERROR,
-                                "Attempt to cut/copy unknown element. This shouldn't happen?!");
+                        ui_log_alert_show
+                                ("Tile nodes can only be pasted to Hardware or other Tiles");
+
+                        /* destroy created tile */
+                        led_tile_destroy(t);
+                        break;
                 }
         }
+}
 
 
-        return n;
+/** paste chain to parent element, takes ownership of chain */
+static void _paste_chain(LedChain * c, NIFTYLED_TYPE parent_t,
+                         gpointer parent_element)
+{
+        /* chains only go in tiles, pasting into hardware is not supported */
+        switch (parent_t)
+        {
+                        /* paste chain into tile */
+                case LED_TILE_T:
+                {
+                        /* parent tile element */
+                        LedTile *pt;
+                        if(!(pt = tile_niftyled((NiftyconfTile *)
+                                                parent_element)))
+                        {
+                                ui_log_alert_show
+                                        ("Failed to get Tile node to paste to");
+                                led_chain_destroy(c);
+                                return;
+                        }
+
+                        /* does tile already have a chain? */
+                        if(led_tile_get_chain(pt))
+                        {
+                                ui_log_alert_show
+                                        ("Selected Ttile already has a Chain. Please remove that Chain first.");
+                                led_chain_destroy(c);
+                                return;
+                        }
+
+                        /* set chain to parent tile */
+                        if(!(led_tile_set_chain(pt, c)))
+                        {
+                                ui_log_alert_show
+                                        ("Failed to attach Chain to selected Tile");
+                                led_chain_destroy(c);
+                                return;
+                        }
+
+                        /* register new chain to GUI */
+                        NiftyconfChain *chain;
+                        if(!(chain = chain_register_to_gui(c)))
+                        {
+                                ui_log_alert_show
+                                        ("Failed to register new Chain to GUI model");
+                                led_chain_destroy(c);
+                                led_tile_set_chain(pt, NULL);
+                                return;
+                        }
+
+                        undo_record_insert(LED_CHAIN_T, chain);
+
+                        break;
+                }
+
+                default:
+                {
+                        ui_log_alert_show
+                                ("Chains can only be pasted into Tiles");
+                        led_chain_destroy(c);
+                        break;
+                }
+        }
 }
 
 
@@ -226,6 +709,16 @@ static LedPrefsNode *_cut_or_copy_node(NIFTYLED_TYPE t,
 static void _paste_node(LedPrefsNode * n,
                         NIFTYLED_TYPE parent_t, gpointer parent_element)
 {
+        /* paste all elements of a multiple selection */
+        if(strcmp(nft_prefs_node_get_name(n), CLIPBOARD_NODE) == 0)
+        {
+                LedPrefsNode *child;
+                for(child = nft_prefs_node_get_first_child(n); child;
+                    child = nft_prefs_node_get_next(child))
+                        _paste_node(child, parent_t, parent_element);
+                return;
+        }
+
 
         /* handle different element types */
         switch (led_prefs_node_get_type(n))
@@ -269,96 +762,7 @@ static void _paste_node(LedPrefsNode * n,
                                 return;
                         }
 
-                        switch (parent_t)
-                        {
-                                        /* paste tile to hardware */
-                                case LED_HARDWARE_T:
-                                {
-                                        /* parent hardware element */
-                                        LedHardware *h;
-                                        if(!
-                                           (h =
-                                            hardware_niftyled((NiftyconfHardware *) parent_element)))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Failed to get Hardware node to paste to");
-                                                led_tile_destroy(t);
-                                                return;
-                                        }
-
-                                        /* does parent hardware already have a
-                                         * tile? */
-                                        LedTile *pt;
-                                        if((pt = led_hardware_get_tile(h)))
-                                        {
-                                                if(!led_tile_list_append_head
-                                                   (pt, t))
-                                                {
-                                                        ui_log_alert_show
-                                                                ("Failed to append Tile to parent Hardware list of tiles");
-                                                        led_tile_destroy(t);
-                                                        return;
-                                                }
-                                        }
-                                        /* parent hardware doesn't have a tile, 
-                                         * yet */
-                                        else
-                                        {
-                                                if(!led_hardware_set_tile
-                                                   (h, t))
-                                                {
-                                                        ui_log_alert_show
-                                                                ("Failed to set Tile to parent Hardware");
-                                                        led_tile_destroy(t);
-                                                        return;
-                                                }
-                                        }
-
-                                        /* register tile to GUI */
-                                        tile_register_to_gui(t);
-                                        break;
-                                }
-
-                                        /* paste tile to tile */
-                                case LED_TILE_T:
-                                {
-                                        /* parent tile element */
-                                        LedTile *pt;
-                                        if(!(pt = tile_niftyled((NiftyconfTile
-                                                                 *)
-                                                                parent_element)))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Failed to get Tile node to paste to");
-                                                led_tile_destroy(t);
-                                                return;
-                                        }
-
-                                        /* append new tile to parent */
-                                        if(!led_tile_list_append_child(pt, t))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Failed to append Tile to parent Tile");
-                                                led_tile_destroy(t);
-                                                return;
-                                        }
-
-                                        /* register tile to GUI */
-                                        tile_register_to_gui(t);
-                                        break;
-                                }
-
-                                default:
-                                {
-                                        ui_log_alert_show
-                                                ("Tile nodes can only be pasted to Hardware or other Tiles");
-
-                                        /* destroy created tile */
-                                        led_tile_destroy(t);
-                                        break;
-                                }
-                        }
-
+                        _paste_tile(t, parent_t, parent_element);
                         break;
                 }
 
@@ -366,73 +770,17 @@ static void _paste_node(LedPrefsNode * n,
                         /* LedChain */
                 case LED_CHAIN_T:
                 {
-                        /* chains only go in tiles, pasting into hardware is
-                         * not supported */
-                        switch (parent_t)
+                        /* create chain from prefs node */
+                        LedChain *c;
+                        if(!(c = led_prefs_chain_from_node(setup_get_prefs(),
+                                                           n)))
                         {
-
-                                        /* paste chain into tile */
-                                case LED_TILE_T:
-                                {
-                                        /* parent tile element */
-                                        LedTile *pt;
-                                        if(!(pt = tile_niftyled((NiftyconfTile
-                                                                 *)
-                                                                parent_element)))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Failed to get Tile node to paste to");
-                                                return;
-                                        }
-
-                                        /* does tile already have a chain? */
-                                        if(led_tile_get_chain(pt))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Selected Ttile already has a Chain. Please remove that Chain first.");
-                                                return;
-                                        }
-
-                                        /* create chain from prefs node */
-                                        LedChain *c;
-                                        if(!(c = led_prefs_chain_from_node
-                                             (setup_get_prefs(), n)))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Failed to parse Chain node from clipboard buffer");
-                                                return;
-                                        }
-
-                                        /* set chain to parent tile */
-                                        if(!(led_tile_set_chain(pt, c)))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Failed to attach Chain to selected Tile");
-                                                led_chain_destroy(c);
-                                                return;
-                                        }
-
-                                        /* register new chain to GUI */
-                                        if(!chain_register_to_gui(c))
-                                        {
-                                                ui_log_alert_show
-                                                        ("Failed to register new Chain to GUI model");
-                                                led_chain_destroy(c);
-                                                led_tile_set_chain(pt, NULL);
-                                                return;
-                                        }
-
-                                        break;
-                                }
-
-                                default:
-                                {
-                                        ui_log_alert_show
-                                                ("Chains can only be pasted into Tiles");
-                                        break;
-                                }
+                                ui_log_alert_show
+                                        ("Failed to parse Chain node from clipboard buffer");
+                                return;
                         }
 
+                        _paste_chain(c, parent_t, parent_element);
                         break;
                 }
 
@@ -469,12 +817,15 @@ static void _paste_node(LedPrefsNode * n,
                         for(h = led_setup_get_hardware(s); h;
                             h = led_hardware_list_get_next(h))
                         {
-                                if(!hardware_register_to_gui(h))
+                                NiftyconfHardware *hw;
+                                if(!(hw = hardware_register_to_gui(h)))
                                 {
                                         ui_log_alert_show
                                                 ("Failed to register new Hardware to GUI model");
                                         return;
                                 }
+
+                                undo_record_insert(LED_HARDWARE_T, hw);
                         }
 
                         led_setup_set_hardware(s, NULL);
@@ -491,8 +842,55 @@ static void _paste_node(LedPrefsNode * n,
                         return;
                 }
         }
+}
+
+
+/** paste element we own (element stays in clipboard for next paste) */
+static void _paste_element(ClipboardElement * el, NIFTYLED_TYPE parent_t,
+                           gpointer parent_element)
+{
+        switch (el->type)
+        {
+                case LED_TILE_T:
+                {
+                        LedTile *t;
+                        if(!(t = tile_clone(el->clone)))
+                        {
+                                ui_log_alert_show
+                                        ("Failed to copy Tile from clipboard");
+                                return;
+                        }
+
+                        _paste_tile(t, parent_t, parent_element);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedChain *c;
+                        if(!(c = chain_clone(el->clone)))
+                        {
+                                ui_log_alert_show
+                                        ("Failed to copy Chain from clipboard");
+                                return;
+                        }
+
+                        _paste_chain(c, parent_t, parent_element);
+                        break;
+                }
+
+                default:
+                {
+                        _paste_node(el->node, parent_t, parent_element);
+                        break;
+                }
+        }
+}
 
 
+/** refresh GUI once after elements were added or removed */
+static void _refresh()
+{
         /* refresh whole tree view */
         ui_setup_tree_refresh();
 
@@ -504,7 +902,7 @@ static void _paste_node(LedPrefsNode * n,
 /******************************************************************************
  ******************************************************************************/
 
-/** cut currently selected element to clipboard */
+/** cut currently selected elements to clipboard */
 NftResult ui_clipboard_cut_current_selection()
 {
         /* get currently selected element */
@@ -519,32 +917,35 @@ NftResult ui_clipboard_cut_current_selection()
                 return NFT_FAILURE;
         }
 
-        /* highlight only this element */
-        ui_setup_tree_highlight_only(t, e);
-
-        LedPrefsNode *n;
-        if(!(n = _cut_or_copy_node(t, e, true)))
-                return NFT_FAILURE;
-
-        char *xml;
-        if(!(xml = led_prefs_node_to_buffer(setup_get_prefs(), n)))
+        /* copy all elements before anything gets removed */
+        ClipboardContents *cc;
+        if(!(cc = _copy_selection()))
                 return NFT_FAILURE;
 
-        /* set the clipboard text */
-        gtk_clipboard_set_text(_clipboard, xml, -1);
-
-        /* store the clipboard text */
-        gtk_clipboard_store(_clipboard);
+        /* remove elements (undone at once) */
+        undo_group_begin();
+        GList *l;
+        for(l = cc->elements; l; l = g_list_next(l))
+        {
+                ClipboardElement *el = l->data;
+                NFT_LOG(L_DEBUG, "Cutting element (type: %d / ptr: %p)...",
+                        el->type, el->element);
+                _cut_element(el->type, el->element);
+                el->element = NULL;
+        }
+        undo_group_end();
 
-        NFT_LOG(L_VERY_NOISY, "%s", xml);
+        _refresh();
 
-        free((void *) xml);
+        /* hide properties */
+        ui_setup_props_hide();
 
-        return NFT_SUCCESS;
+        /* XML is only created when another application asks for it */
+        return _clipboard_set(cc);
 }
 
 
-/** copy currently selected element to clipboard */
+/** copy currently selected elements to clipboard */
 NftResult ui_clipboard_copy_current_selection()
 {
         /* get currently selected element */
@@ -552,39 +953,36 @@ NftResult ui_clipboard_copy_current_selection()
         gpointer e;
         ui_setup_tree_get_first_selected_element(&t, &e);
 
+        ClipboardContents *cc;
+
         /* if nothing is selected, copy complete setup */
         if(t == LED_INVALID_T)
         {
-                e = setup_get_current();
-                t = LED_SETUP_T;
-        }
-
-        /* highlight only this element */
-        ui_setup_tree_highlight_only(t, e);
-
-        LedPrefsNode *n;
-        if(!(n = _cut_or_copy_node(t, e, false)))
-                return NFT_FAILURE;
+                ClipboardElement *el;
+                if(!(el = _element_new(LED_SETUP_T, setup_get_current())))
+                        return NFT_FAILURE;
 
-        char *xml;
-        if(!(xml = led_prefs_node_to_buffer(setup_get_prefs(), n)))
+                cc = g_slice_new0(ClipboardContents);
+                cc->elements = g_list_append(NULL, el);
+        }
+        else if(!(cc = _copy_selection()))
+        {
                 return NFT_FAILURE;
+        }
 
-        /* set the clipboard text */
-        gtk_clipboard_set_text(_clipboard, xml, -1);
-
-        /* store the clipboard text */
-        gtk_clipboard_store(_clipboard);
-
-        NFT_LOG(L_VERY_NOISY, "%s", xml);
-
-        free((void *) xml);
+        /* highlight only this element */
+        if(!g_list_next(cc->elements))
+        {
+                ClipboardElement *el = cc->elements->data;
+                ui_setup_tree_highlight_only(el->type, el->element);
+        }
 
-        return NFT_SUCCESS;
+        /* XML is only created when another application asks for it */
+        return _clipboard_set(cc);
 }
 
 
-/** paste element in clipboard after currently (or end of rootlist) */
+/** paste elements in clipboard to currently selected element */
 NftResult ui_clipboard_paste_current_selection()
 {
         /* get currently selected element */
@@ -599,7 +997,22 @@ NftResult ui_clipboard_paste_current_selection()
                 t = LED_SETUP_T;
         }
 
-        /* get XML data from clipboard */
+        /* we own the clipboard, paste without parsing XML */
+        if(_owned)
+        {
+                /* everything pasted is undone at once */
+                undo_group_begin();
+                GList *l;
+                for(l = _owned->elements; l; l = g_list_next(l))
+                        _paste_element(l->data, t, e);
+                undo_group_end();
+
+                _refresh();
+
+                return NFT_SUCCESS;
+        }
+
+        /* get XML data from another application */
         gchar *xml;
         if(!(xml = gtk_clipboard_wait_for_text(_clipboard)))
         {
@@ -616,7 +1029,12 @@ NftResult ui_clipboard_paste_current_selection()
                 return NFT_FAILURE;
         }
 
+        /* everything pasted is undone at once */
+        undo_group_begin();
         _paste_node(n, t, e);
+        undo_group_end();
+
+        _refresh();
 
         led_prefs_node_free(n);
         g_free(xml);
@@ -644,42 +1062,11 @@ NftResult ui_clipboard_copy_to_file(const char *filename)
         ui_setup_tree_highlight_only(t, e);
 
         LedPrefsNode *n;
-        if(!(n = _cut_or_copy_node(t, e, false)))
+        if(!(n = _copy_node(t, e)))
                 return NFT_FAILURE;
 
-        /* file existing? */
-        struct stat sts;
-        if(stat(filename, &sts) == -1)
-        {
-                /* continue if stat error was caused because file doesn't exist 
-                 */
-                if(errno != ENOENT)
-                {
-                        ui_log_alert_show("Failed to access \"%s\" - %s",
-                                          filename, strerror(errno));
-                        return NFT_FAILURE;
-                }
-        }
-        /* stat succeeded, file exists */
-        else
-        {
-                /* remove old file? */
-                if(!ui_log_dialog_yesno
-                   ("Overwrite",
-                    "A file named \"%s\" already exists.\nOverwrite?",
-                    filename))
-                        return NFT_FAILURE;
-
-                if(unlink(filename) == -1)
-                {
-                        ui_log_alert_show
-                                ("Failed to remove old version of \"%s\" - %s",
-                                 filename, strerror(errno));
-                        return NFT_FAILURE;
-                }
-        }
-
-        return led_prefs_node_to_file_minimal(setup_get_prefs(), n, filename, true);
+        /* write in background */
+        return ui_setup_save_node(n, filename, true, NULL, NULL);
 }
 
 
@@ -698,7 +1085,11 @@ NftResult ui_clipboard_paste_from_file(const char *filename)
                 return NFT_FAILURE;
         }
 
+        undo_group_begin();
         _paste_node(n, t, e);
+        undo_group_end();
+
+        _refresh();
 
         led_prefs_node_free(n);
 
@@ -713,9 +1104,6 @@ gboolean ui_clipboard_init()
         if(!(_clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD)))
                 return false;
 
-        /* initialize clipboard */
-        gtk_clipboard_set_can_store(_clipboard, NULL, 0);
-
         return true;
 }
 
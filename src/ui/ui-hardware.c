@@ -46,6 +46,7 @@
 #include "elements/element-hardware.h"
 #include "ui/ui-setup-tree.h"
 #include "ui/ui-setup-props.h"
+#include "undo/undo.h"
 
 
 
@@ -148,11 +149,10 @@ static void _foreach_remove_hardware(NIFTYLED_TYPE t, gpointer e)
 /** hardware remove */
 G_MODULE_EXPORT void on_action_hardware_remove_activate(GtkAction * a, gpointer u)
 {
-        /* remove all currently selected elements */
+        /* remove all currently selected elements (undone at once) */
+        undo_group_begin();
         ui_setup_tree_do_foreach_selected_element(_foreach_remove_hardware);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
+        undo_group_end();
 
         /* hide properties */
         ui_setup_props_hide();
@@ -183,10 +183,6 @@ G_MODULE_EXPORT void on_add_hardware_add_clicked(GtkButton * b, gpointer u)
         gtk_widget_set_visible(GTK_WIDGET(UI("hardware_add_window")), false);
 
                 /** @todo refresh our menu */
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
-
 }
 
 
@@ -60,6 +60,21 @@ static GtkBuilder *_builder;
 /* current log window position */
 static gint _pos_x, _pos_y;
 
+/** thread that runs GTK (messages of other threads are passed to it) */
+static GThread *_main_thread;
+
+
+/** copy of a message logged by another thread */
+typedef struct
+{
+        GtkTextView *tv;
+        NftLoglevel level;
+        gchar *file;
+        gchar *func;
+        int line;
+        gchar *msg;
+} LogMessage;
+
 /******************************************************************************
  ****************************** STATIC FUNCTIONS ******************************
  ******************************************************************************/
@@ -179,17 +194,12 @@ static NftResult _this_to_prefs(NftPrefs * prefs,
 }
 
 
-/** logging function */
-static void _logger(void *userdata,
-                    NftLoglevel level,
-                    const char *file,
-                    const char *func, int line, const char *msg)
+/** append message to log (main thread) */
+static void _log_append(GtkTextView * tv,
+                        NftLoglevel level,
+                        const char *file,
+                        const char *func, int line, const char *msg)
 {
-        /* output this at current loglevel? */
-        NftLoglevel lcur = nft_log_level_get();
-        if(lcur > level)
-                return;
-
         /* calc size */
         size_t size = 64;
         if(file)
@@ -241,9 +251,6 @@ static void _logger(void *userdata,
         strncat(s, msg, (size - strlen(s) > 0 ? size - strlen(s) : 0));
         strncat(s, "\n", (size - strlen(s) > 0 ? size - strlen(s) : 0));
 
-	/* the text view is passed to us as userdata pointer */
-        GtkTextView *tv = GTK_TEXT_VIEW(userdata);
-
 	/* get text buffer of our text view */
         GtkTextBuffer *buf = gtk_text_view_get_buffer(tv);
 
@@ -294,6 +301,54 @@ static void _logger(void *userdata,
 }
 
 
+/** append message logged by another thread */
+static gboolean _log_idle(gpointer u)
+{
+        LogMessage *m = u;
+
+        _log_append(m->tv, m->level, m->file, m->func, m->line, m->msg);
+
+        g_free(m->file);
+        g_free(m->func);
+        g_free(m->msg);
+        g_slice_free(LogMessage, m);
+
+        return false;
+}
+
+
+/** logging function */
+static void _logger(void *userdata,
+                    NftLoglevel level,
+                    const char *file,
+                    const char *func, int line, const char *msg)
+{
+        /* output this at current loglevel? */
+        NftLoglevel lcur = nft_log_level_get();
+        if(lcur > level)
+                return;
+
+	/* the text view is passed to us as userdata pointer */
+        GtkTextView *tv = GTK_TEXT_VIEW(userdata);
+
+        /* GTK must only be used by the main thread */
+        if(g_thread_self() != _main_thread)
+        {
+                LogMessage *m = g_slice_new(LogMessage);
+                m->tv = tv;
+                m->level = level;
+                m->file = g_strdup(file);
+                m->func = g_strdup(func);
+                m->line = line;
+                m->msg = g_strdup(msg ? msg : "");
+                g_idle_add(_log_idle, m);
+                return;
+        }
+
+        _log_append(tv, level, file, func, line, msg);
+}
+
+
 
 /******************************************************************************
  ******************************************************************************/
@@ -470,6 +525,7 @@ gboolean ui_log_init()
                                  (gint) nft_log_level_get() - 1);
 
         /* register our custom logger function */
+        _main_thread = g_thread_self();
         nft_log_func_register(_logger, UI("textview"));
 
         /* get text buffer of our text view */
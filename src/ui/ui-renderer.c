@@ -42,14 +42,28 @@
  */
 
 
+#include <math.h>
 #include <gtk/gtk.h>
 #include <niftyled.h>
 #include "ui/ui.h"
 #include "ui/ui-renderer.h"
+#include "ui/ui-setup-tree.h"
+#include "ui/ui-setup-ledlist.h"
+#include "ui/ui-setup-props.h"
 #include "elements/element-setup.h"
 #include "elements/element-tile.h"
 #include "renderer/renderer.h"
+#include "renderer/renderer-led.h"
+#include "renderer/renderer-tile.h"
 #include "prefs/prefs.h"
+#include "spatial-index/spatial-index.h"
+#include "selection/selection.h"
+#include "live-preview/live-preview.h"
+#include "undo/undo.h"
+
+
+/** maximum distance (in pixels) the mouse may move to still count as click */
+#define CLICK_DISTANCE          3
 
 
 
@@ -72,6 +86,19 @@ static struct
         {
                 gboolean mouse_1_pressed;
                 gdouble mouse_hold_x, mouse_hold_y;
+                /** true while a selection rectangle is dragged */
+                gboolean band_active;
+                /** current (moving) corner of selection rectangle */
+                gdouble band_x, band_y;
+                /** tile dragged with <ctrl> pressed (or NULL) */
+                NiftyconfTile *drag_tile;
+                /** true if dragged tile is rotated instead of moved */
+                gboolean drag_rotate;
+                /** placement of dragged tile when drag started */
+                LedFrameCord drag_x, drag_y;
+                gdouble drag_rotation;
+                /** placement of dragged tile was recorded for undo */
+                gboolean drag_recorded;
         } input;
 
         struct
@@ -84,6 +111,8 @@ static struct
 
 /** GtkBuilder for this module */
 static GtkBuilder *_builder;
+/** LEDs selected by dragging a rectangle */
+static NiftyconfSelection *_region;
 
 
 
@@ -153,6 +182,185 @@ static NftResult _this_to_prefs(NftPrefs * prefs,
 
 
 
+/** convert widget coordinates to setup coordinates */
+static void _screen_to_setup(gdouble sx, gdouble sy, double *x, double *y)
+{
+        *x = (sx - _r.view.pan_x) / (_r.view.scale * _r.view.scale_factor);
+        *y = (sy - _r.view.pan_y) / (_r.view.scale * _r.view.scale_factor);
+}
+
+
+/** select LED (or tile if there's no LED) at widget coordinates */
+static void _select_at(gdouble sx, gdouble sy)
+{
+        double x, y;
+        _screen_to_setup(sx, sy, &x, &y);
+
+        /* LED under cursor? */
+        NiftyconfLed *l;
+        if((l = spatial_index_led_at(x, y)))
+        {
+                /* select chain of LED (this fills the ledlist)... */
+                ui_setup_tree_select_element(LED_CHAIN_T, led_get_chain(l));
+                /* ...and LED itself */
+                ui_setup_ledlist_select_led(l);
+                return;
+        }
+
+        /* tile under cursor? */
+        NiftyconfTile *t;
+        if((t = spatial_index_tile_at(x, y)))
+        {
+                ui_setup_tree_select_element(LED_TILE_T, t);
+        }
+}
+
+
+/** start dragging tile at widget coordinates */
+static void _drag_begin(gdouble sx, gdouble sy, gboolean rotate)
+{
+        double x, y;
+        _screen_to_setup(sx, sy, &x, &y);
+
+        NiftyconfTile *tile;
+        if(!(tile = spatial_index_tile_at(x, y)))
+                return;
+
+        /* select tile (shows its props) */
+        ui_setup_tree_select_element(LED_TILE_T, tile);
+
+        LedTile *t = tile_niftyled(tile);
+        led_tile_get_pos(t, &_r.input.drag_x, &_r.input.drag_y);
+        _r.input.drag_rotation = led_tile_get_rotation(t);
+        _r.input.drag_rotate = rotate;
+        _r.input.drag_recorded = false;
+        _r.input.drag_tile = tile;
+}
+
+
+/** record placement of dragged tile before it's changed the first time */
+static void _drag_record()
+{
+        if(_r.input.drag_recorded)
+                return;
+
+        undo_record_tile(_r.input.drag_tile);
+        _r.input.drag_recorded = true;
+}
+
+
+/** move/rotate dragged tile according to widget coordinates */
+static void _drag_update(gdouble sx, gdouble sy)
+{
+        LedTile *t = tile_niftyled(_r.input.drag_tile);
+
+        double x0, y0, x, y;
+        _screen_to_setup(_r.input.mouse_hold_x, _r.input.mouse_hold_y,
+                         &x0, &y0);
+        _screen_to_setup(sx, sy, &x, &y);
+
+        if(_r.input.drag_rotate)
+        {
+                /* rotate by angle the cursor moved around pivot */
+                double pX, pY;
+                led_tile_get_pivot(t, &pX, &pY);
+                tile_local_to_world(t, &pX, &pY);
+                double a = atan2(y - pY, x - pX) - atan2(y0 - pY, x0 - pX);
+                if(led_tile_get_rotation(t) == _r.input.drag_rotation + a)
+                        return;
+
+                _drag_record();
+
+                led_tile_set_rotation(t, _r.input.drag_rotation + a);
+        }
+        else
+        {
+                /* movement in coordinates of parent tile */
+                LedTile *p;
+                if((p = led_tile_get_parent_tile(t)))
+                {
+                        tile_world_to_local(p, &x0, &y0);
+                        tile_world_to_local(p, &x, &y);
+                }
+
+                LedFrameCord nx =
+                        _r.input.drag_x + (LedFrameCord) lround(x - x0);
+                LedFrameCord ny =
+                        _r.input.drag_y + (LedFrameCord) lround(y - y0);
+                LedFrameCord ox, oy;
+                led_tile_get_pos(t, &ox, &oy);
+                if(ox == nx && oy == ny)
+                        return;
+
+                _drag_record();
+
+                led_tile_set_pos(t, nx, ny);
+        }
+
+        /* only re-composite, tile's surface stays valid */
+        renderer_tile_damage_placement(_r.input.drag_tile);
+}
+
+
+/** finish dragging a tile */
+static void _drag_end()
+{
+        NiftyconfTile *tile = _r.input.drag_tile;
+        _r.input.drag_tile = NULL;
+
+        /* update position of all LEDs in tile */
+        spatial_index_update_tile(tile);
+
+        /* show new placement */
+        ui_setup_tree_update_element(LED_TILE_T, tile);
+        ui_setup_props_tile_show(tile);
+}
+
+
+/** foreach helper to add LED to region selection */
+static void _region_add_led(NiftyconfLed * l, void *u)
+{
+        selection_add_led(_region, l);
+        led_set_highlighted(l, true);
+        renderer_led_damage(l);
+}
+
+
+/** foreach helper to unhighlight LED */
+static void _region_unhighlight_led(NiftyconfLed * l, void *u)
+{
+        led_set_highlighted(l, false);
+        renderer_led_damage(l);
+}
+
+
+/** select all LEDs inside rectangle (widget coordinates) */
+static void _select_region(gdouble sx1, gdouble sy1, gdouble sx2, gdouble sy2)
+{
+        /* drop previous region */
+        ui_renderer_selection_clear();
+        live_preview_clear();
+
+        /* query all LEDs inside rectangle */
+        double x1, y1, x2, y2;
+        _screen_to_setup(sx1, sy1, &x1, &y1);
+        _screen_to_setup(sx2, sy2, &x2, &y2);
+        spatial_index_foreach_in_rect(MIN(x1, x2), MIN(y1, y2),
+                                      MAX(x1, x2), MAX(y1, y2),
+                                      _region_add_led, NULL);
+
+        if(selection_is_empty(_region))
+                return;
+
+        /* show props of selected LEDs */
+        ui_setup_props_hide();
+        ui_setup_props_selection_show(_region);
+
+        /* refresh live hardware preview */
+        live_preview_show();
+}
+
+
 /** increase zoom level of rendered view */
 static void _zoom_in()
 {
@@ -207,6 +415,24 @@ GtkWidget *ui_renderer_widget()
 }
 
 
+/** getter for LEDs currently selected by rectangle */
+NiftyconfSelection *ui_renderer_selection()
+{
+        return _region;
+}
+
+
+/** unhighlight and deselect all LEDs selected by rectangle */
+void ui_renderer_selection_clear()
+{
+        if(selection_is_empty(_region))
+                return;
+
+        selection_foreach(_region, _region_unhighlight_led, NULL);
+        selection_clear(_region);
+}
+
+
 /** queue redraw (manually expose) */
 void ui_renderer_all_queue_draw()
 {
@@ -237,6 +463,9 @@ gboolean ui_renderer_init()
         /* initialize drawingarea */
         gtk_widget_set_app_paintable(GTK_WIDGET(UI("drawingarea")), true);
 
+        /* selection of LEDs in drawingarea */
+        _region = selection_new();
+
         return true;
 }
 
@@ -247,6 +476,8 @@ void ui_renderer_deinit()
         /* unregister prefs class */
         nft_prefs_class_unregister(prefs(), "renderer");
 
+        selection_destroy(_region);
+
         g_object_unref(_builder);
 }
 
@@ -276,6 +507,29 @@ G_MODULE_EXPORT gboolean on_renderer_button_press_event(GtkWidget * w,
         _r.input.mouse_hold_x = ev->x;
         _r.input.mouse_hold_y = ev->y;
 
+        /* <ctrl> + button 1 moves, <ctrl> + button 3 rotates tile */
+        if((ev->button == 1 || ev->button == 3) &&
+           (ev->state & GDK_CONTROL_MASK))
+        {
+                _drag_begin(ev->x, ev->y, ev->button == 3);
+                return false;
+        }
+
+        if(ev->button == 1)
+        {
+                /* <shift> starts selection rectangle */
+                if(ev->state & GDK_SHIFT_MASK)
+                {
+                        _r.input.band_active = true;
+                        _r.input.band_x = ev->x;
+                        _r.input.band_y = ev->y;
+                }
+                else
+                {
+                        _r.input.mouse_1_pressed = true;
+                }
+        }
+
         return false;
 }
 
@@ -285,6 +539,41 @@ G_MODULE_EXPORT gboolean on_renderer_button_release_event(GtkWidget * w,
                                                           GdkEvent * ev,
                                                           gpointer u)
 {
+        /* tile drag finished? */
+        if(_r.input.drag_tile)
+        {
+                _drag_end();
+                ui_renderer_all_queue_draw();
+                return false;
+        }
+
+        /* selection rectangle finished? */
+        if(_r.input.band_active && ev->button.button == 1)
+        {
+                _r.input.band_active = false;
+                _select_region(_r.input.mouse_hold_x, _r.input.mouse_hold_y,
+                               ev->button.x, ev->button.y);
+                ui_renderer_all_queue_draw();
+                return false;
+        }
+
+        /* button 1 released without moving? */
+        if(_r.input.mouse_1_pressed && ev->button.button == 1)
+        {
+                _r.input.mouse_1_pressed = false;
+
+                if(ABS(ev->button.x - _r.input.mouse_hold_x) <= CLICK_DISTANCE
+                   && ABS(ev->button.y - _r.input.mouse_hold_y) <=
+                   CLICK_DISTANCE)
+                {
+                        /* discard (tiny) pan and select element under cursor */
+                        _r.view.pan_t_x = 0;
+                        _r.view.pan_t_y = 0;
+                        _select_at(ev->button.x, ev->button.y);
+                        return false;
+                }
+        }
+
         _r.view.pan_x += _r.view.pan_t_x;
         _r.view.pan_y += _r.view.pan_t_y;
         _r.view.pan_t_x = 0;
@@ -298,8 +587,19 @@ G_MODULE_EXPORT gboolean on_renderer_motion_notify_event(GtkWidget * w,
                                                          GdkEventMotion * ev,
                                                          gpointer u)
 {
+        /* dragging tile? */
+        if(_r.input.drag_tile)
+        {
+                _drag_update(ev->x, ev->y);
+        }
+        /* dragging selection rectangle? */
+        else if(_r.input.band_active)
+        {
+                _r.input.band_x = ev->x;
+                _r.input.band_y = ev->y;
+        }
         /* mousebutton pressed? */
-        if(ev->state & GDK_BUTTON1_MASK)
+        else if(ev->state & GDK_BUTTON1_MASK)
         {
                 _r.view.pan_t_x = -(_r.input.mouse_hold_x - ev->x);
                 _r.view.pan_t_y = -(_r.input.mouse_hold_y - ev->y);
@@ -400,6 +700,22 @@ G_MODULE_EXPORT gboolean on_renderer_expose_event(GtkWidget * w,
         /* render surface */
         cairo_paint(cr);
 
+        /* draw selection rectangle (in widget coordinates) */
+        if(_r.input.band_active)
+        {
+                cairo_identity_matrix(cr);
+                cairo_rectangle(cr,
+                                MIN(_r.input.mouse_hold_x, _r.input.band_x),
+                                MIN(_r.input.mouse_hold_y, _r.input.band_y),
+                                ABS(_r.input.band_x - _r.input.mouse_hold_x),
+                                ABS(_r.input.band_y - _r.input.mouse_hold_y));
+                cairo_set_source_rgba(cr, 0.3, 0.5, 1, 0.25);
+                cairo_fill_preserve(cr);
+                cairo_set_source_rgba(cr, 0.3, 0.5, 1, 1);
+                cairo_set_line_width(cr, 1);
+                cairo_stroke(cr);
+        }
+
         /* free context */
         cairo_destroy(cr);
 
@@ -44,6 +44,7 @@
 #ifndef _UI_RENDERER_H
 #define _UI_RENDERER_H
 
+#include "selection/selection.h"
 
 
 /* GUI functions */
@@ -54,6 +55,8 @@ cairo_filter_t                  ui_renderer_filter();
 cairo_antialias_t               ui_renderer_antialias();
 gdouble                         ui_renderer_scale_factor();
 void                            ui_renderer_all_queue_draw();
+NiftyconfSelection             *ui_renderer_selection();
+void                            ui_renderer_selection_clear();
 
 
 #endif /* _UI_RENDERER_H */
@@ -50,6 +50,8 @@
 #include "elements/element-chain.h"
 #include "renderer/renderer.h"
 #include "renderer/renderer-led.h"
+#include "renderer/renderer-chain.h"
+#include "selection/selection.h"
 
 
 
@@ -69,6 +71,8 @@ typedef enum
 static GtkBuilder *_builder;
 /** narf! */
 static bool _clear_in_progress;
+/** LEDs of currently selected rows */
+static NiftyconfSelection *_selection;
 
 
 
@@ -82,28 +86,247 @@ static void on_selection_changed(GtkTreeSelection * treeselection,
  ******************************************************************************/
 
 
-/** build list of Leds */
-static void _build(NiftyconfChain * c)
+/******************************************************************************
+ ***************************** LIST MODEL *************************************
+ ******************************************************************************/
+
+/**
+ * GtkTreeModel that serves one row per LED straight from the chain. An iter
+ * holds the position of its LED (user_data), the view only fetches the rows
+ * it displays.
+ */
+typedef struct
+{
+        GObject parent;
+        /** stamp of iters that belong to this model */
+        gint stamp;
+        /** chain currently listed (or NULL) */
+        NiftyconfChain *chain;
+        /** amount of rows */
+        LedCount ledcount;
+} LedlistModel;
+
+typedef struct
+{
+        GObjectClass parent_class;
+} LedlistModelClass;
+
+
+static void _model_iface_init(GtkTreeModelIface * iface);
+
+G_DEFINE_TYPE_WITH_CODE(LedlistModel, ledlist_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL,
+                                              _model_iface_init));
+
+
+/** the model of our treeview */
+static LedlistModel *_model;
+
+
+/** fill iter with LED at position n */
+static gboolean _iter_set(GtkTreeIter * iter, gint n)
+{
+        if(n < 0 || (LedCount) n >= _model->ledcount)
+                return false;
+
+        iter->stamp = _model->stamp;
+        iter->user_data = GINT_TO_POINTER(n);
+        iter->user_data2 = NULL;
+        iter->user_data3 = NULL;
+
+        return true;
+}
+
+
+static GtkTreeModelFlags _model_get_flags(GtkTreeModel * m)
+{
+        return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+
+static gint _model_get_n_columns(GtkTreeModel * m)
+{
+        return NUM_CHAIN_COLS;
+}
+
+
+static GType _model_get_column_type(GtkTreeModel * m, gint column)
+{
+        switch (column)
+        {
+                case C_CHAIN_LED:
+                        return G_TYPE_INT;
+                case C_CHAIN_ELEMENT:
+                        return G_TYPE_POINTER;
+                default:
+                        return G_TYPE_INVALID;
+        }
+}
+
+
+static gboolean _model_get_iter(GtkTreeModel * m,
+                                GtkTreeIter * iter, GtkTreePath * path)
+{
+        if(gtk_tree_path_get_depth(path) != 1)
+                return false;
+
+        return _iter_set(iter, gtk_tree_path_get_indices(path)[0]);
+}
+
+
+static GtkTreePath *_model_get_path(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        return gtk_tree_path_new_from_indices(GPOINTER_TO_INT
+                                              (iter->user_data), -1);
+}
+
+
+static void _model_get_value(GtkTreeModel * m,
+                             GtkTreeIter * iter, gint column, GValue * value)
+{
+        gint n = GPOINTER_TO_INT(iter->user_data);
+
+        switch (column)
+        {
+                case C_CHAIN_LED:
+                {
+                        g_value_init(value, G_TYPE_INT);
+                        g_value_set_int(value, n);
+                        break;
+                }
+
+                case C_CHAIN_ELEMENT:
+                {
+                        Led *l = led_chain_get_nth(chain_niftyled
+                                                   (_model->chain), n);
+                        g_value_init(value, G_TYPE_POINTER);
+                        g_value_set_pointer(value, led_get_privdata(l));
+                        break;
+                }
+        }
+}
+
+
+static gboolean _model_iter_next(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        return _iter_set(iter, GPOINTER_TO_INT(iter->user_data) + 1);
+}
+
+
+static gboolean _model_iter_children(GtkTreeModel * m,
+                                     GtkTreeIter * iter, GtkTreeIter * parent)
+{
+        if(parent)
+                return false;
+
+        return _iter_set(iter, 0);
+}
+
+
+static gboolean _model_iter_has_child(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        return false;
+}
+
+
+static gint _model_iter_n_children(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        if(iter)
+                return 0;
+
+        return (gint) _model->ledcount;
+}
+
+
+static gboolean _model_iter_nth_child(GtkTreeModel * m,
+                                      GtkTreeIter * iter,
+                                      GtkTreeIter * parent, gint n)
+{
+        if(parent)
+                return false;
+
+        return _iter_set(iter, n);
+}
+
+
+static gboolean _model_iter_parent(GtkTreeModel * m,
+                                   GtkTreeIter * iter, GtkTreeIter * child)
+{
+        return false;
+}
+
+
+static void _model_iface_init(GtkTreeModelIface * iface)
+{
+        iface->get_flags = _model_get_flags;
+        iface->get_n_columns = _model_get_n_columns;
+        iface->get_column_type = _model_get_column_type;
+        iface->get_iter = _model_get_iter;
+        iface->get_path = _model_get_path;
+        iface->get_value = _model_get_value;
+        iface->iter_next = _model_iter_next;
+        iface->iter_children = _model_iter_children;
+        iface->iter_has_child = _model_iter_has_child;
+        iface->iter_n_children = _model_iter_n_children;
+        iface->iter_nth_child = _model_iter_nth_child;
+        iface->iter_parent = _model_iter_parent;
+}
+
+
+static void ledlist_model_init(LedlistModel * m)
+{
+        m->stamp = g_random_int();
+}
+
+
+static void ledlist_model_class_init(LedlistModelClass * c)
+{
+}
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** (un)highlight a range of LEDs */
+static void _highlight_range(NiftyconfChain * c,
+                             LedCount first, LedCount last, void *u)
 {
-        /* rebuild */
+        gboolean highlight = GPOINTER_TO_INT(u);
+        LedChain *chain = chain_niftyled(c);
+
         LedCount i;
-        for(i = 0; i < led_chain_get_ledcount(chain_niftyled(c)); i++)
+        for(i = first; i <= last; i++)
         {
-                Led *led = led_chain_get_nth(chain_niftyled(c), i);
-                GtkTreeIter iter;
-                gtk_list_store_append(GTK_LIST_STORE(UI("liststore")), &iter);
-                gtk_list_store_set(GTK_LIST_STORE(UI("liststore")), &iter,
-                                   C_CHAIN_LED, i,
-                                   C_CHAIN_ELEMENT, led_get_privdata(led),
-                                   -1);
-
-                led_set_highlighted(led_get_privdata(led), false);
-                renderer_led_damage(led_get_privdata(led));
+                NiftyconfLed *l;
+                if(!(l = led_get_privdata(led_chain_get_nth(chain, i))))
+                        continue;
+
+                led_set_highlighted(l, highlight);
+                renderer_damage(led_get_renderer(l));
         }
 
-        gtk_widget_show(GTK_WIDGET(UI("treeview")));
+        if(!highlight)
+                live_preview_unhighlight_range(c, first, last);
+
+        /* damage chain once for the whole range */
+        renderer_chain_damage(c);
 }
 
+
+/** add LED of a selected row to selection */
+static void _selection_add_row(GtkTreeModel * m,
+                               GtkTreePath * p, GtkTreeIter * i,
+                               gpointer data)
+{
+        gint n = gtk_tree_path_get_indices(p)[0];
+        selection_add_range(_selection, _model->chain, n, n);
+
+        /* remember last selected row */
+        *((gint *) data) = n;
+}
+
+
 /******************************************************************************
  ******************************************************************************/
 
@@ -117,14 +340,35 @@ GtkWidget *ui_setup_ledlist_get_widget()
 /** clear list */
 void ui_setup_ledlist_clear()
 {
+        if(!_model->chain)
+                return;
+
+        GtkTreeView *v = GTK_TREE_VIEW(UI("treeview"));
+
+        /* only selected LEDs are highlighted */
+        selection_foreach_range(_selection, _highlight_range,
+                                GINT_TO_POINTER(false));
+        selection_clear(_selection);
+
         _clear_in_progress = true;
 
-        gtk_list_store_clear(GTK_LIST_STORE(UI("liststore")));
+        gtk_tree_view_set_model(v, NULL);
+        _model->chain = NULL;
+        _model->ledcount = 0;
+        _model->stamp++;
 
         _clear_in_progress = false;
 }
 
 
+/** clear list if it currently shows this chain (e.g. before it's freed) */
+void ui_setup_ledlist_forget_chain(NiftyconfChain * c)
+{
+        if(_model->chain == c)
+                ui_setup_ledlist_clear();
+}
+
+
 /** rebuild list */
 void ui_setup_ledlist_refresh(NiftyconfChain * c)
 {
@@ -134,7 +378,12 @@ void ui_setup_ledlist_refresh(NiftyconfChain * c)
         /* clear ledlist */
         ui_setup_ledlist_clear();
 
-        _build(c);
+        /* (re-)attach model, view only fetches the rows it displays */
+        _model->chain = c;
+        _model->ledcount = led_chain_get_ledcount(chain_niftyled(c));
+        gtk_tree_view_set_model(GTK_TREE_VIEW(UI("treeview")),
+                                GTK_TREE_MODEL(_model));
+        gtk_widget_show(GTK_WIDGET(UI("treeview")));
 
         /* redraw */
         ui_renderer_all_queue_draw();
@@ -144,6 +393,28 @@ void ui_setup_ledlist_refresh(NiftyconfChain * c)
 
 
 
+/** select (only) the row of a LED & scroll to it */
+void ui_setup_ledlist_select_led(NiftyconfLed * l)
+{
+        if(!l)
+                NFT_LOG_NULL();
+
+        /* rows are ordered by position of LED in chain */
+        GtkTreePath *path =
+                gtk_tree_path_new_from_indices((gint) led_get_chainpos(l), -1);
+
+        GtkTreeView *v = GTK_TREE_VIEW(UI("treeview"));
+        gtk_tree_view_scroll_to_cell(v, path, NULL, false, 0, 0);
+
+        /* select row (triggers on_selection_changed()) */
+        GtkTreeSelection *s = gtk_tree_view_get_selection(v);
+        gtk_tree_selection_unselect_all(s);
+        gtk_tree_selection_select_path(s, path);
+
+        gtk_tree_path_free(path);
+}
+
+
 /** initialize this module */
 gboolean ui_setup_ledlist_init()
 {
@@ -166,153 +437,73 @@ gboolean ui_setup_ledlist_init()
         gtk_tree_view_column_add_attribute(col, renderer, "text",
                                            C_CHAIN_LED);
 
+        /* rows of a chain are all the same height */
+        gtk_tree_view_column_set_sizing(col, GTK_TREE_VIEW_COLUMN_FIXED);
+        gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(UI("treeview")),
+                                            true);
+
+        /* model that represents current chain */
+        _model = g_object_new(ledlist_model_get_type(), NULL);
+        _selection = selection_new();
+
         return true;
 }
 
 /** deinitialize this module */
 void ui_setup_ledlist_deinit()
 {
+        selection_destroy(_selection);
+        g_object_unref(_model);
         g_object_unref(_builder);
 }
 
-/** run function on every selected tree-element (multiple selections) */
-void
-ui_setup_ledlist_do_foreach_selected_element(void (*func)
-                                             (NiftyconfLed * led, void *u),
-                                             void *u)
+/** LEDs of currently selected rows */
+NiftyconfSelection *ui_setup_ledlist_selection()
 {
-        /* get current treeview selection */
-        GtkTreeSelection *selection;
-        selection =
-                gtk_tree_view_get_selection(GTK_TREE_VIEW(UI("treeview")));
-
-        /* something selected? */
-        GList *selected;
-        GtkTreeModel *m;
-        if(!(selected = gtk_tree_selection_get_selected_rows(selection, &m)))
-                return;
-
-        /* walk all selected rows */
-        GList *cur;
-        for(cur = g_list_last(selected); cur; cur = g_list_previous(cur))
-        {
-                GtkTreePath *path = (GtkTreePath *) cur->data;
-                GtkTreeIter i;
-                gtk_tree_model_get_iter(m, &i, path);
-
-                /* get this element */
-                LedCount current_pos;
-                NiftyconfLed *current_led;
-                gtk_tree_model_get(m, &i, C_CHAIN_LED, &current_pos,
-                                   C_CHAIN_ELEMENT, &current_led, -1);
-
-                /* run user function */
-                func(current_led, u);
-        }
-
-        /* free list */
-        g_list_foreach(selected, (GFunc) gtk_tree_path_free, NULL);
-        g_list_free(selected);
-}
-
-
-
-
-/** run function on every tree-element */
-void ui_setup_ledlist_do_foreach_element(void (*func) (NiftyconfLed * led))
-{
-        /* get model */
-        GtkTreeModel *m =
-                gtk_tree_view_get_model(GTK_TREE_VIEW(UI("treeview")));
-        GtkTreeIter iter;
-        if(!gtk_tree_model_iter_nth_child(m, &iter, NULL, 0))
-                return;
-
-        do
-        {
-                /* get this element */
-                NiftyconfLed *current_led;
-                gtk_tree_model_get(m, &iter, C_CHAIN_ELEMENT, &current_led,
-                                   -1);
-
-                /* launch function */
-                func(current_led);
-        }
-        while(gtk_tree_model_iter_next(m, &iter));
+        return _selection;
 }
 
 /******************************************************************************
  ***************************** CALLBACKS ************************************
  ******************************************************************************/
 
-/** function to process an element that is currently selected */
-static void _element_selected(GtkTreeModel * m,
-                              GtkTreePath * p, GtkTreeIter * i, gpointer data)
-{
-        /* get element represented by this row */
-        gpointer *element;
-        LedCount n;
-        gtk_tree_model_get(m, i, C_CHAIN_LED, &n, C_CHAIN_ELEMENT, &element,
-                           -1);
-        NiftyconfLed *l = (NiftyconfLed *) element;
-
-        led_set_highlighted(l, true);
-        renderer_led_damage(l);
-}
-
-
-/** deselect all Leds */
-static void _foreach_unhighlight(NiftyconfLed * led)
-{
-        led_set_highlighted(led, false);
-        renderer_led_damage(led);
-}
-
-
 /** selection changed */
 static void on_selection_changed(GtkTreeSelection * selection, gpointer u)
 {
         if(_clear_in_progress)
                 return;
 
-        // GtkTreeModel *m = gtk_tree_view_get_model(tv);
-
-        /* unhighlight all elements */
-        // GtkTreeIter i;
-        // gtk_tree_model_get_iter_root(m, &i);
-        // _walk_tree(&i, _unhighlight_element);
+        /* drop LEDs selected in renderer */
+        ui_renderer_selection_clear();
+
+        /* unhighlight previously selected LEDs */
+        if(selection_is_empty(_selection))
+                /* preview should only show selected LEDs of this chain */
+                live_preview_unhighlight_chain(_model->chain);
+        else
+                selection_foreach_range(_selection, _highlight_range,
+                                        GINT_TO_POINTER(false));
+        selection_clear(_selection);
+
+        /* collect & highlight currently selected LEDs */
+        gint last = -1;
+        gtk_tree_selection_selected_foreach(selection, _selection_add_row,
+                                            &last);
+        selection_foreach_range(_selection, _highlight_range,
+                                GINT_TO_POINTER(true));
 
-        /* clear preview */
-        live_preview_clear();
-        ui_setup_ledlist_do_foreach_element(_foreach_unhighlight);
-
-        /* process all selected elements */
-        gtk_tree_selection_selected_foreach(selection, _element_selected,
-                                            NULL);
+        /* redraw */
+        ui_renderer_all_queue_draw();
 
-        /* get last selected element */
-        GList *selected;
-        GtkTreeModel *m;
-        if(!(selected = gtk_tree_selection_get_selected_rows(selection, &m)))
+        if(last < 0)
                 return;
 
-        GtkTreePath *path = (GtkTreePath *) g_list_last(selected)->data;
-        GtkTreeIter iter;
-        gtk_tree_model_get_iter(m, &iter, path);
-
-        /* get this element */
-        LedCount i;
-        gpointer *p;
-        gtk_tree_model_get(m, &iter, C_CHAIN_LED, &i, C_CHAIN_ELEMENT, &p,
-                           -1);
-
-        /* show property dialog for this led */
+        /* show property dialog for last selected LED */
         ui_setup_props_hide();
-        ui_setup_props_led_show((NiftyconfLed *) p);
+        ui_setup_props_led_show(led_get_privdata
+                                (led_chain_get_nth
+                                 (chain_niftyled(_model->chain), last)));
 
         /* refresh live hardware preview */
         live_preview_show();
-
-        /* redraw */
-        ui_renderer_all_queue_draw();
 }
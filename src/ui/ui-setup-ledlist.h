@@ -45,6 +45,8 @@
 #define _UI_SETUP_LEDLIST_H
 
 #include "elements/element-chain.h"
+#include "elements/element-led.h"
+#include "selection/selection.h"
 
 
 
@@ -57,9 +59,11 @@ GtkWidget                      *ui_setup_ledlist_get_widget();
 /* GUI functions */
 void                            ui_setup_ledlist_refresh(NiftyconfChain * c);
 void                            ui_setup_ledlist_clear();
+void                            ui_setup_ledlist_forget_chain(NiftyconfChain * c);
+void                            ui_setup_ledlist_select_led(NiftyconfLed * l);
 
 /* model functions */
-void                            ui_setup_ledlist_do_foreach_selected_element(void (*func) (NiftyconfLed * led, void *u), void *u);
+NiftyconfSelection             *ui_setup_ledlist_selection();
 
 
 #endif /* _UI_SETUP_LEDLIST_H */
@@ -55,6 +55,8 @@
 #include "renderer/renderer-chain.h"
 #include "renderer/renderer-led.h"
 #include "live-preview/live-preview.h"
+#include "spatial-index/spatial-index.h"
+#include "undo/undo.h"
 
 
 
@@ -68,6 +70,38 @@ static NiftyconfHardware *current_hw;
 static NiftyconfTile *current_tile;
 static NiftyconfChain *current_chain;
 static NiftyconfLed *current_led;
+/* LEDs selected in renderer (NULL if LEDs are selected in ledlist) */
+static NiftyconfSelection *current_selection;
+
+
+/** interval to collect edits before they're committed (ms) */
+#define EDIT_COMMIT_INTERVAL 16
+
+/** what changed about an edited tile */
+typedef enum
+{
+        /** position or rotation (surface of tile stays valid) */
+        EDIT_TILE_PLACEMENT = 1 << 0,
+        /** something that's drawn on the tile's surface */
+        EDIT_TILE_CONTENT = 1 << 1,
+} EditTile;
+
+/** side effects of property edits that are committed once per frame */
+static struct
+{
+        /** edits are pending */
+        gboolean pending;
+        /** id of scheduled commit (0 if none) */
+        guint source;
+        /** tiles that were edited: tile -> EditTile flags */
+        GHashTable *tiles;
+        /** hardware whose gain changed */
+        GHashTable *gain;
+        /** gain of all hardware changed */
+        gboolean gain_all;
+        /** edits are recorded as one undo step */
+        gboolean recording;
+} _edit;
 
 
 /******************************************************************************
@@ -90,27 +124,103 @@ static void _widget_set_error_background(GtkWidget * w, gboolean error)
 }
 
 
+/** commit timeout */
+static gboolean _edit_commit_cb(gpointer u)
+{
+        _edit.source = 0;
+        ui_setup_props_commit();
+        return false;
+}
+
+
+/** schedule commit of pending edits */
+static void _edit_schedule()
+{
+        _edit.pending = true;
+
+        if(!_edit.source)
+                _edit.source = g_timeout_add(EDIT_COMMIT_INTERVAL,
+                                             _edit_commit_cb, NULL);
+}
+
+
+/** start recording edits for undo (until next commit) */
+static void _edit_begin()
+{
+        if(_edit.recording)
+                return;
+
+        undo_group_begin();
+        _edit.recording = true;
+}
+
+
+/** tile was edited */
+static void _edit_tile(NiftyconfTile * t, EditTile what)
+{
+        what |= GPOINTER_TO_INT(g_hash_table_lookup(_edit.tiles, t));
+        g_hash_table_insert(_edit.tiles, t, GINT_TO_POINTER(what));
+        _edit_schedule();
+}
+
+
+/** LEDs currently shown in props */
+static NiftyconfSelection *_current_leds()
+{
+        if(current_selection)
+                return current_selection;
+
+        return ui_setup_ledlist_selection();
+}
+
+
 
 
 /******************************************************************************
  ***************************** CALLBACKS **************************************
  ******************************************************************************/
 
-/** foreach helper to set led's x position */
-void _set_x(NiftyconfLed * led, void *u)
+/** set position of a range of LEDs (NULL x or y keeps that coordinate) */
+static void _set_pos(NiftyconfChain * chain,
+                     LedCount first, LedCount last,
+                     const LedFrameCord * new_x, const LedFrameCord * new_y)
 {
-        Led *l = led_niftyled(led);
-        LedFrameCord *new_val = u;
-        LedFrameCord x, y;
-        led_get_pos(l, &x, &y);
+        LedChain *c = chain_niftyled(chain);
+        gboolean changed = false;
 
-        if(x == *new_val)
-                return;
+        /* remember old values */
+        _edit_begin();
+        undo_record_leds(chain, first, last, UNDO_LED_POS);
 
-        /* set new value */
-        led_set_pos(l, *new_val, y);
+        LedCount i;
+        for(i = first; i <= last; i++)
+        {
+                Led *l = led_chain_get_nth(c, i);
+                LedFrameCord x, y;
+                led_get_pos(l, &x, &y);
+
+                LedFrameCord nx = new_x ? *new_x : x;
+                LedFrameCord ny = new_y ? *new_y : y;
+                if(x == nx && y == ny)
+                        continue;
+
+                /* set new value */
+                led_set_pos(l, nx, ny);
+                spatial_index_update_led(led_get_privdata(l));
+                changed = true;
+        }
+
+        /* damage chain once for the whole range */
+        if(changed)
+                renderer_chain_damage(chain);
+}
 
-        renderer_led_damage(led);
+
+/** foreach helper to set x position of a range of LEDs */
+static void _set_x(NiftyconfChain * chain,
+                   LedCount first, LedCount last, void *u)
+{
+        _set_pos(chain, first, last, u, NULL);
 }
 
 
@@ -122,31 +232,18 @@ G_MODULE_EXPORT void on_spinbutton_led_x_changed(GtkSpinButton * s,
         /* set x on all selected LEDs */
         LedFrameCord new_val =
                 (LedFrameCord) gtk_spin_button_get_value_as_int(s);
-        ui_setup_ledlist_do_foreach_selected_element(_set_x, &new_val);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
+        selection_foreach_range(_current_leds(), _set_x, &new_val);
 
         /* redraw */
-        ui_renderer_all_queue_draw();
+        _edit_schedule();
 }
 
 
-/** foreach helper to set led's y position */
-void _set_y(NiftyconfLed * led, void *u)
+/** foreach helper to set y position of a range of LEDs */
+static void _set_y(NiftyconfChain * chain,
+                   LedCount first, LedCount last, void *u)
 {
-        Led *l = led_niftyled(led);
-        LedFrameCord *new_val = u;
-        LedFrameCord x, y;
-        led_get_pos(led_niftyled(led), &x, &y);
-
-        if(y == *new_val)
-                return;
-
-        /* set new value */
-        led_set_pos(l, x, *new_val);
-
-        renderer_led_damage(led);
+        _set_pos(chain, first, last, NULL, u);
 }
 
 
@@ -157,27 +254,40 @@ G_MODULE_EXPORT void on_spinbutton_led_y_changed(GtkSpinButton * s,
         /* set y on all selected LEDs */
         LedFrameCord new_val =
                 (LedFrameCord) gtk_spin_button_get_value_as_int(s);
-        ui_setup_ledlist_do_foreach_selected_element(_set_y, &new_val);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
+        selection_foreach_range(_current_leds(), _set_y, &new_val);
 
         /* redraw */
-        ui_renderer_all_queue_draw();
+        _edit_schedule();
 }
 
 
-/** foreach helper to set led's component */
-void _set_component(NiftyconfLed * led, void *u)
+/** foreach helper to set component of a range of LEDs */
+static void _set_component(NiftyconfChain * chain,
+                           LedCount first, LedCount last, void *u)
 {
-        Led *l = led_niftyled(led);
+        LedChain *c = chain_niftyled(chain);
         LedFrameComponent *new_val = u;
+        gboolean changed = false;
 
-        if(led_get_component(l) == *new_val)
-                return;
+        /* remember old values */
+        _edit_begin();
+        undo_record_leds(chain, first, last, UNDO_LED_COMPONENT);
 
-        led_set_component(l, *new_val);
-        renderer_led_damage(led);
+        LedCount i;
+        for(i = first; i <= last; i++)
+        {
+                Led *l = led_chain_get_nth(c, i);
+                if(led_get_component(l) == *new_val)
+                        continue;
+
+                led_set_component(l, *new_val);
+                renderer_damage(led_get_renderer(led_get_privdata(l)));
+                changed = true;
+        }
+
+        /* damage chain once for the whole range */
+        if(changed)
+                renderer_chain_damage(chain);
 }
 
 
@@ -189,29 +299,32 @@ G_MODULE_EXPORT void on_spinbutton_led_component_changed(GtkSpinButton * s,
         /* set component on all selected LEDs */
         LedFrameComponent new_val =
                 (LedFrameComponent) gtk_spin_button_get_value_as_int(s);
-        ui_setup_ledlist_do_foreach_selected_element(_set_component,
-                                                     &new_val);
+        selection_foreach_range(_current_leds(), _set_component, &new_val);
 
         /* redraw */
-        ui_renderer_all_queue_draw();
+        _edit_schedule();
 }
 
 
-/** foreach helper to set gain */
-void _set_gain(NiftyconfLed * led, void *u)
+/** foreach helper to set gain of a range of LEDs */
+static void _set_gain(NiftyconfChain * chain,
+                      LedCount first, LedCount last, void *u)
 {
-        /* get currently selected LED */
-        Led *l = led_niftyled(led);
-
-        /* value really changed? */
+        LedChain *c = chain_niftyled(chain);
         LedGain *new_val = u;
-        if(led_get_gain(l) == *new_val)
-                return;
 
-        led_set_gain(l, *new_val);
+        /* remember old values */
+        _edit_begin();
+        undo_record_leds(chain, first, last, UNDO_LED_GAIN);
+
+        LedCount i;
+        for(i = first; i <= last; i++)
+        {
+                led_set_gain(led_chain_get_nth(c, i), *new_val);
+        }
 
-        /* reflect new gain on hardware */
-        live_preview_highlight_led(led);
+        /* reflect new gain on hardware (flushed once by caller) */
+        live_preview_highlight_range(chain, first, last);
 }
 
 
@@ -221,7 +334,15 @@ G_MODULE_EXPORT void on_spinbutton_led_gain_changed(GtkSpinButton * s,
 {
         /* walk all currently selected LEDs */
         LedGain gain = gtk_spin_button_get_value(s);
-        ui_setup_ledlist_do_foreach_selected_element(_set_gain, &gain);
+        selection_foreach_range(_current_leds(), _set_gain, &gain);
+
+        /* LEDs might belong to any hardware */
+        if(current_selection)
+        {
+                _edit.gain_all = true;
+                _edit_schedule();
+                return;
+        }
 
         /* get hardware these LEDs belong to */
         LedHardware *h;
@@ -242,9 +363,8 @@ G_MODULE_EXPORT void on_spinbutton_led_gain_changed(GtkSpinButton * s,
 
 
         /* update gain */
-        led_hardware_refresh_gain(h);
-
-        live_preview_show();
+        g_hash_table_insert(_edit.gain, h, h);
+        _edit_schedule();
 }
 
 
@@ -262,50 +382,31 @@ G_MODULE_EXPORT void on_spinbutton_chain_ledcount_changed(GtkSpinButton * s,
         if(led_chain_get_ledcount(chain) == ledcount)
                 return;
 
+        /* pending edits might refer to LEDs, ledcount is a step of its own */
+        ui_setup_props_commit();
+
         /* remove all current LEDs */
         ui_setup_ledlist_clear();
 
-        /* unregister all LEDs from chain */
-        chain_unregister_leds_from_gui(current_chain);
+        undo_group_begin();
+        undo_record_ledcount(current_chain, ledcount);
 
-        /* is this the chain of a hardware element? */
-        LedHardware *h;
-        if((h = led_chain_get_parent_hardware(chain)))
+        /* set new ledcount */
+        if(!chain_set_ledcount(current_chain, ledcount))
         {
-                /* set new ledcount */
-                if(!led_hardware_set_ledcount(h, ledcount))
-                        /* error background color */
-                {
-                        _widget_set_error_background(GTK_WIDGET(s), true);
-                        return;
-                }
-                /* normal background color */
-                else
-                {
-                        _widget_set_error_background(GTK_WIDGET(s), false);
-                }
+                /* error background color */
+                _widget_set_error_background(GTK_WIDGET(s), true);
+                undo_group_cancel();
         }
-        /* this is an ordinary chain of a tile element */
+        else
         {
-                /* set new ledcount */
-                if(!led_chain_set_ledcount(chain, ledcount))
-                        /* error background color */
-                {
-                        _widget_set_error_background(GTK_WIDGET(s), true);
-                        return;
-                }
                 /* normal background color */
-                else
-                {
-                        _widget_set_error_background(GTK_WIDGET(s), false);
-                }
+                _widget_set_error_background(GTK_WIDGET(s), false);
+                undo_group_end();
         }
 
-        /* re-register (less or more) LEDs in chain */
-        chain_register_leds_to_gui(current_chain);
-
         /* refresh tree */
-        ui_setup_tree_refresh();
+        ui_setup_tree_update_element(LED_CHAIN_T, current_chain);
         ui_setup_ledlist_refresh(current_chain);
 
         /* redraw */
@@ -330,6 +431,10 @@ G_MODULE_EXPORT void on_spinbutton_tile_x_changed(GtkSpinButton * s,
         if(x == new_val)
                 return;
 
+        /* remember old value */
+        _edit_begin();
+        undo_record_tile(current_tile);
+
         /* set new value */
         if(!led_tile_set_pos(tile, new_val, y))
                 /* error background color */
@@ -342,13 +447,8 @@ G_MODULE_EXPORT void on_spinbutton_tile_x_changed(GtkSpinButton * s,
                 _widget_set_error_background(GTK_WIDGET(s), false);
         }
 
-        /* refresh tree */
-        ui_setup_tree_refresh();
-
-        /* redraw */
-        renderer_tile_damage(current_tile);
-        ui_renderer_all_queue_draw();
-
+        /* update LEDs, tree & renderer once per frame */
+        _edit_tile(current_tile, EDIT_TILE_PLACEMENT);
 }
 
 
@@ -368,6 +468,10 @@ G_MODULE_EXPORT void on_spinbutton_tile_y_changed(GtkSpinButton * s,
         if(y == new_val)
                 return;
 
+        /* remember old value */
+        _edit_begin();
+        undo_record_tile(current_tile);
+
         /* set new value */
         if(!led_tile_set_pos(tile, x, new_val))
                 /* error background color */
@@ -380,13 +484,8 @@ G_MODULE_EXPORT void on_spinbutton_tile_y_changed(GtkSpinButton * s,
                 _widget_set_error_background(GTK_WIDGET(s), false);
         }
 
-        /* refresh tree */
-        ui_setup_tree_refresh();
-
-        /* redraw */
-        renderer_tile_damage(current_tile);
-        ui_renderer_all_queue_draw();
-
+        /* update LEDs, tree & renderer once per frame */
+        _edit_tile(current_tile, EDIT_TILE_PLACEMENT);
 }
 
 
@@ -402,6 +501,10 @@ G_MODULE_EXPORT void on_spinbutton_tile_rotation_changed(GtkSpinButton * s,
         if(led_tile_get_rotation(tile) == new_val)
                 return;
 
+        /* remember old value */
+        _edit_begin();
+        undo_record_tile(current_tile);
+
         /* set new value */
         if(!led_tile_set_rotation(tile, new_val))
         {
@@ -414,15 +517,8 @@ G_MODULE_EXPORT void on_spinbutton_tile_rotation_changed(GtkSpinButton * s,
                 _widget_set_error_background(GTK_WIDGET(s), false);
         }
 
-        /* refresh view */
-        ui_setup_props_tile_show(current_tile);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
-
-        /* redraw */
-        renderer_tile_damage(current_tile);
-        ui_renderer_all_queue_draw();
+        /* update LEDs, tree & renderer once per frame */
+        _edit_tile(current_tile, EDIT_TILE_PLACEMENT);
 }
 
 
@@ -442,6 +538,10 @@ G_MODULE_EXPORT void on_spinbutton_tile_pivot_x_changed(GtkSpinButton * s,
         if(x == new_val)
                 return;
 
+        /* remember old value */
+        _edit_begin();
+        undo_record_tile(current_tile);
+
         /* set new value */
         if(!led_tile_set_pivot(tile, new_val, y))
                 /* error background color */
@@ -454,15 +554,8 @@ G_MODULE_EXPORT void on_spinbutton_tile_pivot_x_changed(GtkSpinButton * s,
                 _widget_set_error_background(GTK_WIDGET(s), false);
         }
 
-        /* refresh view */
-        ui_setup_props_tile_show(current_tile);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
-
-        /* redraw */
-        renderer_tile_damage(current_tile);
-        ui_renderer_all_queue_draw();
+        /* update LEDs, tree & renderer once per frame */
+        _edit_tile(current_tile, EDIT_TILE_CONTENT);
 }
 
 
@@ -482,6 +575,10 @@ G_MODULE_EXPORT void on_spinbutton_tile_pivot_y_changed(GtkSpinButton * s,
         if(y == new_val)
                 return;
 
+        /* remember old value */
+        _edit_begin();
+        undo_record_tile(current_tile);
+
         /* set new value */
         if(!led_tile_set_pivot(tile, x, new_val))
                 /* error background color */
@@ -494,15 +591,8 @@ G_MODULE_EXPORT void on_spinbutton_tile_pivot_y_changed(GtkSpinButton * s,
                 _widget_set_error_background(GTK_WIDGET(s), false);
         }
 
-        /* refresh view */
-        ui_setup_props_tile_show(current_tile);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
-
-        /* redraw */
-        renderer_tile_damage(current_tile);
-        ui_renderer_all_queue_draw();
+        /* update LEDs, tree & renderer once per frame */
+        _edit_tile(current_tile, EDIT_TILE_CONTENT);
 }
 
 
@@ -526,7 +616,7 @@ G_MODULE_EXPORT void on_entry_hardware_name_changed(GtkEditable * e,
         }
 
         /* refresh view */
-        ui_setup_tree_refresh();
+        ui_setup_tree_update_element(LED_HARDWARE_T, current_hw);
 
 }
 
@@ -789,6 +879,8 @@ GtkWidget *ui_setup_props_get_widget()
 /** show hardware props */
 void ui_setup_props_hardware_show(NiftyconfHardware * h)
 {
+        ui_setup_props_commit();
+
         current_hw = h;
 
         gtk_widget_show(GTK_WIDGET(UI("frame_hardware")));
@@ -860,9 +952,18 @@ void ui_setup_props_hardware_show(NiftyconfHardware * h)
 }
 
 
+/** set spinbutton without triggering its handler (showing isn't editing) */
+#define SPIN_SET(a,b,c) \
+	g_signal_handlers_block_by_func(GTK_SPIN_BUTTON(UI(a)), c, NULL); \
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(UI(a)), b); \
+	g_signal_handlers_unblock_by_func(GTK_SPIN_BUTTON(UI(a)), c, NULL);
+
+
 /** show tile props */
 void ui_setup_props_tile_show(NiftyconfTile * t)
 {
+        ui_setup_props_commit();
+
         current_tile = t;
 
         if(t)
@@ -871,12 +972,10 @@ void ui_setup_props_tile_show(NiftyconfTile * t)
                 LedTile *tile = tile_niftyled(t);
                 LedFrameCord x, y;
                 led_tile_get_pos(tile, &x, &y);
-                gtk_spin_button_set_value(GTK_SPIN_BUTTON
-                                          (UI("spinbutton_tile_x")),
-                                          (gdouble) x);
-                gtk_spin_button_set_value(GTK_SPIN_BUTTON
-                                          (UI("spinbutton_tile_y")),
-                                          (gdouble) y);
+                SPIN_SET("spinbutton_tile_x", (gdouble) x,
+                         on_spinbutton_tile_x_changed);
+                SPIN_SET("spinbutton_tile_y", (gdouble) y,
+                         on_spinbutton_tile_y_changed);
 
                 /* dimension */
                 LedFrameCord w, h;
@@ -891,17 +990,13 @@ void ui_setup_props_tile_show(NiftyconfTile * t)
                 /* transformation */
                 double pX, pY;
                 led_tile_get_pivot(tile, &pX, &pY);
-                gtk_spin_button_set_value(GTK_SPIN_BUTTON
-                                          (UI("spinbutton_tile_rotation")),
-                                          (gdouble)
-                                          led_tile_get_rotation(tile) * 180 /
-                                          M_PI);
-                gtk_spin_button_set_value(GTK_SPIN_BUTTON
-                                          (UI("spinbutton_tile_pivot_x")),
-                                          (gdouble) pX);
-                gtk_spin_button_set_value(GTK_SPIN_BUTTON
-                                          (UI("spinbutton_tile_pivot_y")),
-                                          (gdouble) pY);
+                SPIN_SET("spinbutton_tile_rotation",
+                         (gdouble) led_tile_get_rotation(tile) * 180 / M_PI,
+                         on_spinbutton_tile_rotation_changed);
+                SPIN_SET("spinbutton_tile_pivot_x", (gdouble) pX,
+                         on_spinbutton_tile_pivot_x_changed);
+                SPIN_SET("spinbutton_tile_pivot_y", (gdouble) pY,
+                         on_spinbutton_tile_pivot_y_changed);
         }
 
         gtk_widget_show(GTK_WIDGET(UI("frame_tile")));
@@ -911,6 +1006,8 @@ void ui_setup_props_tile_show(NiftyconfTile * t)
 /** show chain props */
 void ui_setup_props_chain_show(NiftyconfChain * c)
 {
+        ui_setup_props_commit();
+
         current_chain = c;
 
         if(c)
@@ -939,12 +1036,10 @@ void ui_setup_props_chain_show(NiftyconfChain * c)
 /** show led props */
 void ui_setup_props_led_show(NiftyconfLed * l)
 {
-        current_led = l;
+        ui_setup_props_commit();
 
-#define SPIN_SET(a,b,c) \
-	g_signal_handlers_block_by_func(GTK_SPIN_BUTTON(UI(a)), c, NULL); \
-	gtk_spin_button_set_value(GTK_SPIN_BUTTON(UI(a)), b); \
-	g_signal_handlers_unblock_by_func(GTK_SPIN_BUTTON(UI(a)), c, NULL);
+        current_led = l;
+        current_selection = NULL;
 
         if(l)
         {
@@ -969,9 +1064,19 @@ void ui_setup_props_led_show(NiftyconfLed * l)
 }
 
 
+/** show led props for LEDs selected in renderer */
+void ui_setup_props_selection_show(NiftyconfSelection * s)
+{
+        ui_setup_props_led_show(selection_get_any(s));
+        current_selection = s;
+}
+
+
 /** hide all props */
 void ui_setup_props_hide()
 {
+        ui_setup_props_commit();
+
         gtk_widget_hide(GTK_WIDGET(UI("frame_hardware")));
         gtk_widget_hide(GTK_WIDGET(UI("frame_tile")));
         gtk_widget_hide(GTK_WIDGET(UI("frame_chain")));
@@ -979,6 +1084,101 @@ void ui_setup_props_hide()
 }
 
 
+/** re-read values of shown elements (e.g. after undo) */
+void ui_setup_props_refresh()
+{
+        ui_setup_props_commit();
+
+        if(current_tile &&
+           gtk_widget_get_visible(GTK_WIDGET(UI("frame_tile"))))
+                ui_setup_props_tile_show(current_tile);
+
+        if(current_led &&
+           gtk_widget_get_visible(GTK_WIDGET(UI("frame_led"))))
+        {
+                /* keep LEDs selected in renderer */
+                NiftyconfSelection *s = current_selection;
+                ui_setup_props_led_show(current_led);
+                current_selection = s;
+        }
+}
+
+
+/** apply side effects of all pending property edits */
+void ui_setup_props_commit()
+{
+        /* edits since last commit are one undo step */
+        if(_edit.recording)
+        {
+                _edit.recording = false;
+                undo_group_end();
+        }
+
+        if(!_edit.pending)
+                return;
+
+        _edit.pending = false;
+
+        if(_edit.source)
+        {
+                g_source_remove(_edit.source);
+                _edit.source = 0;
+        }
+
+        /* tiles that were moved, rotated, ... */
+        gboolean current_tile_changed = false;
+        GHashTableIter it;
+        gpointer t, what;
+        g_hash_table_iter_init(&it, _edit.tiles);
+        while(g_hash_table_iter_next(&it, &t, &what))
+        {
+                /* update position of all LEDs in tile */
+                spatial_index_update_tile(t);
+
+                /* refresh tree */
+                ui_setup_tree_update_element(LED_TILE_T, t);
+
+                /* re-render tile only if its content changed */
+                if(GPOINTER_TO_INT(what) & EDIT_TILE_CONTENT)
+                        renderer_tile_damage(t);
+                else
+                        renderer_tile_damage_placement(t);
+
+                if(t == current_tile)
+                        current_tile_changed = true;
+        }
+        g_hash_table_remove_all(_edit.tiles);
+
+        /* transformed dimensions might have changed */
+        if(current_tile_changed)
+                ui_setup_props_tile_show(current_tile);
+
+        /* refresh gain of hardware */
+        gboolean preview = _edit.gain_all ||
+                g_hash_table_size(_edit.gain) > 0;
+        if(_edit.gain_all)
+        {
+                led_hardware_list_refresh_gain(led_setup_get_hardware
+                                               (setup_get_current()));
+        }
+        else
+        {
+                gpointer h;
+                g_hash_table_iter_init(&it, _edit.gain);
+                while(g_hash_table_iter_next(&it, &h, NULL))
+                        led_hardware_refresh_gain(h);
+        }
+        g_hash_table_remove_all(_edit.gain);
+        _edit.gain_all = false;
+
+        if(preview)
+                live_preview_show();
+
+        /* redraw */
+        ui_renderer_all_queue_draw();
+}
+
+
 /** initialize this module */
 gboolean ui_setup_props_init()
 {
@@ -996,6 +1196,10 @@ gboolean ui_setup_props_init()
                                  (UI("adjustment_hw_prop_float")),
                                  (gdouble) (FLT_MAX));
 
+        /* pending edits */
+        _edit.tiles = g_hash_table_new(g_direct_hash, g_direct_equal);
+        _edit.gain = g_hash_table_new(g_direct_hash, g_direct_equal);
+
         return true;
 }
 
@@ -1003,6 +1207,10 @@ gboolean ui_setup_props_init()
 /** deinitialize this module */
 void ui_setup_props_deinit()
 {
+        ui_setup_props_commit();
+        g_hash_table_destroy(_edit.gain);
+        g_hash_table_destroy(_edit.tiles);
+
         g_object_unref(_builder);
 }
 
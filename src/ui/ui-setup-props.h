@@ -48,6 +48,7 @@
 #include "elements/element-tile.h"
 #include "elements/element-chain.h"
 #include "elements/element-led.h"
+#include "selection/selection.h"
 
 
 /* GUI model functions */
@@ -61,9 +62,12 @@ void                            ui_setup_props_hardware_show(NiftyconfHardware *
 void                            ui_setup_props_tile_show(NiftyconfTile * t);
 void                            ui_setup_props_chain_show(NiftyconfChain * c);
 void                            ui_setup_props_led_show(NiftyconfLed * l);
+void                            ui_setup_props_selection_show(NiftyconfSelection * s);
 void                            ui_setup_props_hide();
 
 /* model functions */
+void                            ui_setup_props_commit();
+void                            ui_setup_props_refresh();
 
 
 
@@ -0,0 +1,318 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <niftyled.h>
+#include <gtk/gtk.h>
+#include "ui/ui-log.h"
+#include "ui/ui-setup-save.h"
+#include "niftyconf.h"
+
+
+
+/** a snapshot waiting to be written */
+typedef struct
+{
+        /** snapshot of element(s) to save */
+        LedPrefsNode *node;
+        /** file to replace */
+        gchar *filename;
+        /** permissions of new file */
+        mode_t mode;
+        /** save without defaults */
+        gboolean minimal;
+        /** reason of failure (or NULL) */
+        gchar *error;
+        /** called after file was replaced (or NULL) */
+        void (*finished) (const char *filename, gpointer u);
+        gpointer u;
+} SaveJob;
+
+
+/** saves are written one after another by a single worker */
+static GThreadPool *_pool;
+/** jobs written by worker, waiting to be reported by main thread */
+static GAsyncQueue *_done;
+
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** free a save job */
+static void _job_free(SaveJob * j)
+{
+        if(j->node)
+                led_prefs_node_free(j->node);
+        g_free(j->error);
+        g_free(j->filename);
+        g_slice_free(SaveJob, j);
+}
+
+
+/** report result of a save (main thread) */
+static void _job_finish(SaveJob * j)
+{
+        if(j->error)
+                ui_log_alert_show("%s", j->error);
+        else
+        {
+                NFT_LOG(L_INFO, "Saved \"%s\"", j->filename);
+
+                if(j->finished)
+                        j->finished(j->filename, j->u);
+        }
+
+        _job_free(j);
+}
+
+
+/** report result of next finished save */
+static gboolean _save_finished(gpointer u)
+{
+        SaveJob *j;
+        if(_done && (j = g_async_queue_try_pop(_done)))
+                _job_finish(j);
+
+        return false;
+}
+
+
+/** write buffer to temporary file next to filename, then replace file */
+static gboolean _write_atomic(SaveJob * j, const char *buf)
+{
+        gchar *tmp = g_strdup_printf("%s.XXXXXX", j->filename);
+
+        int fd;
+        if((fd = g_mkstemp(tmp)) == -1)
+        {
+                j->error = g_strdup_printf("Failed to create \"%s\" - %s",
+                                           tmp, strerror(errno));
+                g_free(tmp);
+                return false;
+        }
+
+        size_t length = strlen(buf);
+        size_t pos = 0;
+        while(pos < length)
+        {
+                ssize_t w = write(fd, buf + pos, length - pos);
+                if(w == -1)
+                {
+                        if(errno == EINTR)
+                                continue;
+                        goto _wa_error;
+                }
+                pos += w;
+        }
+
+        /* make sure data is on disk before it replaces the old file */
+        if(fchmod(fd, j->mode) == -1 || fsync(fd) == -1)
+                goto _wa_error;
+
+        if(close(fd) == -1)
+        {
+                fd = -1;
+                goto _wa_error;
+        }
+        fd = -1;
+
+        if(rename(tmp, j->filename) == -1)
+                goto _wa_error;
+
+        g_free(tmp);
+        return true;
+
+_wa_error:
+        j->error = g_strdup_printf("Failed to save \"%s\" - %s",
+                                   j->filename, strerror(errno));
+        if(fd != -1)
+                close(fd);
+        unlink(tmp);
+        g_free(tmp);
+        return false;
+}
+
+
+/** serialize & write snapshot (worker thread) */
+static void _save_thread(gpointer data, gpointer u)
+{
+        SaveJob *j = data;
+
+        /* own prefs context, the main thread keeps using its own */
+        LedPrefs *p;
+        if(!(p = led_prefs_init()))
+        {
+                j->error = g_strdup("Failed to initialize preferences");
+                goto _st_exit;
+        }
+
+        char *buf;
+        if(!(buf = j->minimal ?
+             led_prefs_node_to_buffer_minimal(p, j->node) :
+             led_prefs_node_to_buffer(p, j->node)))
+        {
+                j->error = g_strdup_printf("Failed to serialize \"%s\"",
+                                           j->filename);
+                goto _st_deinit;
+        }
+
+        _write_atomic(j, buf);
+        free(buf);
+
+_st_deinit:
+        led_prefs_node_free(j->node);
+        j->node = NULL;
+        led_prefs_deinit(p);
+_st_exit:
+        g_async_queue_push(_done, j);
+        g_idle_add(_save_finished, NULL);
+}
+
+
+
+/******************************************************************************
+ ****************************** PUBLIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** wait for pending saves */
+void ui_setup_save_deinit()
+{
+        if(!_pool)
+                return;
+
+        g_thread_pool_free(_pool, false, true);
+        _pool = NULL;
+
+        /* main loop doesn't run anymore, report pending results now */
+        SaveJob *j;
+        while((j = g_async_queue_try_pop(_done)))
+                _job_finish(j);
+        g_async_queue_unref(_done);
+        _done = NULL;
+}
+
+
+/**
+ * save snapshot to file in background, the file is replaced atomically
+ * once everything is written (takes ownership of n). finished is called
+ * on the main thread after a successful save.
+ */
+NftResult ui_setup_save_node(LedPrefsNode * n, const char *filename,
+                             gboolean minimal,
+                             void (*finished) (const char *filename,
+                                               gpointer u), gpointer u)
+{
+        if(!n || !filename)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        /* new files get default permissions */
+        mode_t mode = niftyconf_file_mode();
+
+        /* file existing? */
+        struct stat sts;
+        if(stat(filename, &sts) == -1)
+        {
+                /* continue if stat error was caused because file doesn't exist 
+                 */
+                if(errno != ENOENT)
+                {
+                        ui_log_alert_show("Failed to access \"%s\" - %s",
+                                          filename, strerror(errno));
+                        goto _ssn_error;
+                }
+        }
+        /* stat succeeded, file exists */
+        else
+        {
+                /* replace old file? */
+                if(!ui_log_dialog_yesno
+                   ("Overwrite",
+                    "A file named \"%s\" already exists.\nOverwrite?",
+                    filename))
+                        goto _ssn_error;
+
+                /* keep permissions of old file */
+                mode = sts.st_mode & 07777;
+        }
+
+        if(!_pool)
+        {
+                if(!_done)
+                        _done = g_async_queue_new();
+
+                GError *err = NULL;
+                if(!(_pool = g_thread_pool_new(_save_thread, NULL, 1,
+                                               false, &err)))
+                {
+                        ui_log_alert_show("Failed to start saving - %s",
+                                          err->message);
+                        g_error_free(err);
+                        goto _ssn_error;
+                }
+        }
+
+        SaveJob *j = g_slice_new0(SaveJob);
+        j->node = n;
+        j->filename = g_strdup(filename);
+        j->mode = mode;
+        j->minimal = minimal;
+        j->finished = finished;
+        j->u = u;
+
+        g_thread_pool_push(_pool, j, NULL);
+
+        return NFT_SUCCESS;
+
+_ssn_error:
+        led_prefs_node_free(n);
+        return NFT_FAILURE;
+}
@@ -59,6 +59,7 @@
 #include "renderer/renderer-tile.h"
 #include "renderer/renderer-chain.h"
 #include "prefs/prefs.h"
+#include "validator/validator.h"
 
 
 /** @todo improve design - i hate this */
@@ -87,6 +88,8 @@ static NIFTYLED_TYPE _current_type;
 static NiftyconfHardware *_current_hw;
 static NiftyconfTile *_current_tile;
 static NiftyconfChain *_current_chain;
+/** elements of current selection: element -> NIFTYLED_TYPE */
+static GHashTable *_selected;
 /** narf! */
 static bool _clear_in_progress;
 
@@ -134,101 +137,500 @@ static NftResult _this_to_prefs(NftPrefs * prefs,
 }
 
 
-/** helper to append element to treeview */
-static void _tree_append_chain(GtkTreeStore * s,
-                               LedChain * c, GtkTreeIter * parent)
+/** create title of a chain row */
+static void _title_chain(NiftyconfChain * chain, char *title, size_t size)
 {
-        NiftyconfChain *chain = led_chain_get_privdata(c);
+        LedChain *c = chain_niftyled(chain);
 
-        /* don't add an element that's not registered */
-        if(!chain)
-                return;
+        guint problems;
+        if((problems = validator_chain_problems(chain)))
+                snprintf(title, size, "%ld LED chain (%u invalid)",
+                         led_chain_get_ledcount(c), problems);
+        else
+                snprintf(title, size, "%ld LED chain",
+                         led_chain_get_ledcount(c));
+}
 
-        /* create name */
-        char title[64];
-        snprintf(title, sizeof(title), "%ld LED chain",
-                 led_chain_get_ledcount(c));
 
-        GtkTreeIter i;
-        gtk_tree_store_append(s, &i, parent);
-        gtk_tree_store_set(s, &i,
-                           C_SETUP_TYPE, LED_CHAIN_T,
-                           C_SETUP_TITLE, title, C_SETUP_ELEMENT,
-                           (gpointer) chain, -1);
+/** create title of a tile row */
+static void _title_tile(NiftyconfTile * tile, char *title, size_t size)
+{
+        /* get dimensions */
+        LedFrameCord w, h;
+        led_tile_get_dim(tile_niftyled(tile), &w, &h);
+
+        guint problems;
+        if((problems = validator_tile_problems(tile)))
+                snprintf(title, size, "%dx%d tile (%u invalid)", w, h,
+                         problems);
+        else
+                snprintf(title, size, "%dx%d tile", w, h);
 }
 
 
-/** helper to append element to treeview */
-static void _tree_append_tile(GtkTreeStore * s,
-                              LedTile * t, GtkTreeIter * parent)
+/** create title of any row */
+static void _title(NIFTYLED_TYPE t, gpointer element, char *title,
+                   size_t size)
 {
-        NiftyconfTile *tile = led_tile_get_privdata(t);
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        const char *name =
+                                led_hardware_get_name(hardware_niftyled
+                                                      ((NiftyconfHardware *)
+                                                       element));
+                        g_strlcpy(title, name ? name : "", size);
+                        break;
+                }
 
-        /* don't add an element that's not registered */
-        if(!tile)
-                return;
+                case LED_TILE_T:
+                {
+                        _title_tile((NiftyconfTile *) element, title, size);
+                        break;
+                }
 
-        /* get dimensions */
-        LedFrameCord w, h;
-        led_tile_get_dim(t, &w, &h);
+                case LED_CHAIN_T:
+                {
+                        _title_chain((NiftyconfChain *) element, title, size);
+                        break;
+                }
 
-        /* create name */
-        char title[64];
-        snprintf(title, sizeof(title), "%dx%d tile", w, h);
+                default:
+                {
+                        title[0] = '\0';
+                        break;
+                }
+        }
+}
 
-        GtkTreeIter i;
-        gtk_tree_store_append(s, &i, parent);
-        gtk_tree_store_set(s, &i,
-                           C_SETUP_TYPE, LED_TILE_T,
-                           C_SETUP_TITLE, title, C_SETUP_ELEMENT,
-                           (gpointer) tile, -1);
-
-        /* append chain if there is one */
-        LedChain *c;
-        if((c = led_tile_get_chain(t)))
+
+/******************************************************************************
+ ***************************** TREE MODEL *************************************
+ ******************************************************************************/
+
+/**
+ * GtkTreeModel that exposes the hardware/tile/chain graph of the current
+ * setup directly. An iter holds the element (user_data) and its
+ * NIFTYLED_TYPE (user_data2), titles are generated on demand.
+ */
+typedef struct
+{
+        GObject parent;
+        /** stamp of iters that belong to this model */
+        gint stamp;
+} SetupTreeModel;
+
+typedef struct
+{
+        GObjectClass parent_class;
+} SetupTreeModelClass;
+
+
+static void _model_iface_init(GtkTreeModelIface * iface);
+
+G_DEFINE_TYPE_WITH_CODE(SetupTreeModel, setup_tree_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL,
+                                              _model_iface_init));
+
+
+/** the model of our treeview */
+static SetupTreeModel *_model;
+
+
+/** fill iter with element */
+static gboolean _iter_set(GtkTreeIter * iter, NIFTYLED_TYPE t, gpointer e)
+{
+        if(!e)
+                return false;
+
+        iter->stamp = _model->stamp;
+        iter->user_data = e;
+        iter->user_data2 = GINT_TO_POINTER(t);
+        iter->user_data3 = NULL;
+
+        return true;
+}
+
+
+/** fill iter with first registered tile of list */
+static gboolean _iter_set_tile(GtkTreeIter * iter, LedTile * t)
+{
+        for(; t; t = led_tile_list_get_next(t))
         {
-                _tree_append_chain(s, c, &i);
+                if(led_tile_get_privdata(t))
+                        return _iter_set(iter, LED_TILE_T,
+                                         led_tile_get_privdata(t));
         }
 
-        /* append children of this tile */
-        LedTile *child;
-        for(child = led_tile_get_child(t);
-            child; child = led_tile_list_get_next(child))
+        return false;
+}
+
+
+/** fill iter with first registered hardware of list */
+static gboolean _iter_set_hardware(GtkTreeIter * iter, LedHardware * h)
+{
+        for(; h; h = led_hardware_list_get_next(h))
         {
-                _tree_append_tile(s, child, &i);
+                if(led_hardware_get_privdata(h))
+                        return _iter_set(iter, LED_HARDWARE_T,
+                                         led_hardware_get_privdata(h));
         }
 
+        return false;
+}
+
+
+/** fill iter with registered chain */
+static gboolean _iter_set_chain(GtkTreeIter * iter, LedChain * c)
+{
+        if(!c)
+                return false;
+
+        return _iter_set(iter, LED_CHAIN_T, led_chain_get_privdata(c));
 }
 
 
-/** helper to append element to treeview */
-static void _tree_append_hardware(GtkTreeStore * s, LedHardware * h)
+/** whether iter is the row of element or one of its children */
+static gboolean _iter_is_below(GtkTreeIter * iter, gpointer element)
 {
-        NiftyconfHardware *hardware = led_hardware_get_privdata(h);
+        GtkTreeIter i = *iter, parent;
+        while(i.user_data != element)
+        {
+                if(!gtk_tree_model_iter_parent
+                   (GTK_TREE_MODEL(_model), &parent, &i))
+                        return false;
 
-        /* don't add an element that's not registered */
-        if(!hardware)
-                return;
+                i = parent;
+        }
 
-        GtkTreeIter i;
-        gtk_tree_store_append(s, &i, NULL);
-        gtk_tree_store_set(s, &i,
-                           C_SETUP_TYPE, LED_HARDWARE_T,
-                           C_SETUP_TITLE, led_hardware_get_name(h),
-                           C_SETUP_ELEMENT, (gpointer) hardware, -1);
-
-                /** append chain */
-        _tree_append_chain(s, led_hardware_get_chain(h), &i);
-
-                /** append all tiles */
-        LedTile *t;
-        for(t = led_hardware_get_tile(h); t; t = led_tile_list_get_next(t))
+        return true;
+}
+
+
+static GtkTreeModelFlags _model_get_flags(GtkTreeModel * m)
+{
+        /* iters are valid as long as their element exists */
+        return GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+
+static gint _model_get_n_columns(GtkTreeModel * m)
+{
+        return NUM_SETUP_COLS;
+}
+
+
+static GType _model_get_column_type(GtkTreeModel * m, gint column)
+{
+        switch (column)
+        {
+                case C_SETUP_TYPE:
+                        return G_TYPE_INT;
+                case C_SETUP_TITLE:
+                        return G_TYPE_STRING;
+                case C_SETUP_ELEMENT:
+                        return G_TYPE_POINTER;
+                default:
+                        return G_TYPE_INVALID;
+        }
+}
+
+
+static gboolean _model_iter_children(GtkTreeModel * m,
+                                     GtkTreeIter * iter, GtkTreeIter * parent)
+{
+        /* top level: all hardware of setup */
+        if(!parent)
+        {
+                if(!setup_get_current())
+                        return false;
+
+                return _iter_set_hardware(iter,
+                                          led_setup_get_hardware
+                                          (setup_get_current()));
+        }
+
+        switch (GPOINTER_TO_INT(parent->user_data2))
+        {
+                /* hardware: chain of hardware, then tiles */
+                case LED_HARDWARE_T:
+                {
+                        LedHardware *h = hardware_niftyled(parent->user_data);
+                        if(_iter_set_chain(iter, led_hardware_get_chain(h)))
+                                return true;
+
+                        return _iter_set_tile(iter, led_hardware_get_tile(h));
+                }
+
+                /* tile: chain of tile, then child tiles */
+                case LED_TILE_T:
+                {
+                        LedTile *t = tile_niftyled(parent->user_data);
+                        if(_iter_set_chain(iter, led_tile_get_chain(t)))
+                                return true;
+
+                        return _iter_set_tile(iter, led_tile_get_child(t));
+                }
+
+                default:
+                        return false;
+        }
+}
+
+
+static gboolean _model_iter_next(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        switch (GPOINTER_TO_INT(iter->user_data2))
+        {
+                case LED_HARDWARE_T:
+                {
+                        LedHardware *h = hardware_niftyled(iter->user_data);
+                        return _iter_set_hardware(iter,
+                                                  led_hardware_list_get_next
+                                                  (h));
+                }
+
+                case LED_TILE_T:
+                {
+                        LedTile *t = tile_niftyled(iter->user_data);
+                        return _iter_set_tile(iter,
+                                              led_tile_list_get_next(t));
+                }
+
+                /* chain is followed by the tiles of its parent */
+                case LED_CHAIN_T:
+                {
+                        LedChain *c = chain_niftyled(iter->user_data);
+                        LedTile *t;
+                        if((t = led_chain_get_parent_tile(c)))
+                                return _iter_set_tile(iter,
+                                                      led_tile_get_child(t));
+
+                        LedHardware *h;
+                        if((h = led_chain_get_parent_hardware(c)))
+                                return _iter_set_tile(iter,
+                                                      led_hardware_get_tile
+                                                      (h));
+
+                        return false;
+                }
+
+                default:
+                        return false;
+        }
+}
+
+
+static gboolean _model_iter_parent(GtkTreeModel * m,
+                                   GtkTreeIter * iter, GtkTreeIter * child)
+{
+        switch (GPOINTER_TO_INT(child->user_data2))
+        {
+                case LED_TILE_T:
+                {
+                        LedTile *t = tile_niftyled(child->user_data);
+                        LedTile *pt;
+                        if((pt = led_tile_get_parent_tile(t)))
+                                return _iter_set(iter, LED_TILE_T,
+                                                 led_tile_get_privdata(pt));
+
+                        LedHardware *h;
+                        if((h = led_tile_get_parent_hardware(t)))
+                                return _iter_set(iter, LED_HARDWARE_T,
+                                                 led_hardware_get_privdata
+                                                 (h));
+                        return false;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedChain *c = chain_niftyled(child->user_data);
+                        LedTile *t;
+                        if((t = led_chain_get_parent_tile(c)))
+                                return _iter_set(iter, LED_TILE_T,
+                                                 led_tile_get_privdata(t));
+
+                        LedHardware *h;
+                        if((h = led_chain_get_parent_hardware(c)))
+                                return _iter_set(iter, LED_HARDWARE_T,
+                                                 led_hardware_get_privdata
+                                                 (h));
+                        return false;
+                }
+
+                default:
+                        return false;
+        }
+}
+
+
+static gboolean _model_iter_has_child(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        GtkTreeIter c;
+        return _model_iter_children(m, &c, iter);
+}
+
+
+static gint _model_iter_n_children(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        gint n = 0;
+
+        GtkTreeIter c;
+        if(!_model_iter_children(m, &c, iter))
+                return 0;
+
+        do
+        {
+                n++;
+        }
+        while(_model_iter_next(m, &c));
+
+        return n;
+}
+
+
+static gboolean _model_iter_nth_child(GtkTreeModel * m,
+                                      GtkTreeIter * iter,
+                                      GtkTreeIter * parent, gint n)
+{
+        if(!_model_iter_children(m, iter, parent))
+                return false;
+
+        for(; n > 0; n--)
+        {
+                if(!_model_iter_next(m, iter))
+                        return false;
+        }
+
+        return true;
+}
+
+
+static gboolean _model_get_iter(GtkTreeModel * m,
+                                GtkTreeIter * iter, GtkTreePath * path)
+{
+        gint depth = gtk_tree_path_get_depth(path);
+        gint *indices = gtk_tree_path_get_indices(path);
+
+        GtkTreeIter parent;
+        gint i;
+        for(i = 0; i < depth; i++)
         {
-                _tree_append_tile(s, t, &i);
+                if(!_model_iter_nth_child(m, iter, i ? &parent : NULL,
+                                          indices[i]))
+                        return false;
+
+                parent = *iter;
+        }
+
+        return (depth > 0);
+}
+
+
+static GtkTreePath *_model_get_path(GtkTreeModel * m, GtkTreeIter * iter)
+{
+        GtkTreePath *path = gtk_tree_path_new();
+
+        GtkTreeIter i = *iter;
+        while(true)
+        {
+                /* position among siblings */
+                GtkTreeIter p, s;
+                gboolean has_parent = _model_iter_parent(m, &p, &i);
+                gint index = 0;
+                if(_model_iter_children(m, &s, has_parent ? &p : NULL))
+                {
+                        while(s.user_data != i.user_data &&
+                              _model_iter_next(m, &s))
+                                index++;
+                }
+
+                gtk_tree_path_prepend_index(path, index);
+
+                if(!has_parent)
+                        break;
+
+                i = p;
+        }
+
+        return path;
+}
+
+
+static void _model_get_value(GtkTreeModel * m,
+                             GtkTreeIter * iter, gint column, GValue * value)
+{
+        NIFTYLED_TYPE t = GPOINTER_TO_INT(iter->user_data2);
+
+        switch (column)
+        {
+                case C_SETUP_TYPE:
+                {
+                        g_value_init(value, G_TYPE_INT);
+                        g_value_set_int(value, t);
+                        break;
+                }
+
+                case C_SETUP_TITLE:
+                {
+                        char title[256];
+                        _title(t, iter->user_data, title, sizeof(title));
+
+                        g_value_init(value, G_TYPE_STRING);
+                        g_value_set_string(value, title);
+                        break;
+                }
+
+                case C_SETUP_ELEMENT:
+                {
+                        g_value_init(value, G_TYPE_POINTER);
+                        g_value_set_pointer(value, iter->user_data);
+                        break;
+                }
         }
 }
 
 
+static void _model_iface_init(GtkTreeModelIface * iface)
+{
+        iface->get_flags = _model_get_flags;
+        iface->get_n_columns = _model_get_n_columns;
+        iface->get_column_type = _model_get_column_type;
+        iface->get_iter = _model_get_iter;
+        iface->get_path = _model_get_path;
+        iface->get_value = _model_get_value;
+        iface->iter_next = _model_iter_next;
+        iface->iter_children = _model_iter_children;
+        iface->iter_has_child = _model_iter_has_child;
+        iface->iter_n_children = _model_iter_n_children;
+        iface->iter_nth_child = _model_iter_nth_child;
+        iface->iter_parent = _model_iter_parent;
+}
+
+
+static void setup_tree_model_init(SetupTreeModel * m)
+{
+        m->stamp = g_random_int();
+}
+
+
+static void setup_tree_model_class_init(SetupTreeModelClass * c)
+{
+}
+
+
+/** get path of element's row (NULL if element is not in tree) */
+static GtkTreePath *_element_path(NIFTYLED_TYPE t, gpointer element)
+{
+        GtkTreeIter iter;
+        if(!_iter_set(&iter, t, element))
+                return NULL;
+
+        return _model_get_path(GTK_TREE_MODEL(_model), &iter);
+}
+
+
 /** either collapse or expand a row of the setup-tree */
 static gboolean _foreach_element_refresh_collapse(GtkTreeModel * model,
                                                   GtkTreePath * path,
@@ -334,6 +736,33 @@ static gboolean _foreach_element_refresh_highlight(GtkTreeModel * model,
 }
 
 
+/** restore collapse- & selection-state of a row and its visible children */
+static void _tree_refresh_state(GtkTreeModel * m,
+                                GtkTreeIter * i, GtkTreePath * path)
+{
+        _foreach_element_refresh_collapse(m, path, i, NULL);
+        _foreach_element_refresh_highlight(m, path, i, NULL);
+
+        /* rows of collapsed parents aren't displayed */
+        if(!gtk_tree_view_row_expanded(GTK_TREE_VIEW(UI("treeview")), path))
+                return;
+
+        GtkTreeIter c;
+        if(!gtk_tree_model_iter_children(m, &c, i))
+                return;
+
+        GtkTreePath *cpath = gtk_tree_path_copy(path);
+        gtk_tree_path_down(cpath);
+        do
+        {
+                _tree_refresh_state(m, &c, cpath);
+                gtk_tree_path_next(cpath);
+        }
+        while(gtk_tree_model_iter_next(m, &c));
+        gtk_tree_path_free(cpath);
+}
+
+
 /** foreach: function to process an element that is currently selected */
 static void _foreach_element_selected(NIFTYLED_TYPE t, gpointer e)
 {
@@ -546,6 +975,90 @@ static void _foreach_highlight_element(NIFTYLED_TYPE t, gpointer e)
 }
 
 
+/** damage renderer of an element */
+static void _element_damage(NIFTYLED_TYPE t, gpointer e)
+{
+        switch (t)
+        {
+                case LED_TILE_T:
+                {
+                        renderer_tile_damage((NiftyconfTile *) e);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        renderer_chain_damage((NiftyconfChain *) e);
+                        break;
+                }
+
+                default:
+                {
+                        break;
+                }
+        }
+}
+
+
+/** clear live preview of an element */
+static void _live_preview_unhighlight(NIFTYLED_TYPE t, gpointer e)
+{
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        live_preview_unhighlight_hardware((NiftyconfHardware
+                                                           *) e);
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        live_preview_unhighlight_tile((NiftyconfTile *) e);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        live_preview_unhighlight_chain((NiftyconfChain *) e);
+                        break;
+                }
+
+                default:
+                {
+                        break;
+                }
+        }
+}
+
+
+/** collect elements of all selected rows: element -> NIFTYLED_TYPE */
+static GHashTable *_selection_snapshot(GtkTreeSelection * selection)
+{
+        GHashTable *result = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+        GList *selected;
+        GtkTreeModel *m;
+        if(!(selected = gtk_tree_selection_get_selected_rows(selection, &m)))
+                return result;
+
+        GList *cur;
+        for(cur = selected; cur; cur = g_list_next(cur))
+        {
+                GtkTreeIter i;
+                if(!gtk_tree_model_get_iter(m, &i, (GtkTreePath *) cur->data))
+                        continue;
+
+                g_hash_table_insert(result, i.user_data, i.user_data2);
+        }
+
+        g_list_foreach(selected, (GFunc) gtk_tree_path_free, NULL);
+        g_list_free(selected);
+
+        return result;
+}
+
+
 /** set currently active element */
 static void _foreach_set_current_element(NIFTYLED_TYPE t, gpointer e)
 {
@@ -609,44 +1122,6 @@ static void _do_foreach_iter(GtkTreeModel * m,
 }
 
 
-/** build setup-tree according to current setup */
-static void _tree_build()
-{
-        /* get model */
-        GtkTreeModel *m =
-                gtk_tree_view_get_model(GTK_TREE_VIEW(UI("treeview")));
-        g_object_ref(m);
-
-        /* detach model from view */
-        gtk_tree_view_set_model(GTK_TREE_VIEW(UI("treeview")), NULL);
-
-                /**
-		 * add every hardware-node (+ children)
-		 * to the setup-treeview
-		 */
-        LedHardware *h;
-        for(h = led_setup_get_hardware(setup_get_current()); h;
-            h = led_hardware_list_get_next(h))
-        {
-                _tree_append_hardware(GTK_TREE_STORE(UI("treestore")), h);
-        }
-
-        /* re attach model to view */
-        gtk_tree_view_set_model(GTK_TREE_VIEW(UI("treeview")), m);      /* Re-attach 
-                                                                         * model 
-                                                                         * to
-                                                                         * view 
-                                                                         */
-        g_object_unref(m);
-
-        /* walk complete tree & collapse or expand element */
-        gtk_tree_model_foreach(m, _foreach_element_refresh_collapse, NULL);
-        gtk_tree_model_foreach(m, _foreach_element_refresh_highlight, NULL);
-
-}
-
-
-
 static void _enable_actions_according_to_selected_element()
 {
         /* enable/disable actions - according to new selection */
@@ -912,28 +1387,180 @@ void ui_setup_tree_highlight_only(NIFTYLED_TYPE t, gpointer element)
 }
 
 
-/** clear setup tree */
+/** select (only) the row of an element, expand its parents & scroll to it */
+void ui_setup_tree_select_element(NIFTYLED_TYPE t, gpointer element)
+{
+        GtkTreePath *path;
+        if(!(path = _element_path(t, element)))
+        {
+                NFT_LOG(L_DEBUG, "element not found in setup-tree");
+                return;
+        }
+
+        /* make row visible */
+        GtkTreeView *v = GTK_TREE_VIEW(UI("treeview"));
+        gtk_tree_view_expand_to_path(v, path);
+        gtk_tree_view_scroll_to_cell(v, path, NULL, false, 0, 0);
+
+        /* select row (triggers on_selection_changed()) */
+        GtkTreeSelection *s = gtk_tree_view_get_selection(v);
+        gtk_tree_selection_unselect_all(s);
+        gtk_tree_selection_select_path(s, path);
+
+        gtk_tree_path_free(path);
+}
+
+
+/** detach setup tree from setup (e.g. before current setup is freed) */
 void ui_setup_tree_clear()
 {
-        if(!GTK_TREE_STORE(UI("treestore")))
+        /* pending edits refer to current setup */
+        ui_setup_props_commit();
+
+        _clear_in_progress = true;
+        gtk_tree_view_set_model(GTK_TREE_VIEW(UI("treeview")), NULL);
+        g_hash_table_remove_all(_selected);
+        _clear_in_progress = false;
+}
+
+
+/** tell tree that an element's row changed (e.g. its title) */
+void ui_setup_tree_update_element(NIFTYLED_TYPE t, gpointer element)
+{
+        GtkTreeIter iter;
+        if(!_iter_set(&iter, t, element))
+                return;
+
+        GtkTreeModel *m = GTK_TREE_MODEL(_model);
+        GtkTreePath *path = gtk_tree_model_get_path(m, &iter);
+        gtk_tree_model_row_changed(m, path, &iter);
+        gtk_tree_path_free(path);
+}
+
+
+/** tell tree that an element was added to the current setup */
+void ui_setup_tree_element_inserted(NIFTYLED_TYPE t, gpointer element)
+{
+        GtkTreeIter iter;
+        if(!_iter_set(&iter, t, element))
+                return;
+
+        GtkTreeModel *m = GTK_TREE_MODEL(_model);
+        GtkTreePath *path = gtk_tree_model_get_path(m, &iter);
+        gtk_tree_model_row_inserted(m, path, &iter);
+
+        /* new element might have children already */
+        if(gtk_tree_model_iter_has_child(m, &iter))
+                gtk_tree_model_row_has_child_toggled(m, path, &iter);
+
+        /* parent might not have had children before */
+        GtkTreeIter parent;
+        if(gtk_tree_model_iter_parent(m, &parent, &iter) &&
+           gtk_tree_model_iter_n_children(m, &parent) == 1)
+        {
+                GtkTreePath *ppath = gtk_tree_model_get_path(m, &parent);
+                gtk_tree_model_row_has_child_toggled(m, ppath, &parent);
+                gtk_tree_path_free(ppath);
+        }
+
+        /* restore collapse- & selection-state */
+        _clear_in_progress = true;
+        if(gtk_tree_view_get_model(GTK_TREE_VIEW(UI("treeview"))))
+                _tree_refresh_state(m, &iter, path);
+        _clear_in_progress = false;
+
+        gtk_tree_path_free(path);
+
+        /* redraw */
+        renderer_setup_damage();
+        ui_renderer_all_queue_draw();
+}
+
+
+/** get path of element's row (call before element is removed from setup) */
+GtkTreePath *ui_setup_tree_element_removing(NIFTYLED_TYPE t, gpointer element)
+{
+        GtkTreeIter iter;
+        if(!_iter_set(&iter, t, element))
+                return NULL;
+
+        /* pending edits might refer to element */
+        ui_setup_props_commit();
+
+        /* element and its children can't stay selected */
+        GHashTableIter it;
+        gpointer e, et;
+        g_hash_table_iter_init(&it, _selected);
+        while(g_hash_table_iter_next(&it, &e, &et))
+        {
+                GtkTreeIter i;
+                _iter_set(&i, GPOINTER_TO_INT(et), e);
+                if(_iter_is_below(&i, element))
+                        g_hash_table_iter_remove(&it);
+        }
+
+        return gtk_tree_model_get_path(GTK_TREE_MODEL(_model), &iter);
+}
+
+
+/** tell tree that the element at path was removed from setup (frees path) */
+void ui_setup_tree_element_deleted(GtkTreePath * path)
+{
+        if(!path)
                 return;
 
+        GtkTreeModel *m = GTK_TREE_MODEL(_model);
+
         _clear_in_progress = true;
-        gtk_tree_store_clear(GTK_TREE_STORE(UI("treestore")));
+
+        gtk_tree_model_row_deleted(m, path);
+
+        /* parent might have lost its last child */
+        GtkTreeIter parent;
+        if(gtk_tree_path_up(path) && gtk_tree_path_get_depth(path) > 0 &&
+           gtk_tree_model_get_iter(m, &parent, path) &&
+           !gtk_tree_model_iter_has_child(m, &parent))
+                gtk_tree_model_row_has_child_toggled(m, path, &parent);
+
         _clear_in_progress = false;
+
+        gtk_tree_path_free(path);
+
+        /* redraw */
+        renderer_setup_damage();
+        ui_renderer_all_queue_draw();
 }
 
 
 /** refresh setup-tree to reflect changes to the setup */
 void ui_setup_tree_refresh()
 {
-        /* clear tree */
-        ui_setup_tree_clear();
+        GtkTreeView *v = GTK_TREE_VIEW(UI("treeview"));
+        GtkTreeModel *m = GTK_TREE_MODEL(_model);
 
         _clear_in_progress = true;
 
-        /* rebuild tree */
-        _tree_build();
+        /* re-attach model (view only fetches the rows it displays) */
+        gtk_tree_view_set_model(v, NULL);
+        gtk_tree_view_set_model(v, m);
+
+        /* restore collapse- & selection-state of all visible rows */
+        GtkTreeIter i;
+        if(gtk_tree_model_iter_children(m, &i, NULL))
+        {
+                GtkTreePath *path = gtk_tree_path_new_first();
+                do
+                {
+                        _tree_refresh_state(m, &i, path);
+                        gtk_tree_path_next(path);
+                }
+                while(gtk_tree_model_iter_next(m, &i));
+                gtk_tree_path_free(path);
+        }
+
+        /* remember restored selection */
+        g_hash_table_destroy(_selected);
+        _selected = _selection_snapshot(gtk_tree_view_get_selection(v));
 
         _clear_in_progress = false;
 
@@ -986,6 +1613,12 @@ gboolean ui_setup_tree_init()
         gtk_tree_view_column_add_attribute(col, renderer, "text",
                                            C_SETUP_TITLE);
 
+        /* model that represents current setup */
+        _model = g_object_new(setup_tree_model_get_type(), NULL);
+        _selected = g_hash_table_new(g_direct_hash, g_direct_equal);
+        gtk_tree_view_set_model(GTK_TREE_VIEW(UI("treeview")),
+                                GTK_TREE_MODEL(_model));
+
         /* register prefs class for this module */
         if(!nft_prefs_class_register
            (prefs(), "ui-setup-tree", _this_from_prefs, _this_to_prefs))
@@ -1001,6 +1634,9 @@ void ui_setup_tree_deinit()
         /* unregister prefs class */
         nft_prefs_class_unregister(prefs(), "ui-setup-tree");
 
+        g_hash_table_destroy(_selected);
+        g_object_unref(_model);
+
         g_object_unref(_builder);
 }
 
@@ -1100,25 +1736,63 @@ static void on_selection_changed(GtkTreeSelection * selection, gpointer u)
         if(_clear_in_progress)
                 return;
 
-        /* clear live preview */
-        live_preview_clear();
+        /* drop LEDs selected in renderer */
+        ui_renderer_selection_clear();
+
+        /* elements selected now */
+        GHashTable *selected = _selection_snapshot(selection);
 
-        if(gtk_tree_selection_count_selected_rows(selection) <= 0)
+        /* unhighlight elements that aren't selected anymore */
+        gboolean unhighlighted = false;
+        GHashTableIter it;
+        gpointer e, t;
+        g_hash_table_iter_init(&it, _selected);
+        while(g_hash_table_iter_next(&it, &e, &t))
+        {
+                if(g_hash_table_lookup_extended(selected, e, NULL, NULL))
+                        continue;
+
+                _foreach_unhighlight_element(GPOINTER_TO_INT(t), e);
+                _live_preview_unhighlight(GPOINTER_TO_INT(t), e);
+                unhighlighted = true;
+        }
+
+        /* highlight newly selected elements */
+        g_hash_table_iter_init(&it, selected);
+        while(g_hash_table_iter_next(&it, &e, &t))
+        {
+                gboolean was_selected =
+                        g_hash_table_lookup_extended(_selected, e, NULL,
+                                                     NULL);
+
+                /* unhighlighting might have cleared the preview of a
+                   still selected element (e.g. a child) */
+                if(was_selected && !unhighlighted)
+                        continue;
+
+                _foreach_highlight_element(GPOINTER_TO_INT(t), e);
+
+                if(!was_selected)
+                        _element_damage(GPOINTER_TO_INT(t), e);
+        }
+
+        g_hash_table_destroy(_selected);
+        _selected = selected;
+
+        if(g_hash_table_size(_selected) == 0)
         {
                 ui_setup_props_hide();
                 live_preview_show();
+                ui_renderer_all_queue_draw();
                 return;
         }
 
-        /* unhighlight all rows */
-        ui_setup_tree_do_foreach_element(_foreach_unhighlight_element);
-
         /* set currently active element */
         ui_setup_tree_do_for_last_selected_element
                 (_foreach_set_current_element);
 
-        /* process all selected elements */
-        ui_setup_tree_do_foreach_selected_element(_foreach_element_selected);
+        /* show properties of active element */
+        ui_setup_tree_do_for_last_selected_element(_foreach_element_selected);
 
 
         /* enable/disable actions, according to currently selected element */
@@ -58,9 +58,14 @@ NIFTYLED_TYPE                   ui_setup_tree_current_element_type();
 /* GUI functions */
 void                            ui_setup_tree_clear();
 void                            ui_setup_tree_refresh();
+void                            ui_setup_tree_update_element(NIFTYLED_TYPE t, gpointer element);
+void                            ui_setup_tree_element_inserted(NIFTYLED_TYPE t, gpointer element);
+GtkTreePath                    *ui_setup_tree_element_removing(NIFTYLED_TYPE t, gpointer element);
+void                            ui_setup_tree_element_deleted(GtkTreePath * path);
 void                            ui_setup_tree_get_last_selected_element(NIFTYLED_TYPE * t, gpointer * element);
 void                            ui_setup_tree_get_first_selected_element(NIFTYLED_TYPE * t, gpointer * element);
 void                            ui_setup_tree_highlight_only(NIFTYLED_TYPE t, gpointer element);
+void                            ui_setup_tree_select_element(NIFTYLED_TYPE t, gpointer element);
 
 /* model functions */
 void                            ui_setup_tree_do_foreach_element(void (*func) (NIFTYLED_TYPE t, gpointer e));
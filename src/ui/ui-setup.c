@@ -41,6 +41,8 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <errno.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -53,11 +55,16 @@
 #include "ui/ui-setup-props.h"
 #include "ui/ui-setup-tree.h"
 #include "ui/ui-setup-ledlist.h"
+#include "ui/ui-setup-save.h"
 #include "ui/ui-clipboard.h"
 #include "ui/ui-hardware.h"
 #include "elements/element-setup.h"
 #include "elements/element-hardware.h"
 #include "live-preview/live-preview.h"
+#include "cache/cache.h"
+#include "export/export.h"
+#include "import/import.h"
+#include "journal/journal.h"
 
 
 
@@ -68,6 +75,41 @@
 static GtkBuilder *_builder;
 
 
+/** size of chunks a setup file is read in (bytes) */
+#define LOAD_CHUNK_SIZE         (64*1024)
+/** interval to update progress of loading setup (ms) */
+#define LOAD_PROGRESS_INTERVAL  100
+
+/** setup file that's loaded by a worker thread */
+typedef struct
+{
+        gchar *filename;
+        GThread *thread;
+        /** set by main thread to abort loading (atomic) */
+        gint cancel;
+        /** size of file & bytes read so far (atomic) */
+        gint size, read;
+        /** hardware nodes in file & hardware built so far (atomic) */
+        gint hardware_total, hardware_built;
+        /** tiles & chains built so far (atomic) */
+        gint elements;
+        /** state of file when it was read (for cache) */
+        CacheStamp stamp;
+        gboolean stamped;
+        /** finished setup (NULL on failure) */
+        LedSetup *setup;
+        /** reason of failure (or NULL) */
+        gchar *error;
+} LoadJob;
+
+/** setup currently loaded (NULL if none) */
+static LoadJob *_load;
+/** source ID of progress update */
+static guint _load_progress_id;
+/** current setup has a journal (the one created at startup hasn't) */
+static gboolean _journal_started;
+
+
 
 /******************************************************************************
  ****************************** STATIC FUNCTIONS ******************************
@@ -84,6 +126,337 @@ static GObject *_ui(const char *name)
 }
 
 
+/** read whole file in chunks (runs in worker thread) */
+static gchar *_load_read(LoadJob * j, gsize * length)
+{
+        FILE *f;
+        if(!(f = fopen(j->filename, "r")))
+        {
+                j->error = g_strdup_printf("Failed to open \"%s\" - %s",
+                                           j->filename, strerror(errno));
+                return NULL;
+        }
+
+        struct stat sts;
+        if(fstat(fileno(f), &sts) == -1)
+        {
+                j->error = g_strdup_printf("Failed to access \"%s\" - %s",
+                                           j->filename, strerror(errno));
+                fclose(f);
+                return NULL;
+        }
+        g_atomic_int_set(&j->size, (gint) sts.st_size);
+
+        gchar *buf = g_malloc(sts.st_size + 1);
+        gsize pos = 0;
+        while(pos < (gsize) sts.st_size)
+        {
+                if(g_atomic_int_get(&j->cancel))
+                        goto _lr_error;
+
+                size_t r = fread(buf + pos, 1,
+                                 MIN(LOAD_CHUNK_SIZE, sts.st_size - pos), f);
+                if(r == 0)
+                {
+                        j->error = g_strdup_printf("Failed to read \"%s\"",
+                                                   j->filename);
+                        goto _lr_error;
+                }
+
+                pos += r;
+                g_atomic_int_set(&j->read, (gint) pos);
+        }
+        buf[pos] = '\0';
+        fclose(f);
+
+        /* cache must match what's parsed, not what's on disk later */
+        j->stamped = cache_stamp(&j->stamp, &sts, buf, pos);
+
+        *length = pos;
+        return buf;
+
+_lr_error:
+        fclose(f);
+        g_free(buf);
+        return NULL;
+}
+
+
+/** amount of tiles & chains in a list of tiles */
+static gint _load_count_tiles(LedTile * t)
+{
+        gint result = 0;
+        for(; t; t = led_tile_list_get_next(t))
+        {
+                result += 1 + (led_tile_get_chain(t) ? 1 : 0);
+                result += _load_count_tiles(led_tile_get_child(t));
+        }
+
+        return result;
+}
+
+
+/** build setup from prefs node one hardware at a time (worker thread) */
+static LedSetup *_load_build(LoadJob * j, LedPrefs * p, LedPrefsNode * n)
+{
+        if(led_prefs_node_get_type(n) != LED_SETUP_T)
+        {
+                j->error = g_strdup_printf("\"%s\" contains no setup",
+                                           j->filename);
+                return NULL;
+        }
+
+        /* count hardware nodes for progress */
+        LedPrefsNode *child;
+        gint total = 0;
+        for(child = nft_prefs_node_get_first_child(n); child;
+            child = nft_prefs_node_get_next(child))
+        {
+                if(led_prefs_node_get_type(child) == LED_HARDWARE_T)
+                        total++;
+        }
+        g_atomic_int_set(&j->hardware_total, total);
+
+        LedSetup *s;
+        if(!(s = led_setup_new()))
+                return NULL;
+
+        LedHardware *last = NULL;
+        for(child = nft_prefs_node_get_first_child(n); child;
+            child = nft_prefs_node_get_next(child))
+        {
+                if(g_atomic_int_get(&j->cancel))
+                        goto _lb_error;
+
+                if(led_prefs_node_get_type(child) != LED_HARDWARE_T)
+                        continue;
+
+                LedHardware *h;
+                if(!(h = led_prefs_hardware_from_node(p, child)))
+                {
+                        j->error = g_strdup_printf
+                                ("Failed to build hardware from \"%s\"",
+                                 j->filename);
+                        goto _lb_error;
+                }
+
+                if(!last)
+                        led_setup_set_hardware(s, h);
+                else
+                        led_hardware_list_append_head(last, h);
+                last = h;
+
+                g_atomic_int_add(&j->elements,
+                                 _load_count_tiles(led_hardware_get_tile(h)));
+                g_atomic_int_inc(&j->hardware_built);
+        }
+
+        return s;
+
+_lb_error:
+        led_setup_destroy(s);
+        return NULL;
+}
+
+
+/**
+ * start journal of the setup created at startup, unless a file that's
+ * loaded replaces it
+ */
+static gboolean _journal_startup(gpointer u)
+{
+        if(_journal_started || _load)
+                return false;
+
+        _journal_started = true;
+        journal_open(NULL);
+
+        return false;
+}
+
+
+/** main-thread part of loading: register finished setup */
+static gboolean _load_finished(gpointer u)
+{
+        LoadJob *j = u;
+
+        g_thread_join(j->thread);
+
+        g_source_remove(_load_progress_id);
+        _load_progress_id = 0;
+        gtk_widget_hide(GTK_WIDGET(_ui("setup_load_window")));
+
+        if(g_atomic_int_get(&j->cancel))
+        {
+                NFT_LOG(L_INFO, "Loading \"%s\" cancelled", j->filename);
+                if(j->setup)
+                        led_setup_destroy(j->setup);
+        }
+        else if(!j->setup)
+        {
+                ui_log_alert_show("Error while loading file\n \"%s\"\n%s",
+                                  j->filename,
+                                  j->error ? j->error :
+                                  "(s. log for further info)");
+        }
+        /* register new setup */
+        else if(setup_register_to_gui(j->setup))
+        {
+                setup_set_current_filename(j->filename);
+
+                /* update ui */
+                ui_setup_tree_refresh();
+
+                /* offer to recover unsaved edits of this file */
+                _journal_started = true;
+                journal_open(j->filename);
+        }
+
+        _load = NULL;
+
+        /* startup setup is kept */
+        _journal_startup(NULL);
+
+        g_free(j->error);
+        g_free(j->filename);
+        g_slice_free(LoadJob, j);
+
+        return false;
+}
+
+
+/** load setup file (runs in worker thread) */
+static gpointer _load_thread(gpointer u)
+{
+        LoadJob *j = u;
+
+        /* unchanged setup? restore it from cache */
+        if((j->setup = cache_load(j->filename)))
+        {
+                LedHardware *h;
+                for(h = led_setup_get_hardware(j->setup); h;
+                    h = led_hardware_list_get_next(h))
+                {
+                        g_atomic_int_inc(&j->hardware_total);
+                        g_atomic_int_inc(&j->hardware_built);
+                }
+                goto _lt_exit;
+        }
+
+        /* own prefs context, the main thread keeps using its own */
+        LedPrefs *p;
+        if(!(p = led_prefs_init()))
+                goto _lt_exit;
+
+        gsize length;
+        gchar *buf;
+        if(!(buf = _load_read(j, &length)))
+                goto _lt_deinit;
+
+        LedPrefsNode *n = led_prefs_node_from_buffer(p, buf, length);
+        g_free(buf);
+        if(!n)
+        {
+                j->error = g_strdup_printf("Failed to parse \"%s\"",
+                                           j->filename);
+                goto _lt_deinit;
+        }
+
+        j->setup = _load_build(j, p, n);
+        led_prefs_node_free(n);
+
+        /* speed up next load of this file */
+        if(j->setup && j->stamped && !g_atomic_int_get(&j->cancel))
+                cache_save(j->setup, j->filename, &j->stamp);
+
+_lt_deinit:
+        led_prefs_deinit(p);
+_lt_exit:
+        g_idle_add(_load_finished, j);
+        return NULL;
+}
+
+
+/** show progress of loading setup */
+static gboolean _load_progress_cb(gpointer u)
+{
+        if(!_load)
+                return false;
+
+        GtkProgressBar *bar = GTK_PROGRESS_BAR(_ui("setup_load_progressbar"));
+        gint size = g_atomic_int_get(&_load->size);
+        gint read = g_atomic_int_get(&_load->read);
+        gint total = g_atomic_int_get(&_load->hardware_total);
+        gint built = g_atomic_int_get(&_load->hardware_built);
+
+        gchar *text;
+        if(g_atomic_int_get(&_load->cancel))
+        {
+                text = g_strdup("Cancelling...");
+                gtk_progress_bar_pulse(bar);
+        }
+        /* reading file (first half) */
+        else if(read < size || size == 0)
+        {
+                text = g_strdup_printf("Read %d of %d kB",
+                                       read / 1024, size / 1024);
+                gtk_progress_bar_set_fraction(bar,
+                                              size ? 0.5 * read / size : 0);
+        }
+        /* parsing (unknown duration) */
+        else if(total == 0)
+        {
+                text = g_strdup("Parsing...");
+                gtk_progress_bar_pulse(bar);
+        }
+        /* building hardware (second half) */
+        else
+        {
+                text = g_strdup_printf("Built %d of %d hardware (%d elements)",
+                                       built, total,
+                                       g_atomic_int_get(&_load->elements));
+                gtk_progress_bar_set_fraction(bar,
+                                              0.5 + 0.5 * built / total);
+        }
+
+        gtk_progress_bar_set_text(bar, text);
+        g_free(text);
+
+        return true;
+}
+
+
+/** cancel loading of setup */
+static void _load_cancel()
+{
+        if(_load)
+                g_atomic_int_set(&_load->cancel, 1);
+}
+
+
+/** cancel loading of setup and wait for worker thread to finish */
+static void _load_abort()
+{
+        if(!_load)
+                return;
+
+        _load_cancel();
+        g_thread_join(_load->thread);
+
+        /* worker already queued _load_finished() */
+        g_idle_remove_by_data(_load);
+        g_source_remove(_load_progress_id);
+        _load_progress_id = 0;
+
+        if(_load->setup)
+                led_setup_destroy(_load->setup);
+        g_free(_load->error);
+        g_free(_load->filename);
+        g_slice_free(LoadJob, _load);
+        _load = NULL;
+}
+
+
 /******************************************************************************
  ****************************** PUBLIC FUNCTIONS ****************************** 
  ******************************************************************************/
@@ -127,7 +500,10 @@ gboolean ui_setup_save(gchar * filename)
 
         NFT_LOG(L_INFO, "Saving setup to \"%s\"", filename);
 
-        /* create prefs-node from current setup */
+        /* journal can drop edits up to here once the file is written */
+        guint checkpoint = journal_checkpoint();
+
+        /* create prefs-node from current setup (consistent snapshot) */
         LedPrefsNode *n;
         if(!(n = led_prefs_setup_to_node(setup_get_prefs(), s)))
         {
@@ -136,73 +512,41 @@ gboolean ui_setup_save(gchar * filename)
                 return false;
         }
 
-        /* file existing? */
-        struct stat sts;
-        if(stat(filename, &sts) == -1)
-        {
-                /* continue if stat error was caused because file doesn't exist 
-                 */
-                if(errno != ENOENT)
-                {
-                        ui_log_alert_show("Failed to access \"%s\" - %s",
-                                          filename, strerror(errno));
-                        return false;
-                }
-        }
-        /* stat succeeded, file exists */
-        else
-        {
-                /* remove old file? */
-                if(!ui_log_dialog_yesno
-                   ("Overwrite",
-                    "A file named \"%s\" already exists.\nOverwrite?",
-                    filename))
-                        return false;
-
-                if(unlink(filename) == -1)
-                {
-                        ui_log_alert_show
-                                ("Failed to remove old version of \"%s\" - %s",
-                                 filename, strerror(errno));
-                        return false;
-                }
-        }
-
-        /* save */
-        if(!led_prefs_node_to_file(setup_get_prefs(), n, filename, false))
-        {
-                ui_log_alert_show("Failed to save preferences to \"%s\"",
-                                  filename);
-                return false;
-        }
-
-        /* all went ok */
-        return true;
+        /* write in background, errors are shown when saving finished */
+        return ui_setup_save_node(n, filename, false, journal_saved,
+                                  GUINT_TO_POINTER(checkpoint));
 }
 
 
-/** load new setup from file */
+/**
+ * start loading new setup from file, the file is parsed by a worker
+ * thread and the finished setup is registered from the main loop
+ */
 gboolean ui_setup_load(gchar * filename)
 {
-        /* load file */
-        LedPrefsNode *n;
-        if(!(n = led_prefs_node_from_file(setup_get_prefs(), filename)))
-                return false;
+        if(!filename)
+                NFT_LOG_NULL(false);
 
-        /* build setup from prefs node */
-        LedSetup *s;
-        if(!(s = led_prefs_setup_from_node(setup_get_prefs(), n)))
-                return false;
+        /* newer request wins */
+        _load_abort();
 
-        /* register new setup */
-        if(!setup_register_to_gui(s))
-                return false;
+        LoadJob *j = g_slice_new0(LoadJob);
+        j->filename = g_strdup(filename);
 
-        /* set current filename */
-        setup_set_current_filename(filename);
+        /* show progress */
+        gtk_label_set_text(GTK_LABEL(_ui("setup_load_file_label")),
+                           filename);
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR
+                                      (_ui("setup_load_progressbar")), 0);
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR
+                                  (_ui("setup_load_progressbar")),
+                                  "Reading...");
+        gtk_widget_show(GTK_WIDGET(_ui("setup_load_window")));
 
-        /* update ui */
-        ui_setup_tree_refresh();
+        _load = j;
+        _load_progress_id = g_timeout_add(LOAD_PROGRESS_INTERVAL,
+                                          _load_progress_cb, NULL);
+        j->thread = g_thread_new("setup-load", _load_thread, j);
 
         return true;
 }
@@ -274,6 +618,10 @@ gboolean ui_setup_init()
                                                (_ui
                                                 ("chain_add_pixelformat_comboboxtext")),
                                                format);
+                gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT
+                                               (_ui
+                                                ("tile_grid_pixelformat_comboboxtext")),
+                                               format);
         }
         gtk_combo_box_set_active(GTK_COMBO_BOX
                                  (_ui
@@ -282,6 +630,9 @@ gboolean ui_setup_init()
         gtk_combo_box_set_active(GTK_COMBO_BOX
                                  (_ui("chain_add_pixelformat_comboboxtext")),
                                  0);
+        gtk_combo_box_set_active(GTK_COMBO_BOX
+                                 (_ui("tile_grid_pixelformat_comboboxtext")),
+                                 0);
 
         /* start with fresh empty setup */
         LedSetup *setup;
@@ -290,6 +641,9 @@ gboolean ui_setup_init()
 
         setup_register_to_gui(setup);
 
+        /* once setup files to load at startup are known */
+        g_idle_add(_journal_startup, NULL);
+
         // g_object_unref(ui);
 
         return true;
@@ -300,6 +654,11 @@ gboolean ui_setup_init()
 /** deinitialize setup module */
 void ui_setup_deinit()
 {
+        /* abort loading (main loop doesn't run anymore) */
+        _load_abort();
+
+        /* finish pending saves */
+        ui_setup_save_deinit();
 
         /* deinitialize all modules used by this module */
         ui_setup_props_deinit();
@@ -331,8 +690,11 @@ G_MODULE_EXPORT void on_action_setup_new_activate(GtkAction * a, gpointer u)
         /* save new settings */
         setup_register_to_gui(s);
         setup_set_current_filename("Unnamed.xml");
-        ui_setup_tree_clear();
+        ui_setup_tree_refresh();
         ui_renderer_all_queue_draw();
+
+        _journal_started = true;
+        journal_open(NULL);
 }
 
 
@@ -380,6 +742,45 @@ G_MODULE_EXPORT void on_action_export_activate(GtkAction * a, gpointer u)
 }
 
 
+/** export LED geometry */
+G_MODULE_EXPORT void on_action_export_geometry_activate(GtkAction * a,
+                                                        gpointer u)
+{
+        gtk_widget_show(GTK_WIDGET(_ui("filechooserdialog_geometry")));
+}
+
+
+/** export mapping table next to setup file */
+G_MODULE_EXPORT void on_action_export_mapping_activate(GtkAction * a,
+                                                       gpointer u)
+{
+        const char *setupfile;
+        if(!(setupfile = setup_get_current_filename()))
+        {
+                ui_log_alert_show("Please save the setup first.\n"
+                                  "The mapping table is written next to it.");
+                return;
+        }
+
+        gchar *filename = g_strdup_printf("%s.map", setupfile);
+        if(!export_mapping(setup_get_current(), filename))
+                ui_log_alert_show("Failed to export mapping table to \"%s\"",
+                                  filename);
+        else
+                NFT_LOG(L_NOTICE, "Mapping table written to \"%s\"",
+                        filename);
+        g_free(filename);
+}
+
+
+/** import LED positions */
+G_MODULE_EXPORT void on_action_import_positions_activate(GtkAction * a,
+                                                         gpointer u)
+{
+        gtk_widget_show(GTK_WIDGET(_ui("filechooserdialog_positions")));
+}
+
+
 /** live preview toggled */
 G_MODULE_EXPORT void on_toggleaction_live_preview_show_toggled(GtkToggleAction
                                                                * a,
@@ -439,17 +840,32 @@ G_MODULE_EXPORT void on_setup_open_clicked(GtkButton * b, gpointer u)
                 return;
         }
 
-        if(!ui_setup_load(filename))
-        {
-                ui_log_alert_show("Error while loading file\n \"%s\"\n"
-                                  "(s. log for further info)",
-                                  filename);
-        }
+        /* errors are shown when loading finished */
+        ui_setup_load(filename);
 
         gtk_widget_hide(GTK_WIDGET(_ui("filechooserdialog_load")));
         g_free(filename);
 }
 
+
+/** "cancel" button in load progress window clicked */
+G_MODULE_EXPORT void on_setup_load_cancel_clicked(GtkButton * b, gpointer u)
+{
+        _load_cancel();
+}
+
+
+/** load progress window closed */
+G_MODULE_EXPORT gboolean on_setup_load_window_delete_event(GtkWidget * w,
+                                                           GdkEvent * e,
+                                                           gpointer u)
+{
+        _load_cancel();
+
+        /* window is hidden when loading finished */
+        return true;
+}
+
 /** "export" button in filechooser clicked */
 G_MODULE_EXPORT void on_setup_export_clicked(GtkButton * b, gpointer u)
 {
@@ -481,6 +897,112 @@ G_MODULE_EXPORT void on_setup_export_cancel_clicked(GtkButton * b, gpointer u)
 }
 
 
+/** "save" button in geometry filechooser clicked */
+G_MODULE_EXPORT void on_setup_export_geometry_clicked(GtkButton * b,
+                                                      gpointer u)
+{
+        char *filename;
+        if(!(filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER
+                                                      (_ui
+                                                       ("filechooserdialog_geometry")))))
+        {
+                NFT_LOG(L_ERROR, "No filename received from dialog.");
+                return;
+        }
+
+        if(!export_geometry(setup_get_current(), filename,
+                            export_format_from_filename(filename)))
+        {
+                ui_log_alert_show("Failed to export LED geometry to \"%s\"",
+                                  filename);
+                goto osegc_exit;
+        }
+
+        gtk_widget_hide(GTK_WIDGET(_ui("filechooserdialog_geometry")));
+
+osegc_exit:
+        g_free(filename);
+}
+
+
+/** "open" button in positions filechooser clicked */
+G_MODULE_EXPORT void on_setup_import_positions_clicked(GtkButton * b,
+                                                       gpointer u)
+{
+        char *filename;
+        if(!(filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER
+                                                      (_ui
+                                                       ("filechooserdialog_positions")))))
+        {
+                NFT_LOG(L_ERROR, "No filename received from dialog.");
+                return;
+        }
+
+        /* rows without indices go to the selected chain */
+        NIFTYLED_TYPE t;
+        gpointer e;
+        ui_setup_tree_get_last_selected_element(&t, &e);
+        NiftyconfChain *target = NULL;
+        if(t == LED_CHAIN_T)
+        {
+                target = e;
+        }
+        else if(t == LED_TILE_T)
+        {
+                LedChain *c;
+                if((c = led_tile_get_chain(tile_niftyled(e))))
+                        target = led_chain_get_privdata(c);
+        }
+
+        ImportResult r;
+        if(!import_positions(filename, target, &r))
+        {
+                ui_log_alert_show("Failed to import LED positions from \"%s\"",
+                                  filename);
+                goto osipc_exit;
+        }
+
+        gtk_widget_hide(GTK_WIDGET(_ui("filechooserdialog_positions")));
+
+        /* report rows that didn't match */
+        if(r.unmatched)
+        {
+                GString *lines = g_string_new(NULL);
+                guint i;
+                for(i = 0; i < MIN(r.unmatched, IMPORT_MAX_REPORTED); i++)
+                        g_string_append_printf(lines, "%s%u", i ? ", " : "",
+                                               r.lines[i]);
+
+                ui_log_alert_show("Imported %u positions.\n"
+                                  "%u row(s) didn't match a LED "
+                                  "(line %s%s)", r.applied, r.unmatched,
+                                  lines->str,
+                                  r.unmatched > IMPORT_MAX_REPORTED ?
+                                  ", ..." : "");
+                g_string_free(lines, true);
+        }
+
+osipc_exit:
+        g_free(filename);
+}
+
+
+/** "cancel" button in positions filechooser clicked */
+G_MODULE_EXPORT void on_setup_import_positions_cancel_clicked(GtkButton * b,
+                                                              gpointer u)
+{
+        gtk_widget_hide(GTK_WIDGET(_ui("filechooserdialog_positions")));
+}
+
+
+/** "cancel" button in geometry filechooser clicked */
+G_MODULE_EXPORT void on_setup_export_geometry_cancel_clicked(GtkButton * b,
+                                                             gpointer u)
+{
+        gtk_widget_hide(GTK_WIDGET(_ui("filechooserdialog_geometry")));
+}
+
+
 /** "cancel" button in filechooser clicked */
 G_MODULE_EXPORT void on_setup_import_cancel_clicked(GtkButton * b, gpointer u)
 {
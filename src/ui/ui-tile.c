@@ -48,6 +48,9 @@
 #include "ui/ui-setup.h"
 #include "ui/ui-setup-tree.h"
 #include "ui/ui-setup-props.h"
+#include "ui/ui-log.h"
+#include "layout/layout.h"
+#include "undo/undo.h"
 
 
 
@@ -106,9 +109,6 @@ G_MODULE_EXPORT void on_action_tile_add_activate(GtkAction * a, gpointer u)
         }
 
         /** @todo refresh our menu */
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
 }
 
 
@@ -125,12 +125,133 @@ static void _foreach_remove_tile(NIFTYLED_TYPE t, gpointer e)
 /** tile remove */
 G_MODULE_EXPORT void on_action_tile_remove_activate(GtkAction * a, gpointer u)
 {
-        /* remove all currently selected elements */
+        /* remove all currently selected elements (undone at once) */
+        undo_group_begin();
         ui_setup_tree_do_foreach_selected_element(_foreach_remove_tile);
-
-        /* refresh tree */
-        ui_setup_tree_refresh();
+        undo_group_end();
 
         /* hide properties */
         ui_setup_props_hide();
 }
+
+
+/** tile grid */
+G_MODULE_EXPORT void on_action_tile_grid_activate(GtkAction * a, gpointer u)
+{
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("tile_grid_window")),
+                               true);
+}
+
+
+/** tile grid "add" clicked */
+G_MODULE_EXPORT void on_tile_grid_add_clicked(GtkButton * b, gpointer u)
+{
+        NIFTYLED_TYPE t;
+        gpointer e;
+        ui_setup_tree_get_last_selected_element(&t, &e);
+
+        /* grids are created below a hardware */
+        if(t != LED_HARDWARE_T)
+        {
+                ui_log_alert_show("Please select a hardware to add tiles to");
+                return;
+        }
+
+        LayoutParams p = {
+                .pattern =
+                        gtk_combo_box_get_active(GTK_COMBO_BOX
+                                                 (ui_setup
+                                                  ("tile_grid_pattern_comboboxtext"))),
+                .width =
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("tile_grid_width_spinbutton"))),
+                .stride_x =
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("tile_grid_stride_x_spinbutton"))),
+                .stride_y =
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("tile_grid_stride_y_spinbutton"))),
+        };
+
+        if(!layout_grid((NiftyconfHardware *) e,
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("tile_grid_columns_spinbutton"))),
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("tile_grid_rows_spinbutton"))),
+                        gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                         (ui_setup
+                                                          ("tile_grid_ledcount_spinbutton"))),
+                        gtk_combo_box_get_active_text(GTK_COMBO_BOX
+                                                      (ui_setup
+                                                       ("tile_grid_pixelformat_comboboxtext"))),
+                        &p))
+                return;
+
+        /* hide dialog */
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("tile_grid_window")),
+                               false);
+}
+
+
+/** tile grid "cancel" clicked */
+G_MODULE_EXPORT void on_tile_grid_cancel_clicked(GtkButton * b, gpointer u)
+{
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("tile_grid_window")),
+                               false);
+}
+
+
+/** tile array */
+G_MODULE_EXPORT void on_action_tile_array_activate(GtkAction * a, gpointer u)
+{
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("tile_array_window")),
+                               true);
+}
+
+
+/** tile array "add" clicked */
+G_MODULE_EXPORT void on_tile_array_add_clicked(GtkButton * b, gpointer u)
+{
+        NIFTYLED_TYPE t;
+        gpointer e;
+        ui_setup_tree_get_last_selected_element(&t, &e);
+
+        /* selected tile is the template */
+        if(t != LED_TILE_T)
+        {
+                ui_log_alert_show("Please select a tile to duplicate");
+                return;
+        }
+
+        if(!layout_tile_array((NiftyconfTile *) e,
+                              gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                               (ui_setup
+                                                                ("tile_array_columns_spinbutton"))),
+                              gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                               (ui_setup
+                                                                ("tile_array_rows_spinbutton"))),
+                              gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                               (ui_setup
+                                                                ("tile_array_step_x_spinbutton"))),
+                              gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON
+                                                               (ui_setup
+                                                                ("tile_array_step_y_spinbutton")))))
+                return;
+
+        /* hide dialog */
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("tile_array_window")),
+                               false);
+}
+
+
+/** tile array "cancel" clicked */
+G_MODULE_EXPORT void on_tile_array_cancel_clicked(GtkButton * b, gpointer u)
+{
+        gtk_widget_set_visible(GTK_WIDGET(ui_setup("tile_array_window")),
+                               false);
+}
@@ -0,0 +1,1289 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "ui/ui.h"
+#include "ui/ui-log.h"
+#include "ui/ui-renderer.h"
+#include "ui/ui-setup-tree.h"
+#include "ui/ui-setup-props.h"
+#include "elements/element-setup.h"
+#include "elements/element-hardware.h"
+#include "elements/element-tile.h"
+#include "elements/element-chain.h"
+#include "elements/element-led.h"
+#include "renderer/renderer-setup.h"
+#include "renderer/renderer-tile.h"
+#include "renderer/renderer-chain.h"
+#include "renderer/renderer-led.h"
+#include "spatial-index/spatial-index.h"
+#include "undo/undo.h"
+#include "journal/journal.h"
+
+
+/**
+ * The journal records inverse operations instead of snapshots. Every
+ * operation stores the state of its element that is currently not in the
+ * setup. Applying an operation swaps that with the current state, so
+ * the same operation is used for undo & redo and the cost of both is
+ * proportional to the amount of recorded values.
+ */
+
+
+/** maximum amount of steps that can be undone */
+#define UNDO_MAX_STEPS          100
+/** edits of the same properties closer than this become one step (ms) */
+#define UNDO_MERGE_INTERVAL     500
+
+
+/** element an operation refers to, survives removal & re-creation */
+typedef struct
+{
+        NIFTYLED_TYPE type;
+        /** element (NULL while it's not part of the setup) */
+        gpointer element;
+        /** amount of operations referring to this handle */
+        guint refs;
+} UndoHandle;
+
+
+/** kinds of operations */
+typedef enum
+{
+        /** properties of a range of LEDs */
+        UNDO_OP_LEDS,
+        /** placement of a tile */
+        UNDO_OP_TILE,
+        /** amount of LEDs of a chain */
+        UNDO_OP_LEDCOUNT,
+        /** element inserted into or removed from setup */
+        UNDO_OP_TREE,
+} UndoOpType;
+
+
+/** position of a LED */
+typedef struct
+{
+        LedFrameCord x, y;
+} UndoPos;
+
+
+/** placement of a tile */
+typedef struct
+{
+        LedFrameCord x, y;
+        double rotation;
+        double pivot_x, pivot_y;
+} UndoTile;
+
+
+/** one recorded operation */
+typedef struct
+{
+        UndoOpType type;
+        /** element this operation refers to */
+        UndoHandle *handle;
+        union
+        {
+                struct
+                {
+                        UndoLedField field;
+                        LedCount first, count;
+                        /** one value per LED (type depends on field) */
+                        gpointer values;
+                } leds;
+                UndoTile tile;
+                LedCount ledcount;
+                struct
+                {
+                        /** element is currently part of the setup */
+                        gboolean present;
+                        /** parent element (NULL for hardware) */
+                        UndoHandle *parent;
+                        /** position among siblings (hardware & tiles) */
+                        guint position;
+                        /** element while it's not part of the setup */
+                        LedPrefsNode *node;
+                        /** handles of element & its descendants (preorder) */
+                        GPtrArray *handles;
+                } tree;
+        } u;
+} UndoOp;
+
+
+/** operations that are undone/redone together */
+typedef struct
+{
+        /** UndoOp in order of recording */
+        GPtrArray *ops;
+        /** property operations (UndoOp -> UndoOp) */
+        GHashTable *index;
+        /** step contains structural operations */
+        gboolean structural;
+} UndoStep;
+
+
+/** the journal */
+static struct
+{
+        /** steps that can be undone (newest at tail) */
+        GQueue undo;
+        /** steps that can be redone (newest at tail) */
+        GQueue redo;
+        /** step that is currently recorded (NULL if none) */
+        UndoStep *step;
+        /** nesting depth of undo_group_begin() */
+        guint depth;
+        /** time when last step was recorded (0 if it may not be merged) */
+        gint64 last;
+        /** operations are being applied (nothing is recorded) */
+        gboolean replaying;
+        /** element -> UndoHandle */
+        GHashTable *handles;
+} _journal;
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** get (new) handle of an element */
+static UndoHandle *_handle_get(NIFTYLED_TYPE t, gpointer element)
+{
+        UndoHandle *h;
+        if(!(h = g_hash_table_lookup(_journal.handles, element)))
+        {
+                h = g_slice_new(UndoHandle);
+                h->type = t;
+                h->element = element;
+                h->refs = 0;
+                g_hash_table_insert(_journal.handles, element, h);
+        }
+
+        h->refs++;
+        return h;
+}
+
+
+/** drop reference to a handle */
+static void _handle_unref(UndoHandle * h)
+{
+        if(!h || --h->refs > 0)
+                return;
+
+        if(h->element)
+                g_hash_table_remove(_journal.handles, h->element);
+
+        g_slice_free(UndoHandle, h);
+}
+
+
+/** size of one recorded LED value */
+static gsize _led_value_size(UndoLedField field)
+{
+        switch (field)
+        {
+                case UNDO_LED_POS:
+                        return sizeof(UndoPos);
+                case UNDO_LED_COMPONENT:
+                        return sizeof(LedFrameComponent);
+                case UNDO_LED_GAIN:
+                        return sizeof(LedGain);
+        }
+
+        return 0;
+}
+
+
+/** free an operation */
+static void _op_free(gpointer p)
+{
+        UndoOp *op = p;
+
+        switch (op->type)
+        {
+                case UNDO_OP_LEDS:
+                {
+                        g_free(op->u.leds.values);
+                        break;
+                }
+
+                case UNDO_OP_TILE:
+                case UNDO_OP_LEDCOUNT:
+                {
+                        break;
+                }
+
+                case UNDO_OP_TREE:
+                {
+                        if(op->u.tree.node)
+                                led_prefs_node_free(op->u.tree.node);
+
+                        if(op->u.tree.handles)
+                        {
+                                guint i;
+                                for(i = 0; i < op->u.tree.handles->len; i++)
+                                        _handle_unref(g_ptr_array_index
+                                                      (op->u.tree.handles,
+                                                       i));
+                                g_ptr_array_free(op->u.tree.handles, true);
+                        }
+
+                        _handle_unref(op->u.tree.parent);
+                        break;
+                }
+        }
+
+        _handle_unref(op->handle);
+        g_slice_free(UndoOp, op);
+}
+
+
+/** hash of a property operation (see _op_equal()) */
+static guint _op_hash(gconstpointer p)
+{
+        const UndoOp *op = p;
+
+        guint hash = g_direct_hash(op->handle) ^ op->type;
+        if(op->type == UNDO_OP_LEDS)
+                hash ^= op->u.leds.first * 31 + op->u.leds.field;
+
+        return hash;
+}
+
+
+/** property operations record the same values */
+static gboolean _op_equal(gconstpointer a, gconstpointer b)
+{
+        const UndoOp *x = a, *y = b;
+
+        if(x->type != y->type || x->handle != y->handle)
+                return false;
+
+        if(x->type != UNDO_OP_LEDS)
+                return true;
+
+        return x->u.leds.field == y->u.leds.field &&
+                x->u.leds.first == y->u.leds.first &&
+                x->u.leds.count == y->u.leds.count;
+}
+
+
+/** allocate new step */
+static UndoStep *_step_new()
+{
+        UndoStep *s = g_slice_new(UndoStep);
+        s->ops = g_ptr_array_new_with_free_func(_op_free);
+        s->index = g_hash_table_new(_op_hash, _op_equal);
+        s->structural = false;
+
+        return s;
+}
+
+
+/** free a step */
+static void _step_free(gpointer p)
+{
+        UndoStep *s = p;
+
+        g_hash_table_destroy(s->index);
+        g_ptr_array_free(s->ops, true);
+        g_slice_free(UndoStep, s);
+}
+
+
+/** step only changes properties that were already changed by prev */
+static gboolean _step_covered_by(UndoStep * s, UndoStep * prev)
+{
+        if(s->structural || prev->structural)
+                return false;
+
+        guint i;
+        for(i = 0; i < s->ops->len; i++)
+        {
+                if(!g_hash_table_lookup(prev->index,
+                                        g_ptr_array_index(s->ops, i)))
+                        return false;
+        }
+
+        return true;
+}
+
+
+/** free all recorded steps */
+static void _forget_steps()
+{
+        UndoStep *s;
+        while((s = g_queue_pop_head(&_journal.undo)))
+                _step_free(s);
+        while((s = g_queue_pop_head(&_journal.redo)))
+                _step_free(s);
+
+        if(_journal.step)
+        {
+                _step_free(_journal.step);
+                _journal.step = NULL;
+        }
+        _journal.depth = 0;
+        _journal.last = 0;
+}
+
+
+/** update sensitivity of undo/redo actions */
+static void _update_actions()
+{
+        gtk_action_set_sensitive(GTK_ACTION(ui("action_undo")),
+                                 !g_queue_is_empty(&_journal.undo));
+        gtk_action_set_sensitive(GTK_ACTION(ui("action_redo")),
+                                 !g_queue_is_empty(&_journal.redo));
+}
+
+
+/** add operation to current step (or to a step of its own) */
+static void _record(UndoOp * op)
+{
+        gboolean single = (_journal.depth == 0);
+        if(single)
+                undo_group_begin();
+
+        /* properties only need to be recorded once per step */
+        if(op->type != UNDO_OP_TREE &&
+           g_hash_table_lookup(_journal.step->index, op))
+        {
+                _op_free(op);
+        }
+        else
+        {
+                if(op->type != UNDO_OP_TREE)
+                        g_hash_table_insert(_journal.step->index, op, op);
+
+                /* elements (or LEDs) get re-created */
+                if(op->type == UNDO_OP_TREE || op->type == UNDO_OP_LEDCOUNT)
+                        _journal.step->structural = true;
+
+                g_ptr_array_add(_journal.step->ops, op);
+        }
+
+        if(single)
+                undo_group_end();
+}
+
+
+/** allocate new operation */
+static UndoOp *_op_new(UndoOpType type, NIFTYLED_TYPE t, gpointer element)
+{
+        UndoOp *op = g_slice_new0(UndoOp);
+        op->type = type;
+        op->handle = _handle_get(t, element);
+
+        return op;
+}
+
+
+/** hardware a chain belongs to */
+static LedHardware *_chain_hardware(LedChain * c)
+{
+        if(led_chain_parent_is_hardware(c))
+                return led_chain_get_parent_hardware(c);
+
+        LedTile *t;
+        for(t = led_chain_get_parent_tile(c);
+            t && !led_tile_get_parent_hardware(t);
+            t = led_tile_get_parent_tile(t));
+
+        return t ? led_tile_get_parent_hardware(t) : NULL;
+}
+
+
+/** swap recorded & current LED values */
+static void _leds_swap(UndoOp * op)
+{
+        NiftyconfChain *chain = op->handle->element;
+        LedChain *c = chain_niftyled(chain);
+
+        /* ledcount might have changed since */
+        LedCount ledcount = led_chain_get_ledcount(c);
+        LedCount first = op->u.leds.first;
+        LedCount count = first < ledcount ?
+                MIN(op->u.leds.count, ledcount - first) : 0;
+
+        LedCount i;
+        switch (op->u.leds.field)
+        {
+                case UNDO_LED_POS:
+                {
+                        UndoPos *v = op->u.leds.values;
+                        for(i = 0; i < count; i++)
+                        {
+                                Led *l = led_chain_get_nth(c, first + i);
+                                UndoPos cur;
+                                led_get_pos(l, &cur.x, &cur.y);
+                                led_set_pos(l, v[i].x, v[i].y);
+                                v[i] = cur;
+                                spatial_index_update_led(led_get_privdata(l));
+                        }
+                        break;
+                }
+
+                case UNDO_LED_COMPONENT:
+                {
+                        LedFrameComponent *v = op->u.leds.values;
+                        for(i = 0; i < count; i++)
+                        {
+                                Led *l = led_chain_get_nth(c, first + i);
+                                LedFrameComponent cur = led_get_component(l);
+                                led_set_component(l, v[i]);
+                                v[i] = cur;
+                                renderer_damage(led_get_renderer
+                                                (led_get_privdata(l)));
+                        }
+                        break;
+                }
+
+                case UNDO_LED_GAIN:
+                {
+                        LedGain *v = op->u.leds.values;
+                        for(i = 0; i < count; i++)
+                        {
+                                Led *l = led_chain_get_nth(c, first + i);
+                                LedGain cur = led_get_gain(l);
+                                led_set_gain(l, v[i]);
+                                v[i] = cur;
+                        }
+
+                        LedHardware *h;
+                        if((h = _chain_hardware(c)))
+                                led_hardware_refresh_gain(h);
+                        break;
+                }
+        }
+
+        /* damage chain once for the whole range */
+        renderer_chain_damage(chain);
+
+        if(count > 0)
+                journal_record_leds(chain, first, first + count - 1,
+                                    op->u.leds.field);
+}
+
+
+/** read placement of a tile */
+static void _tile_get(LedTile * t, UndoTile * v)
+{
+        led_tile_get_pos(t, &v->x, &v->y);
+        led_tile_get_pivot(t, &v->pivot_x, &v->pivot_y);
+        v->rotation = led_tile_get_rotation(t);
+}
+
+
+/** swap recorded & current placement of a tile */
+static void _tile_swap(UndoOp * op)
+{
+        NiftyconfTile *tile = op->handle->element;
+        LedTile *t = tile_niftyled(tile);
+
+        UndoTile cur;
+        _tile_get(t, &cur);
+
+        led_tile_set_pos(t, op->u.tile.x, op->u.tile.y);
+        led_tile_set_pivot(t, op->u.tile.pivot_x, op->u.tile.pivot_y);
+        led_tile_set_rotation(t, op->u.tile.rotation);
+        op->u.tile = cur;
+
+        spatial_index_update_tile(tile);
+        ui_setup_tree_update_element(LED_TILE_T, tile);
+        renderer_tile_damage(tile);
+
+        journal_record_tile(tile);
+}
+
+
+/** swap recorded & current amount of LEDs of a chain */
+static gboolean _ledcount_swap(UndoOp * op)
+{
+        NiftyconfChain *chain = op->handle->element;
+        LedCount cur = led_chain_get_ledcount(chain_niftyled(chain));
+
+        journal_record_ledcount(chain, op->u.ledcount);
+
+        if(!chain_set_ledcount(chain, op->u.ledcount))
+                return false;
+
+        op->u.ledcount = cur;
+
+        ui_setup_tree_update_element(LED_CHAIN_T, chain);
+        renderer_chain_damage(chain);
+
+        return true;
+}
+
+
+/** visit element & all its descendants (preorder) */
+static void _walk(NIFTYLED_TYPE t, gpointer element,
+                  void (*func) (NIFTYLED_TYPE t, gpointer element, void *u),
+                  void *u)
+{
+        func(t, element, u);
+
+        LedChain *c = NULL;
+        LedTile *child = NULL;
+        switch (t)
+        {
+                case LED_HARDWARE_T:
+                {
+                        LedHardware *h = hardware_niftyled(element);
+                        c = led_hardware_get_chain(h);
+                        child = led_hardware_get_tile(h);
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        LedTile *tile = tile_niftyled(element);
+                        c = led_tile_get_chain(tile);
+                        child = led_tile_get_child(tile);
+                        break;
+                }
+
+                default:
+                {
+                        return;
+                }
+        }
+
+        if(c && led_chain_get_privdata(c))
+                func(LED_CHAIN_T, led_chain_get_privdata(c), u);
+
+        for(; child; child = led_tile_list_get_next(child))
+        {
+                if(led_tile_get_privdata(child))
+                        _walk(LED_TILE_T, led_tile_get_privdata(child),
+                              func, u);
+        }
+}
+
+
+/** _walk() helper to collect handles */
+static void _collect(NIFTYLED_TYPE t, gpointer element, void *u)
+{
+        g_ptr_array_add(u, _handle_get(t, element));
+}
+
+
+/** cursor for _bind() */
+struct _Bind
+{
+        GPtrArray *handles;
+        guint i;
+};
+
+
+/** _walk() helper to re-attach handles to re-created elements */
+static void _bind(NIFTYLED_TYPE t, gpointer element, void *u)
+{
+        struct _Bind *b = u;
+        if(b->i >= b->handles->len)
+                return;
+
+        UndoHandle *h = g_ptr_array_index(b->handles, b->i++);
+        h->element = element;
+        g_hash_table_insert(_journal.handles, element, h);
+}
+
+
+/** remember element (that's still part of setup) for re-creation */
+static gboolean _tree_capture(UndoOp * op)
+{
+        gpointer e = op->handle->element;
+        LedPrefs *p = setup_get_prefs();
+
+        LedPrefsNode *n = NULL;
+        switch (op->handle->type)
+        {
+                case LED_HARDWARE_T:
+                {
+                        n = led_prefs_hardware_to_node(p,
+                                                       hardware_niftyled(e));
+                        op->u.tree.position = hardware_get_position(e);
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        n = led_prefs_tile_to_node(p, tile_niftyled(e));
+                        op->u.tree.position = tile_get_position(e);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        n = led_prefs_chain_to_node(p, chain_niftyled(e));
+                        break;
+                }
+
+                default:
+                {
+                        break;
+                }
+        }
+
+        if(!n)
+                return false;
+
+        op->u.tree.node = n;
+
+        /* handles of everything that will be re-created */
+        op->u.tree.handles = g_ptr_array_new();
+        _walk(op->handle->type, e, _collect, op->u.tree.handles);
+
+        return true;
+}
+
+
+/** remove element from setup */
+static gboolean _tree_remove(UndoOp * op)
+{
+        if(!_tree_capture(op))
+                return false;
+
+        gpointer e = op->handle->element;
+        journal_record_remove(op->handle->type, e);
+        switch (op->handle->type)
+        {
+                case LED_HARDWARE_T:
+                {
+                        hardware_destroy(e);
+                        renderer_setup_damage();
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        renderer_tile_damage_placement(e);
+                        tile_destroy(e);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        NiftyconfTile *parent =
+                                led_tile_get_privdata(led_chain_get_parent_tile
+                                                      (chain_niftyled(e)));
+                        chain_of_tile_destroy(parent);
+                        renderer_tile_damage(parent);
+                        break;
+                }
+
+                default:
+                {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+
+/** re-create element from its recorded node */
+static gboolean _tree_restore(UndoOp * op)
+{
+        /* parent must be part of the setup */
+        gpointer parent = NULL;
+        if(op->u.tree.parent && !(parent = op->u.tree.parent->element))
+                return false;
+
+        LedPrefs *p = setup_get_prefs();
+        LedPrefsNode *n = op->u.tree.node;
+
+        gpointer e = NULL;
+        switch (op->handle->type)
+        {
+                case LED_HARDWARE_T:
+                {
+                        LedHardware *h;
+                        if(!(h = led_prefs_hardware_from_node(p, n)))
+                                return false;
+
+                        if(!(e = hardware_register_to_gui_and_niftyled(h)))
+                                return false;
+
+                        /* registering appended it, move row along */
+                        if(hardware_get_position(e) != op->u.tree.position)
+                        {
+                                GtkTreePath *path =
+                                        ui_setup_tree_element_removing
+                                        (LED_HARDWARE_T, e);
+                                hardware_set_position(e, op->u.tree.position);
+                                ui_setup_tree_element_deleted(path);
+                                ui_setup_tree_element_inserted(LED_HARDWARE_T,
+                                                               e);
+                        }
+
+                        LedTile *t;
+                        for(t = led_hardware_get_tile(h); t;
+                            t = led_tile_list_get_next(t))
+                                spatial_index_update_tile
+                                        (led_tile_get_privdata(t));
+
+                        renderer_setup_damage();
+                        break;
+                }
+
+                case LED_TILE_T:
+                {
+                        LedTile *t;
+                        if(!(t = led_prefs_tile_from_node(p, n)))
+                                return false;
+
+                        /* attach to parent */
+                        if(op->u.tree.parent->type == LED_TILE_T)
+                        {
+                                led_tile_list_append_child(tile_niftyled
+                                                           (parent), t);
+                        }
+                        else
+                        {
+                                LedHardware *h = hardware_niftyled(parent);
+                                LedTile *first;
+                                if(!(first = led_hardware_get_tile(h)))
+                                        led_hardware_set_tile(h, t);
+                                else
+                                        led_tile_list_append_head(first, t);
+                        }
+
+                        if(!(e = tile_register_to_gui(t)))
+                                return false;
+
+                        tile_set_position(e, op->u.tree.position);
+                        spatial_index_update_tile(e);
+                        ui_setup_tree_element_inserted(LED_TILE_T, e);
+                        renderer_tile_damage_placement(e);
+                        break;
+                }
+
+                case LED_CHAIN_T:
+                {
+                        LedChain *c;
+                        if(!(c = led_prefs_chain_from_node(p, n)))
+                                return false;
+
+                        led_tile_set_chain(tile_niftyled(parent), c);
+
+                        if(!(e = chain_register_to_gui(c)))
+                                return false;
+
+                        spatial_index_update_chain(e);
+                        ui_setup_tree_element_inserted(LED_CHAIN_T, e);
+                        renderer_tile_damage(parent);
+                        break;
+                }
+
+                default:
+                {
+                        return false;
+                }
+        }
+
+        journal_record_insert(op->handle->type, e);
+
+        /* operations refer to the new elements from now on */
+        struct _Bind b = {.handles = op->u.tree.handles,.i = 0 };
+        _walk(op->handle->type, e, _bind, &b);
+
+        led_prefs_node_free(op->u.tree.node);
+        op->u.tree.node = NULL;
+
+        guint i;
+        for(i = 0; i < op->u.tree.handles->len; i++)
+                _handle_unref(g_ptr_array_index(op->u.tree.handles, i));
+        g_ptr_array_free(op->u.tree.handles, true);
+        op->u.tree.handles = NULL;
+
+        return true;
+}
+
+
+/** apply one operation */
+static gboolean _op_apply(UndoOp * op)
+{
+        /* element must be part of setup (unless it gets re-created) */
+        if(!op->handle->element &&
+           !(op->type == UNDO_OP_TREE && !op->u.tree.present))
+                return false;
+
+        switch (op->type)
+        {
+                case UNDO_OP_LEDS:
+                {
+                        _leds_swap(op);
+                        return true;
+                }
+
+                case UNDO_OP_TILE:
+                {
+                        _tile_swap(op);
+                        return true;
+                }
+
+                case UNDO_OP_LEDCOUNT:
+                {
+                        return _ledcount_swap(op);
+                }
+
+                case UNDO_OP_TREE:
+                {
+                        gboolean r = op->u.tree.present ?
+                                _tree_remove(op) : _tree_restore(op);
+                        if(r)
+                                op->u.tree.present = !op->u.tree.present;
+                        return r;
+                }
+        }
+
+        return false;
+}
+
+
+/** apply all operations of a step */
+static void _step_apply(UndoStep * s, gboolean backwards)
+{
+        _journal.replaying = true;
+
+        guint failed = 0;
+        guint i;
+        for(i = 0; i < s->ops->len; i++)
+        {
+                UndoOp *op = g_ptr_array_index(s->ops,
+                                               backwards ?
+                                               s->ops->len - 1 - i : i);
+                if(!_op_apply(op))
+                        failed++;
+        }
+
+        _journal.replaying = false;
+
+        if(failed)
+                ui_log_alert_show("Failed to restore %d element(s)", failed);
+
+        /* elements shown in props might be gone */
+        if(s->structural)
+                ui_setup_props_hide();
+        else
+                ui_setup_props_refresh();
+
+        ui_renderer_all_queue_draw();
+}
+
+
+/** parent of an element (NULL for hardware) */
+static UndoHandle *_parent_handle(NIFTYLED_TYPE t, gpointer element)
+{
+        switch (t)
+        {
+                case LED_TILE_T:
+                {
+                        LedTile *tile = tile_niftyled(element);
+                        LedTile *pt;
+                        if((pt = led_tile_get_parent_tile(tile)))
+                                return _handle_get(LED_TILE_T,
+                                                   led_tile_get_privdata(pt));
+
+                        return _handle_get(LED_HARDWARE_T,
+                                           led_hardware_get_privdata
+                                           (led_tile_get_parent_hardware
+                                            (tile)));
+                }
+
+                case LED_CHAIN_T:
+                {
+                        return _handle_get(LED_TILE_T,
+                                           led_tile_get_privdata
+                                           (led_chain_get_parent_tile
+                                            (chain_niftyled(element))));
+                }
+
+                default:
+                {
+                        return NULL;
+                }
+        }
+}
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/** start a step that's undone as a whole (calls can be nested) */
+void undo_group_begin()
+{
+        if(_journal.depth++ > 0)
+                return;
+
+        _journal.step = _step_new();
+}
+
+
+/** finish step started with undo_group_begin() */
+void undo_group_end()
+{
+        if(_journal.depth == 0 || --_journal.depth > 0)
+                return;
+
+        UndoStep *s = _journal.step;
+        _journal.step = NULL;
+
+        /* nothing changed */
+        if(s->ops->len == 0)
+        {
+                _step_free(s);
+                return;
+        }
+
+        /* everything else that could be redone is obsolete now */
+        UndoStep *r;
+        while((r = g_queue_pop_head(&_journal.redo)))
+                _step_free(r);
+
+        /* continued edit of the same properties? */
+        gint64 now = g_get_monotonic_time();
+        UndoStep *prev = g_queue_peek_tail(&_journal.undo);
+        if(prev && _journal.last &&
+           now - _journal.last < UNDO_MERGE_INTERVAL * 1000 &&
+           _step_covered_by(s, prev))
+        {
+                _step_free(s);
+        }
+        else
+        {
+                g_queue_push_tail(&_journal.undo, s);
+
+                /* forget oldest step */
+                if(g_queue_get_length(&_journal.undo) > UNDO_MAX_STEPS)
+                        _step_free(g_queue_pop_head(&_journal.undo));
+        }
+
+        _journal.last = now;
+        _update_actions();
+}
+
+
+/** revert & drop step started with undo_group_begin() (e.g. on failure) */
+void undo_group_cancel()
+{
+        if(_journal.depth == 0 || --_journal.depth > 0)
+                return;
+
+        UndoStep *s = _journal.step;
+        _journal.step = NULL;
+
+        _step_apply(s, true);
+        _step_free(s);
+}
+
+
+/** record current properties of a range of LEDs (before changing them) */
+void undo_record_leds(NiftyconfChain * c,
+                      LedCount first, LedCount last, UndoLedField field)
+{
+        if(!c)
+                NFT_LOG_NULL();
+
+        if(_journal.replaying || last < first)
+                return;
+
+        journal_record_leds(c, first, last, field);
+
+        UndoOp *op = _op_new(UNDO_OP_LEDS, LED_CHAIN_T, c);
+        op->u.leds.field = field;
+        op->u.leds.first = first;
+        op->u.leds.count = last - first + 1;
+
+        /* already recorded in this step? */
+        if(_journal.step && g_hash_table_lookup(_journal.step->index, op))
+        {
+                _op_free(op);
+                return;
+        }
+
+        LedChain *chain = chain_niftyled(c);
+        gsize size = _led_value_size(field);
+        op->u.leds.values = g_malloc(size * op->u.leds.count);
+
+        LedCount i;
+        for(i = 0; i < op->u.leds.count; i++)
+        {
+                Led *l = led_chain_get_nth(chain, first + i);
+                switch (field)
+                {
+                        case UNDO_LED_POS:
+                        {
+                                UndoPos *v = op->u.leds.values;
+                                led_get_pos(l, &v[i].x, &v[i].y);
+                                break;
+                        }
+
+                        case UNDO_LED_COMPONENT:
+                        {
+                                LedFrameComponent *v = op->u.leds.values;
+                                v[i] = led_get_component(l);
+                                break;
+                        }
+
+                        case UNDO_LED_GAIN:
+                        {
+                                LedGain *v = op->u.leds.values;
+                                v[i] = led_get_gain(l);
+                                break;
+                        }
+                }
+        }
+
+        _record(op);
+}
+
+
+/** record current placement of a tile (before changing it) */
+void undo_record_tile(NiftyconfTile * t)
+{
+        if(!t)
+                NFT_LOG_NULL();
+
+        if(_journal.replaying)
+                return;
+
+        journal_record_tile(t);
+
+        UndoOp *op = _op_new(UNDO_OP_TILE, LED_TILE_T, t);
+        _tile_get(tile_niftyled(t), &op->u.tile);
+
+        _record(op);
+}
+
+
+/** record amount of LEDs of a chain (before changing it to ledcount) */
+void undo_record_ledcount(NiftyconfChain * c, LedCount ledcount)
+{
+        if(!c)
+                NFT_LOG_NULL();
+
+        if(_journal.replaying)
+                return;
+
+        journal_record_ledcount(c, ledcount);
+
+        undo_group_begin();
+
+        /* properties of LEDs that get dropped */
+        LedCount cur = led_chain_get_ledcount(chain_niftyled(c));
+        if(ledcount < cur)
+        {
+                UndoLedField f;
+                for(f = UNDO_LED_POS; f <= UNDO_LED_GAIN; f++)
+                        undo_record_leds(c, ledcount, cur - 1, f);
+        }
+
+        UndoOp *op = _op_new(UNDO_OP_LEDCOUNT, LED_CHAIN_T, c);
+        op->u.ledcount = cur;
+        _record(op);
+
+        undo_group_end();
+}
+
+
+/** record that an element was added to the setup (after adding it) */
+void undo_record_insert(NIFTYLED_TYPE t, gpointer element)
+{
+        if(!element)
+                NFT_LOG_NULL();
+
+        if(_journal.replaying)
+                return;
+
+        journal_record_insert(t, element);
+
+        UndoOp *op = _op_new(UNDO_OP_TREE, t, element);
+        op->u.tree.present = true;
+        op->u.tree.parent = _parent_handle(t, element);
+
+        _record(op);
+}
+
+
+/** record that an element is removed from the setup (before removing it) */
+void undo_record_remove(NIFTYLED_TYPE t, gpointer element)
+{
+        if(!element)
+                NFT_LOG_NULL();
+
+        if(_journal.replaying)
+                return;
+
+        journal_record_remove(t, element);
+
+        UndoOp *op = _op_new(UNDO_OP_TREE, t, element);
+        op->u.tree.present = false;
+        op->u.tree.parent = _parent_handle(t, element);
+
+        if(!_tree_capture(op))
+        {
+                NFT_LOG(L_WARNING,
+                        "Failed to record removed element, can't be undone");
+                _op_free(op);
+                return;
+        }
+
+        _record(op);
+}
+
+
+/** element is freed (operations referring to it wait for its re-creation) */
+void undo_forget(gpointer element)
+{
+        /* pending journal record would refer to freed element */
+        journal_forget(element);
+
+        if(!_journal.handles)
+                return;
+
+        UndoHandle *h;
+        if(!(h = g_hash_table_lookup(_journal.handles, element)))
+                return;
+
+        h->element = NULL;
+        g_hash_table_remove(_journal.handles, element);
+}
+
+
+/** undo last step */
+gboolean undo_undo()
+{
+        /* pending property edits become a step of their own */
+        ui_setup_props_commit();
+
+        /* can't undo while a step is recorded */
+        if(_journal.depth > 0)
+                return false;
+
+        UndoStep *s;
+        if(!(s = g_queue_pop_tail(&_journal.undo)))
+                return false;
+
+        _step_apply(s, true);
+        g_queue_push_tail(&_journal.redo, s);
+
+        /* next edit starts a new step */
+        _journal.last = 0;
+        _update_actions();
+
+        return true;
+}
+
+
+/** redo last undone step */
+gboolean undo_redo()
+{
+        ui_setup_props_commit();
+
+        if(_journal.depth > 0)
+                return false;
+
+        UndoStep *s;
+        if(!(s = g_queue_pop_tail(&_journal.redo)))
+                return false;
+
+        _step_apply(s, false);
+        g_queue_push_tail(&_journal.undo, s);
+
+        _journal.last = 0;
+        _update_actions();
+
+        return true;
+}
+
+
+/** forget all steps (e.g. when a new setup is loaded) */
+void undo_clear()
+{
+        _forget_steps();
+        _update_actions();
+}
+
+
+/** initialize this module */
+gboolean undo_init()
+{
+        g_queue_init(&_journal.undo);
+        g_queue_init(&_journal.redo);
+        _journal.handles = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+        return true;
+}
+
+
+/** deinitialize this module */
+void undo_deinit()
+{
+        _forget_steps();
+        g_hash_table_destroy(_journal.handles);
+        _journal.handles = NULL;
+}
+
+
+/******************************************************************************
+ ***************************** CALLBACKS **************************************
+ ******************************************************************************/
+
+/** undo */
+G_MODULE_EXPORT void on_action_undo_activate(GtkAction * a, gpointer u)
+{
+        undo_undo();
+}
+
+
+/** redo */
+G_MODULE_EXPORT void on_action_redo_activate(GtkAction * a, gpointer u)
+{
+        undo_redo();
+}
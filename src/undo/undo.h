@@ -0,0 +1,76 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _UNDO_H
+#define _UNDO_H
+
+#include "elements/element-chain.h"
+#include "elements/element-tile.h"
+
+
+/** property of LEDs recorded by undo_record_leds() */
+typedef enum
+{
+        UNDO_LED_POS,
+        UNDO_LED_COMPONENT,
+        UNDO_LED_GAIN,
+} UndoLedField;
+
+
+
+gboolean                        undo_init();
+void                            undo_deinit();
+void                            undo_clear();
+void                            undo_group_begin();
+void                            undo_group_end();
+void                            undo_group_cancel();
+void                            undo_record_leds(NiftyconfChain * c, LedCount first, LedCount last, UndoLedField field);
+void                            undo_record_tile(NiftyconfTile * t);
+void                            undo_record_ledcount(NiftyconfChain * c, LedCount ledcount);
+void                            undo_record_insert(NIFTYLED_TYPE t, gpointer element);
+void                            undo_record_remove(NIFTYLED_TYPE t, gpointer element);
+void                            undo_forget(gpointer element);
+gboolean                        undo_undo();
+gboolean                        undo_redo();
+
+#endif /* _UNDO_H */
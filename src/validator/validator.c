@@ -0,0 +1,375 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gtk/gtk.h>
+#include <niftyled.h>
+#include "ui/ui-setup-tree.h"
+#include "elements/element-led.h"
+#include "elements/element-chain.h"
+#include "elements/element-tile.h"
+#include "spatial-index/spatial-index.h"
+#include "validator/validator.h"
+
+
+/** LEDs of different tiles closer than this overlap (in setup coordinates) */
+#define OVERLAP_DISTANCE        0.5
+
+
+/** chains that need to be validated (NiftyconfChain -> NULL) */
+static GHashTable *_dirty;
+/** amount of LEDs with problems per chain (NiftyconfChain -> count) */
+static GHashTable *_problems;
+/** amount of LEDs with problems in whole setup */
+static guint _total;
+/** source ID of scheduled validation run (0 if none is scheduled) */
+static guint _idle_id;
+
+
+
+
+/******************************************************************************
+ ****************************** STATIC FUNCTIONS ******************************
+ ******************************************************************************/
+
+/** idle handler that validates all dirty chains */
+static gboolean _validate_idle(gpointer u);
+
+
+/** put chain on list of chains to validate */
+static void _invalidate_chain(NiftyconfChain * c)
+{
+        g_hash_table_insert(_dirty, c, NULL);
+
+        if(!_idle_id)
+                _idle_id = g_idle_add(_validate_idle, NULL);
+}
+
+
+/** foreach helper to invalidate the chain of a LED */
+static void _invalidate_led_chain(NiftyconfLed * l, void *u)
+{
+        _invalidate_chain(led_get_chain(l));
+}
+
+
+/** data for _find_overlap() */
+struct _OverlapQuery
+{
+        /** LED we search overlapping LEDs for */
+        NiftyconfLed *led;
+        /** center of this LED */
+        double x, y;
+        /** true if an overlapping LED was found */
+        gboolean found;
+};
+
+
+/** foreach helper to find LEDs of other chains overlapping a LED */
+static void _find_overlap(NiftyconfLed * l, void *u)
+{
+        struct _OverlapQuery *q = u;
+
+        /* LEDs of the same chain are checked by their local positions */
+        if(led_get_chain(l) == led_get_chain(q->led))
+                return;
+
+        double x, y;
+        spatial_index_get_led_pos(l, &x, &y);
+        if((x - q->x) * (x - q->x) + (y - q->y) * (y - q->y) >=
+           OVERLAP_DISTANCE * OVERLAP_DISTANCE)
+                return;
+
+        q->found = true;
+
+        /* overlap is mutual, so the other LED needs to be flagged, too */
+        if(!(led_get_problems(l) & VALIDATOR_OVERLAP))
+                _invalidate_chain(led_get_chain(l));
+}
+
+
+/** check all LEDs of a chain, return amount of LEDs with problems */
+static guint _validate_chain(NiftyconfChain * chain)
+{
+        LedChain *c = chain_niftyled(chain);
+
+        /* only chains of tiles have positions to validate */
+        LedTile *t;
+        if(!(t = led_chain_get_parent_tile(c)))
+                return 0;
+
+        LedFrameCord w, h;
+        led_tile_get_dim(t, &w, &h);
+
+        LedCount count = led_chain_get_ledcount(c);
+        ValidatorProblem *problems = g_new0(ValidatorProblem, count);
+
+        /* position of each LED packed into one key */
+        gint64 *keys = g_new(gint64, count);
+        /* key -> position of first LED using it (+1) */
+        GHashTable *positions = g_hash_table_new(g_int64_hash,
+                                                 g_int64_equal);
+
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                LedFrameCord x, y;
+                led_get_pos(led_chain_get_nth(c, i), &x, &y);
+
+                /* outside of tile? */
+                if((gint64) x < 0 || (gint64) y < 0 ||
+                   (gint64) x >= (gint64) w || (gint64) y >= (gint64) h)
+                        problems[i] |= VALIDATOR_OUTSIDE;
+
+                /* position used by another LED already? */
+                keys[i] = (gint64) (((guint64) (guint32) x << 32) |
+                                    (guint32) y);
+                gpointer first;
+                if((first = g_hash_table_lookup(positions, &keys[i])))
+                {
+                        problems[i] |= VALIDATOR_DUPLICATE;
+                        problems[GPOINTER_TO_SIZE(first) - 1] |=
+                                VALIDATOR_DUPLICATE;
+                }
+                else
+                {
+                        g_hash_table_insert(positions, &keys[i],
+                                            GSIZE_TO_POINTER(i + 1));
+                }
+        }
+
+        g_hash_table_destroy(positions);
+        g_free(keys);
+
+
+        /* check for overlapping LEDs of other tiles & apply result */
+        guint result = 0;
+        for(i = 0; i < count; i++)
+        {
+                NiftyconfLed *l;
+                if(!(l = led_get_privdata(led_chain_get_nth(c, i))))
+                        continue;
+
+                struct _OverlapQuery q = {.led = l };
+                if(spatial_index_get_led_pos(l, &q.x, &q.y))
+                {
+                        spatial_index_foreach_in_rect(q.x - OVERLAP_DISTANCE,
+                                                      q.y - OVERLAP_DISTANCE,
+                                                      q.x + OVERLAP_DISTANCE,
+                                                      q.y + OVERLAP_DISTANCE,
+                                                      _find_overlap, &q);
+                        if(q.found)
+                                problems[i] |= VALIDATOR_OVERLAP;
+                }
+
+                led_set_problems(l, problems[i]);
+
+                if(problems[i])
+                        result++;
+        }
+
+        g_free(problems);
+
+        return result;
+}
+
+
+/** show new problem count of chain (and its parent tiles) in setup-tree */
+static void _update_tree(NiftyconfChain * chain)
+{
+        ui_setup_tree_update_element(LED_CHAIN_T, chain);
+
+        LedTile *t;
+        for(t = led_chain_get_parent_tile(chain_niftyled(chain));
+            t; t = led_tile_get_parent_tile(t))
+        {
+                NiftyconfTile *tile;
+                if((tile = led_tile_get_privdata(t)))
+                        ui_setup_tree_update_element(LED_TILE_T, tile);
+        }
+}
+
+
+/** idle handler that validates all dirty chains */
+static gboolean _validate_idle(gpointer u)
+{
+        gboolean changed = false;
+
+        /* validating a chain can make other chains dirty */
+        while(g_hash_table_size(_dirty) > 0)
+        {
+                GHashTable *dirty = _dirty;
+                _dirty = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+                GHashTableIter iter;
+                gpointer key;
+                g_hash_table_iter_init(&iter, dirty);
+                while(g_hash_table_iter_next(&iter, &key, NULL))
+                {
+                        NiftyconfChain *c = key;
+                        guint old = validator_chain_problems(c);
+                        guint new = _validate_chain(c);
+
+                        if(old == new)
+                                continue;
+
+                        _total = _total - old + new;
+                        if(new)
+                                g_hash_table_insert(_problems, c,
+                                                    GUINT_TO_POINTER(new));
+                        else
+                                g_hash_table_remove(_problems, c);
+
+                        _update_tree(c);
+                        changed = true;
+                }
+
+                g_hash_table_destroy(dirty);
+        }
+
+        _idle_id = 0;
+
+        if(changed && _total)
+                NFT_LOG(L_WARNING, "%u LEDs with invalid positions in setup",
+                        _total);
+
+        return false;
+}
+
+
+/******************************************************************************
+ ******************************************************************************/
+
+/** LED (or the tile it belongs to) changed position */
+void validator_invalidate_led(NiftyconfLed * l)
+{
+        if(!l)
+                NFT_LOG_NULL();
+
+        _invalidate_chain(led_get_chain(l));
+}
+
+
+/**
+ * something at this position (setup coordinates) moved away,
+ * LEDs that overlapped with it need to be checked again
+ */
+void validator_invalidate_near(double x, double y)
+{
+        spatial_index_foreach_in_rect(x - OVERLAP_DISTANCE,
+                                      y - OVERLAP_DISTANCE,
+                                      x + OVERLAP_DISTANCE,
+                                      y + OVERLAP_DISTANCE,
+                                      _invalidate_led_chain, NULL);
+}
+
+
+/** chain is about to be freed */
+void validator_forget_chain(NiftyconfChain * c)
+{
+        g_hash_table_remove(_dirty, c);
+
+        _total -= validator_chain_problems(c);
+        g_hash_table_remove(_problems, c);
+}
+
+
+/** amount of LEDs with problems in a chain */
+guint validator_chain_problems(NiftyconfChain * c)
+{
+        return GPOINTER_TO_UINT(g_hash_table_lookup(_problems, c));
+}
+
+
+/** amount of LEDs with problems in a tile and all its children */
+guint validator_tile_problems(NiftyconfTile * tile)
+{
+        if(!tile)
+                NFT_LOG_NULL(0);
+
+        LedTile *t = tile_niftyled(tile);
+        guint result = 0;
+
+        LedChain *c;
+        NiftyconfChain *chain;
+        if((c = led_tile_get_chain(t)) && (chain = led_chain_get_privdata(c)))
+                result += validator_chain_problems(chain);
+
+        LedTile *child;
+        for(child = led_tile_get_child(t);
+            child; child = led_tile_list_get_next(child))
+        {
+                NiftyconfTile *ct;
+                if((ct = led_tile_get_privdata(child)))
+                        result += validator_tile_problems(ct);
+        }
+
+        return result;
+}
+
+
+/** amount of LEDs with problems in whole setup */
+guint validator_problems()
+{
+        return _total;
+}
+
+
+/** initialize this module */
+gboolean validator_init()
+{
+        _dirty = g_hash_table_new(g_direct_hash, g_direct_equal);
+        _problems = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+        return true;
+}
+
+
+/** deinitialize this module */
+void validator_deinit()
+{
+        if(_idle_id)
+                g_source_remove(_idle_id);
+
+        g_hash_table_destroy(_problems);
+        g_hash_table_destroy(_dirty);
+}
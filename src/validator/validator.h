@@ -0,0 +1,76 @@
+/*
+ * niftyconf - niftyled GUI
+ * Copyright (C) 2011-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _VALIDATOR_H
+#define _VALIDATOR_H
+
+#include "elements/element-led.h"
+#include "elements/element-chain.h"
+#include "elements/element-tile.h"
+
+
+/** problems a LED can have (bitmask) */
+typedef enum
+{
+        /* LED is fine */
+        VALIDATOR_OK = 0,
+        /* another LED of the same tile has the same position */
+        VALIDATOR_DUPLICATE = (1 << 0),
+        /* position is outside the dimensions of the tile */
+        VALIDATOR_OUTSIDE = (1 << 1),
+        /* LED overlaps with a LED of another tile */
+        VALIDATOR_OVERLAP = (1 << 2),
+} ValidatorProblem;
+
+
+
+gboolean                        validator_init();
+void                            validator_deinit();
+void                            validator_invalidate_led(NiftyconfLed * l);
+void                            validator_invalidate_near(double x, double y);
+void                            validator_forget_chain(NiftyconfChain * c);
+guint                           validator_chain_problems(NiftyconfChain * c);
+guint                           validator_tile_problems(NiftyconfTile * t);
+guint                           validator_problems();
+
+#endif /* _VALIDATOR_H */